@@ -12,13 +12,83 @@
 #define PATHFINDER_H
 
 #include <string>
+#include <functional>
 #include <memory>
+#include <map>
+#include <vector>
 #include <hydra.h>
 
 namespace pathfinder {
 
 class FontImpl;
 class TextViewImpl;
+class TextBatchImpl;
+class DrawListImpl;
+
+// Where Pathfinder's GL calls go. gb_null issues none and needs no context:
+// it counts the calls, and the bytes they would have uploaded, so that the
+// CPU cost of preparing and drawing text can be measured on its own. Select
+// the backend before initializing any batch or view, and never while another
+// thread is using Pathfinder.
+typedef enum {
+  gb_openGL,
+  gb_null
+} GraphicsBackend;
+
+// What was counted since the last resetGraphicsStats().
+struct GraphicsStats
+{
+  // GL calls, counted by the null backend only.
+  size_t calls;
+  size_t drawCalls;
+  size_t bufferUploadBytes;
+  size_t textureUploadBytes;
+  // Only the functions that were called.
+  std::map<std::string, size_t> callsByFunction;
+  // State changes, counted with either backend: the ones passed on to GL,
+  // and the ones skipped because the context already had that state.
+  size_t stateChangesIssued;
+  size_t stateChangesElided;
+  // Only the kinds of state change that were made, as (issued, elided).
+  std::map<std::string, std::pair<size_t, size_t>> stateChangesByCall;
+};
+
+void setGraphicsBackend(GraphicsBackend aBackend);
+GraphicsStats getGraphicsStats();
+void resetGraphicsStats();
+
+// Pathfinder remembers the GL state it sets on a context and skips changes
+// the context already has. An application that changes GL state itself, or
+// hands the context to other GL code, must call this on the context's thread
+// before it next calls into Pathfinder.
+void invalidateGLState();
+
+// Records spans of CPU time, such as layout and each step of rendering the
+// atlas, for loading into a trace viewer like chrome://tracing. The spans are
+// only there when the library is built with the PATHFINDER_TRACE option;
+// otherwise the trace stays empty. Off by default.
+void setTracingEnabled(bool aEnabled);
+// The spans recorded since the last resetTrace(), in trace_event JSON.
+std::string getTraceJSON();
+void resetTrace();
+
+// GPU time spent in each phase of rendering, in milliseconds, summed over the
+// frames timed since the last TextBatch::resetGPUTimings().
+struct GPUTimings
+{
+  // Frames whose timer queries have come back, which lag a few behind.
+  size_t frameCount;
+  // Clearing the parts of atlases about to be redrawn.
+  double clear;
+  // Drawing the interiors of large glyphs as meshes.
+  double directRendering;
+  // The antialiasing strategy's work per object: stencil or mesh coverage.
+  double antialiasing;
+  // Resolving coverage into the atlas.
+  double resolve;
+  // Compositing glyphs from the atlas in TextView::draw().
+  double blit;
+};
 
 class Font
 {
@@ -30,8 +100,86 @@ private:
   FontImpl* mImpl;
 
   friend class TextViewImpl;
+  friend class TextBatchImpl;
 }; // class Font
 
+// How a batch rasterizes glyphs into its atlas.
+typedef enum {
+  // Exact area coverage drawn on the GPU, from meshes for larger glyphs and
+  // from outline segments for small ones.
+  rz_default,
+  // As rz_default, but the segments of small glyphs are first binned into
+  // tiles on the CPU, so that their interiors are filled as whole tiles.
+  rz_tiled,
+  // Compute shaders writing straight into the atlas, where the context has
+  // GL 4.3. Elsewhere the same as rz_default.
+  rz_compute,
+  // Exact area coverage computed on worker threads and uploaded into the
+  // atlas, for when the GPU is slow or emulated in software. Gives the same
+  // atlas on every machine.
+  rz_cpu
+} Rasterizer;
+
+// Text views initialized with the same batch share a render context. Views
+// that also share a font, size, embolden amount, rotation and hinting have
+// their glyphs rasterized together, in one atlas pass per frame. Call
+// prepare() on the batch once per frame instead of on each view.
+class TextBatch
+{
+public:
+  TextBatch();
+  ~TextBatch();
+  bool init();
+  void prepare();
+  // Only styles that first appear after the call are affected.
+  void setRasterizer(Rasterizer aRasterizer);
+  // Waits for the GPU to finish every TextView::renderToImageAsync() of the
+  // batch and calls their callbacks. prepare() calls back only the ones that
+  // have already finished.
+  void finishReadbacks();
+  // Times each phase of rendering on the GPU with timer queries, which are
+  // read back a few frames later so that they never stall. Off by default.
+  void setGPUTimingEnabled(bool aEnabled);
+  GPUTimings getGPUTimings() const;
+  void resetGPUTimings();
+private:
+  TextBatchImpl* mImpl;
+
+  friend class TextViewImpl;
+}; // class TextBatch
+
+// Draw calls recorded by TextView::record(). Recording makes no GL calls, so
+// it can run on another thread while the GL thread is busy, as long as the
+// views are not changed or prepared until the list has been replayed.
+// replay() must run on the thread that owns the GL context.
+class DrawList
+{
+public:
+  DrawList();
+  ~DrawList();
+  DrawList(const DrawList&) = delete;
+  DrawList& operator=(const DrawList&) = delete;
+  void replay();
+  void reset();
+private:
+  DrawListImpl* mImpl;
+
+  friend class TextView;
+}; // class DrawList
+
+// Pixels read back by TextView::renderToImage(): RGBA with 8 bits per
+// channel, top row first, with no padding between rows.
+struct Image
+{
+  int width;
+  int height;
+  std::vector<unsigned char> pixels;
+};
+
+// Receives the result of TextView::renderToImageAsync(). The image is only
+// valid for the duration of the call.
+typedef std::function<void(const Image& aImage)> ImageCallback;
+
 class TextView
 {
 public:
@@ -40,7 +188,10 @@ public:
 
   void prepare();
   void draw(const kraken::Matrix4& aTransform);
+  // Appends the commands draw() would issue to aDrawList.
+  void record(DrawList& aDrawList, const kraken::Matrix4& aTransform);
   bool init();
+  bool init(std::shared_ptr<TextBatch> aBatch);
 
   void setText(const std::string& aText);
   std::string getText() const;
@@ -52,6 +203,32 @@ public:
   float getEmboldenAmount() const;
   void setRotationAngle(float aRotationAngle);
   float getRotationAngle() const;
+
+  // Saves the rendered glyph atlas so that a later run can restore it instead
+  // of rasterizing the same glyphs again. Call saveAtlas() after prepare(),
+  // and restoreAtlas() after setting the font and size but before the first
+  // prepare(). restoreAtlas() returns false, and the atlas is rendered as
+  // usual, if the file was saved with a different font, size, embolden
+  // amount, rotation or antialiasing options.
+  bool saveAtlas(const std::string& aPath);
+  bool restoreAtlas(const std::string& aPath);
+
+  // Draws the view into an offscreen framebuffer of aWidth x aHeight pixels,
+  // with the first line hanging from the top left, and reads it back into
+  // aImage: white text on opaque black, as draw() leaves it on a black
+  // framebuffer. Needs a current GL context but no window or default
+  // framebuffer, so it works under EGL pbuffer and surfaceless contexts. The
+  // framebuffer is kept by the batch's render context, so rendering many
+  // images costs no GL setup after the first. Call it after prepare().
+  bool renderToImage(Image& aImage, int aWidth, int aHeight);
+  // As renderToImage(), but the pixels are copied into a pixel buffer on the
+  // GPU instead of read back straight away, so the call returns without
+  // waiting for the drawing to finish. aCallback gets them from a later
+  // prepare() or finishReadbacks() of the batch, usually a frame or two on,
+  // so that the readback overlaps whatever is drawn next. Up to four
+  // readbacks are in flight at a time; beyond that, the call waits for the
+  // oldest.
+  bool renderToImageAsync(int aWidth, int aHeight, ImageCallback aCallback);
 private:
   TextViewImpl* mImpl;
 }; // class TextView
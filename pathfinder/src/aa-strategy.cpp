@@ -46,17 +46,17 @@ NoAAStrategy::setFramebufferSize(Renderer& renderer)
 void
 NoAAStrategy::prepareForRendering(Renderer& renderer)
 {
-  GLDEBUG(glBindFramebuffer(GL_FRAMEBUFFER, renderer.getAtlasFramebuffer()));
-  GLDEBUG(glViewport(0, 0, mFramebufferSize[0], mFramebufferSize[1]));
-  GLDEBUG(glDisable(GL_SCISSOR_TEST));
+  GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, renderer.getAtlasFramebuffer()));
+  GLDEBUG(GLState::viewport(0, 0, mFramebufferSize[0], mFramebufferSize[1]));
+  renderer.setAtlasDirtyScissor(kraken::Vector2i::One());
 }
 
 void
 NoAAStrategy::prepareToRenderObject(Renderer& renderer, int objectIndex)
 {
-  GLDEBUG(glBindFramebuffer(GL_FRAMEBUFFER, renderer.getAtlasFramebuffer()));
-  GLDEBUG(glViewport(0, 0, mFramebufferSize[0], mFramebufferSize[1]));
-  GLDEBUG(glDisable(GL_SCISSOR_TEST));
+  GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, renderer.getAtlasFramebuffer()));
+  GLDEBUG(GLState::viewport(0, 0, mFramebufferSize[0], mFramebufferSize[1]));
+  renderer.setAtlasDirtyScissor(kraken::Vector2i::One());
 }
 
 } // namespace pathfinder
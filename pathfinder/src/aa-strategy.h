@@ -38,7 +38,10 @@ typedef enum
 {
   asn_none,
   asn_ssaa,
-  asn_xcaa
+  asn_xcaa,
+  asn_tiled,
+  asn_compute,
+  asn_cpu
 } AntialiasingStrategyName;
 
 typedef enum
@@ -10,9 +10,12 @@
 
 #include "atlas.h"
 #include "text.h"
+#include "context.h"
 #include "gl-utils.h"
+#include "utils.h"
 
 #include <algorithm>
+#include <fstream>
 #include <assert.h>
 
 using namespace std;
@@ -20,33 +23,174 @@ using namespace kraken;
 
 namespace pathfinder {
 
+const __uint32_t ATLAS_SNAPSHOT_FOURCC = fourcc("PFAT");
+const __uint32_t ATLAS_SNAPSHOT_VERSION = 4;
+
+// Compaction is considered once the shelves reach this fraction of the atlas
+// height, and started if less than this fraction of the used area holds
+// glyphs from the latest layout.
+const float ATLAS_COMPACTION_FILL_THRESHOLD = 0.75f;
+const float ATLAS_COMPACTION_LIVE_THRESHOLD = 0.5f;
+
+namespace {
+
+// On-disk layout: the header, followed by slotCount slots, followed by
+// usedWidth * usedHeight tightly packed pixels in the atlas color format.
+// The header and slots are written field by field, little-endian, with no
+// padding, so snapshots can move between machines.
+struct AtlasSnapshotHeader {
+  __uint32_t fourCC;
+  __uint32_t version;
+  __uint64_t configHash;
+  __uint32_t colorAlphaFormat;
+  __uint32_t slotCount;
+  __int32_t usedWidth;
+  __int32_t usedHeight;
+  float nextOrigin[2];
+  float shelfBottom;
+};
+
+struct AtlasSnapshotSlot {
+  float fontSize;
+  __int32_t sortKey;
+  float origin[2];
+  float pixelRect[4];
+  float pixelsPerUnit;
+};
+
+const size_t ATLAS_SNAPSHOT_HEADER_SIZE = 44;
+const size_t ATLAS_SNAPSHOT_SLOT_SIZE = 36;
+
+void
+writeSnapshotHeader(vector<__uint8_t>& aBuffer, const AtlasSnapshotHeader& aHeader)
+{
+  appendUInt32LE(aBuffer, aHeader.fourCC);
+  appendUInt32LE(aBuffer, aHeader.version);
+  appendUInt64LE(aBuffer, aHeader.configHash);
+  appendUInt32LE(aBuffer, aHeader.colorAlphaFormat);
+  appendUInt32LE(aBuffer, aHeader.slotCount);
+  appendUInt32LE(aBuffer, (__uint32_t)aHeader.usedWidth);
+  appendUInt32LE(aBuffer, (__uint32_t)aHeader.usedHeight);
+  appendFloat32LE(aBuffer, aHeader.nextOrigin[0]);
+  appendFloat32LE(aBuffer, aHeader.nextOrigin[1]);
+  appendFloat32LE(aBuffer, aHeader.shelfBottom);
+}
+
+void
+readSnapshotHeader(const __uint8_t* aData, AtlasSnapshotHeader& aHeader)
+{
+  aHeader.fourCC = readUInt32LE(aData);
+  aHeader.version = readUInt32LE(aData + 4);
+  aHeader.configHash = readUInt64LE(aData + 8);
+  aHeader.colorAlphaFormat = readUInt32LE(aData + 16);
+  aHeader.slotCount = readUInt32LE(aData + 20);
+  aHeader.usedWidth = (__int32_t)readUInt32LE(aData + 24);
+  aHeader.usedHeight = (__int32_t)readUInt32LE(aData + 28);
+  aHeader.nextOrigin[0] = readFloat32LE(aData + 32);
+  aHeader.nextOrigin[1] = readFloat32LE(aData + 36);
+  aHeader.shelfBottom = readFloat32LE(aData + 40);
+}
+
+void
+writeSnapshotSlot(vector<__uint8_t>& aBuffer, const AtlasSnapshotSlot& aSlot)
+{
+  appendFloat32LE(aBuffer, aSlot.fontSize);
+  appendUInt32LE(aBuffer, (__uint32_t)aSlot.sortKey);
+  for (int i = 0; i < 2; i++) {
+    appendFloat32LE(aBuffer, aSlot.origin[i]);
+  }
+  for (int i = 0; i < 4; i++) {
+    appendFloat32LE(aBuffer, aSlot.pixelRect[i]);
+  }
+  appendFloat32LE(aBuffer, aSlot.pixelsPerUnit);
+}
+
+void
+readSnapshotSlot(const __uint8_t* aData, AtlasSnapshotSlot& aSlot)
+{
+  aSlot.fontSize = readFloat32LE(aData);
+  aSlot.sortKey = (__int32_t)readUInt32LE(aData + 4);
+  for (int i = 0; i < 2; i++) {
+    aSlot.origin[i] = readFloat32LE(aData + 8 + i * 4);
+  }
+  for (int i = 0; i < 4; i++) {
+    aSlot.pixelRect[i] = readFloat32LE(aData + 16 + i * 4);
+  }
+  aSlot.pixelsPerUnit = readFloat32LE(aData + 32);
+}
+
+} // anonymous namespace
+
 Atlas::Atlas()
   : mTexture(0)
+  , mColorAlphaFormat(caf_RGBA8)
+  , mShelfBottom(2.0f)
+  , mGeneration(0)
+  , mCompactionTexture(0)
+  , mCompactionReadFramebuffer(0)
+  , mCompactionDrawFramebuffer(0)
+  , mCompactionDoesNotFit(false)
+  , mSupportsCopyImage(false)
 {
   mUsedSize = kraken::Vector2i::Zero();
+  mNextOrigin = Vector2::One();
+  mDirtyRect = Vector4::Zero();
 }
 
 Atlas::~Atlas()
 {
   if (mTexture) {
-    GLDEBUG(glDeleteTextures(1, &mTexture));
+    GLDEBUG(GLState::deleteTextures(1, &mTexture));
     mTexture = 0;
   }
+  if (mCompactionTexture) {
+    GLDEBUG(GLState::deleteTextures(1, &mCompactionTexture));
+    mCompactionTexture = 0;
+  }
+  if (mCompactionReadFramebuffer) {
+    GLDEBUG(GLState::deleteFramebuffers(1, &mCompactionReadFramebuffer));
+    mCompactionReadFramebuffer = 0;
+  }
+  if (mCompactionDrawFramebuffer) {
+    GLDEBUG(GLState::deleteFramebuffers(1, &mCompactionDrawFramebuffer));
+    mCompactionDrawFramebuffer = 0;
+  }
 }
 
 
 bool
-Atlas::init(RenderContext& renderContext)
+Atlas::init(RenderContext& renderContext, ColorAlphaFormat aColorAlphaFormat)
 {
+  // Grayscale text only ever needs a single coverage channel, so an R8 atlas
+  // holds the same glyphs in a quarter of the memory and fill bandwidth.
+  GLint internalFormat;
+  GLenum format;
+  switch (aColorAlphaFormat) {
+  case caf_RGBA8:
+    internalFormat = GL_RGBA;
+    format = GL_RGBA;
+    break;
+  case caf_R8:
+    internalFormat = GL_R8;
+    format = GL_RED;
+    break;
+  default:
+    // RGB5_A1 is only used for intermediate framebuffers.
+    assert(false);
+    return false;
+  }
+  mColorAlphaFormat = aColorAlphaFormat;
+  mSupportsCopyImage = renderContext.getSupportsCopyImage();
+
   GLDEBUG(glCreateTextures(GL_TEXTURE_2D, 1, &mTexture));
-  GLDEBUG(glBindTexture(GL_TEXTURE_2D, mTexture));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_2D, mTexture));
   GLDEBUG(glTexImage2D(GL_TEXTURE_2D,
                 0,
-                GL_RGBA,
+                internalFormat,
                 ATLAS_SIZE[0],
                 ATLAS_SIZE[1],
                 0,
-                GL_RGBA,
+                format,
                 GL_UNSIGNED_BYTE,
                 0));
   setTextureParameters(GL_NEAREST);
@@ -62,42 +206,531 @@ Atlas::layoutGlyphs(std::vector<AtlasGlyph>& glyphs,
                   const Hint& hint,
                   kraken::Vector2 emboldenAmount)
 {
-  Vector2 nextOrigin = Vector2::One();
-  float shelfBottom = 2.0f;
+  placeGlyphs(glyphs, font, pixelsPerUnit, rotationAngle, hint, emboldenAmount);
+
+  // Slots cached for other sizes and texts pile up over time. Once they
+  // crowd out the current glyphs, start over with just those.
+  if (mShelfBottom > ATLAS_SIZE[1]) {
+    reset();
+    placeGlyphs(glyphs, font, pixelsPerUnit, rotationAngle, hint, emboldenAmount);
+  }
+
+  // FIXME(pcwalton): Could be more precise if we don't have a full row.
+  mUsedSize = Vector2i::Create(ATLAS_SIZE[0], mShelfBottom);
+}
+
+void
+Atlas::placeGlyphs(std::vector<AtlasGlyph>& glyphs,
+                   PathfinderFont& font,
+                   float pixelsPerUnit,
+                   float rotationAngle,
+                   const Hint& hint,
+                   kraken::Vector2 emboldenAmount)
+{
+  mGeneration++;
+  mCompactionDoesNotFit = false;
 
   for (AtlasGlyph& glyph: glyphs) {
+    // Glyphs that already have a slot keep it; their pixels are still valid.
+    map<SlotKey, AtlasSlot>::iterator slot = mSlots.find(slotKeyForGlyph(glyph.getGlyphKey()));
+    if (slot != mSlots.end()) {
+      glyph.setOrigin(slot->second.origin);
+      slot->second.generation = mGeneration;
+      continue;
+    }
+
     // Place the glyph, and advance the origin.
     FT_BBox metrics = font.metricsForGlyph(glyph.getGlyphKey().getID());
 
     UnitMetrics unitMetrics(metrics, rotationAngle, emboldenAmount);
-    glyph.setPixelLowerLeft(nextOrigin, unitMetrics, pixelsPerUnit);
+    glyph.setPixelLowerLeft(mNextOrigin, unitMetrics, pixelsPerUnit);
 
     Vector2 pixelOrigin = glyph.calculateSubpixelOrigin(pixelsPerUnit);
     Vector4 pixelRect = calculatePixelRectForGlyph(unitMetrics,
                           pixelOrigin,
                           pixelsPerUnit,
                           hint);
-    nextOrigin[0] = pixelRect[2] + 1.0f;
+    mNextOrigin[0] = pixelRect[2] + 1.0f;
 
     // If the glyph overflowed the shelf, make a new one and reposition the glyph.
-    if (nextOrigin[0] > ATLAS_SIZE[0]) {
-        nextOrigin = Vector2::Create(1.0f, shelfBottom + 1.0f);
-        glyph.setPixelLowerLeft(nextOrigin, unitMetrics, pixelsPerUnit);
+    if (mNextOrigin[0] > ATLAS_SIZE[0]) {
+        mNextOrigin = Vector2::Create(1.0f, mShelfBottom + 1.0f);
+        glyph.setPixelLowerLeft(mNextOrigin, unitMetrics, pixelsPerUnit);
         pixelOrigin = glyph.calculateSubpixelOrigin(pixelsPerUnit);
         pixelRect = calculatePixelRectForGlyph(unitMetrics,
                                                pixelOrigin,
                                                pixelsPerUnit,
                                                hint);
-        nextOrigin[0] = pixelRect[2] + 1.0f;
+        mNextOrigin[0] = pixelRect[2] + 1.0f;
     }
 
     // Grow the shelf as necessary.
     float glyphBottom = pixelRect[3];
-    shelfBottom = max(shelfBottom, glyphBottom + 1.0f);
+    mShelfBottom = max(mShelfBottom, glyphBottom + 1.0f);
+
+    AtlasSlot newSlot;
+    newSlot.origin = glyph.getOrigin();
+    newSlot.pixelRect = pixelRect;
+    newSlot.pixelsPerUnit = pixelsPerUnit;
+    newSlot.generation = mGeneration;
+    mSlots[slotKeyForGlyph(glyph.getGlyphKey())] = newSlot;
+    addDirtyRect(pixelRect);
+
+    // The compacted layout wouldn't include the new glyph.
+    abortCompaction();
   }
 
-  // FIXME(pcwalton): Could be more precise if we don't have a full row.
-  mUsedSize = Vector2i::Create(ATLAS_SIZE[0], shelfBottom);
+  evictStaleSlotsInDirtyRect();
+}
+
+Atlas::SlotKey
+Atlas::slotKeyForGlyph(const GlyphKey& aGlyphKey)
+{
+  return SlotKey(aGlyphKey.getFontSize(), aGlyphKey.getSortKey());
+}
+
+void
+Atlas::reset()
+{
+  abortCompaction();
+  mCompactionDoesNotFit = false;
+  mSlots.clear();
+  mNextOrigin = Vector2::One();
+  mShelfBottom = 2.0f;
+  mUsedSize = Vector2i::Zero();
+  mDirtyRect = Vector4::Zero();
+}
+
+bool
+Atlas::save(const std::string& aPath, GLuint aFramebuffer, __uint64_t aConfigHash)
+{
+  // Pixels under the dirty rect have not been rendered yet.
+  assert(!hasDirtyRect());
+
+  AtlasSnapshotHeader header;
+  header.fourCC = ATLAS_SNAPSHOT_FOURCC;
+  header.version = ATLAS_SNAPSHOT_VERSION;
+  header.configHash = aConfigHash;
+  header.colorAlphaFormat = mColorAlphaFormat;
+  header.slotCount = mSlots.size();
+  header.usedWidth = mUsedSize[0];
+  header.usedHeight = mUsedSize[1];
+  header.nextOrigin[0] = mNextOrigin[0];
+  header.nextOrigin[1] = mNextOrigin[1];
+  header.shelfBottom = mShelfBottom;
+
+  vector<__uint8_t> headerAndSlots;
+  writeSnapshotHeader(headerAndSlots, header);
+  for (const pair<const SlotKey, AtlasSlot>& slot: mSlots) {
+    AtlasSnapshotSlot snapshotSlot;
+    snapshotSlot.fontSize = slot.first.first;
+    snapshotSlot.sortKey = slot.first.second;
+    for (int i = 0; i < 2; i++) {
+      snapshotSlot.origin[i] = slot.second.origin[i];
+    }
+    for (int i = 0; i < 4; i++) {
+      snapshotSlot.pixelRect[i] = slot.second.pixelRect[i];
+    }
+    snapshotSlot.pixelsPerUnit = slot.second.pixelsPerUnit;
+    writeSnapshotSlot(headerAndSlots, snapshotSlot);
+  }
+
+  // ATLAS_SIZE[0] is a multiple of 4, so rows are already tightly packed
+  // under the default pack alignment.
+  vector<__uint8_t> pixels(mUsedSize[0] * mUsedSize[1] * getBytesPerPixel());
+  if (!pixels.empty()) {
+    GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, aFramebuffer));
+    GLDEBUG(glReadPixels(0, 0, mUsedSize[0], mUsedSize[1],
+                         getTextureFormat(), GL_UNSIGNED_BYTE, &pixels[0]));
+  }
+
+  ofstream file(aPath, ios::binary | ios::trunc);
+  if (!file) {
+    return false;
+  }
+  file.write((const char*)&headerAndSlots[0], headerAndSlots.size());
+  if (!pixels.empty()) {
+    file.write((const char*)&pixels[0], pixels.size());
+  }
+  return file.good();
+}
+
+bool
+Atlas::restore(const std::string& aPath, __uint64_t aConfigHash)
+{
+  ifstream file(aPath, ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  __uint8_t headerData[ATLAS_SNAPSHOT_HEADER_SIZE];
+  if (!file.read((char*)headerData, sizeof(headerData))) {
+    return false;
+  }
+  AtlasSnapshotHeader header;
+  readSnapshotHeader(headerData, header);
+  if (header.fourCC != ATLAS_SNAPSHOT_FOURCC ||
+      header.version != ATLAS_SNAPSHOT_VERSION ||
+      header.configHash != aConfigHash ||
+      header.colorAlphaFormat != (__uint32_t)mColorAlphaFormat) {
+    return false;
+  }
+  if (header.usedWidth < 0 || header.usedWidth > ATLAS_SIZE[0] ||
+      header.usedHeight < 0 || header.usedHeight > ATLAS_SIZE[1]) {
+    return false;
+  }
+  // The negated comparisons also reject NaNs.
+  if (!(header.nextOrigin[0] >= 0.0f && header.nextOrigin[0] <= ATLAS_SIZE[0] + 1.0f) ||
+      !(header.nextOrigin[1] >= 0.0f && header.nextOrigin[1] <= ATLAS_SIZE[1] + 1.0f) ||
+      !(header.shelfBottom >= 0.0f && header.shelfBottom <= ATLAS_SIZE[1] + 1.0f)) {
+    return false;
+  }
+
+  // A truncated or corrupt file must not get to size the allocations below.
+  size_t pixelsSize = (size_t)header.usedWidth * header.usedHeight * getBytesPerPixel();
+  size_t expectedSize = ATLAS_SNAPSHOT_HEADER_SIZE +
+                        (size_t)header.slotCount * ATLAS_SNAPSHOT_SLOT_SIZE +
+                        pixelsSize;
+  file.seekg(0, ios::end);
+  streamoff fileSize = file.tellg();
+  file.seekg(ATLAS_SNAPSHOT_HEADER_SIZE);
+  if (!file || fileSize != (streamoff)expectedSize) {
+    return false;
+  }
+
+  vector<__uint8_t> slotData((size_t)header.slotCount * ATLAS_SNAPSHOT_SLOT_SIZE);
+  if (!slotData.empty() && !file.read((char*)&slotData[0], slotData.size())) {
+    return false;
+  }
+  vector<AtlasSnapshotSlot> slots(header.slotCount);
+  for (size_t i = 0; i < slots.size(); i++) {
+    readSnapshotSlot(&slotData[i * ATLAS_SNAPSHOT_SLOT_SIZE], slots[i]);
+    // Compaction and the composite read whatever the rects cover.
+    const float* rect = slots[i].pixelRect;
+    if (!(rect[0] >= 0.0f && rect[0] <= rect[2] && rect[2] <= header.usedWidth) ||
+        !(rect[1] >= 0.0f && rect[1] <= rect[3] && rect[3] <= header.usedHeight)) {
+      return false;
+    }
+  }
+  vector<__uint8_t> pixels(pixelsSize);
+  if (!pixels.empty() && !file.read((char*)&pixels[0], pixels.size())) {
+    return false;
+  }
+
+  if (!pixels.empty()) {
+    GLDEBUG(GLState::bindTexture(GL_TEXTURE_2D, mTexture));
+    GLDEBUG(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+                            header.usedWidth, header.usedHeight,
+                            getTextureFormat(), GL_UNSIGNED_BYTE, &pixels[0]));
+  }
+
+  abortCompaction();
+  mCompactionDoesNotFit = false;
+  mSlots.clear();
+  for (const AtlasSnapshotSlot& snapshotSlot: slots) {
+    AtlasSlot slot;
+    slot.origin = Vector2::Create(snapshotSlot.origin[0], snapshotSlot.origin[1]);
+    slot.pixelRect = Vector4::Create(snapshotSlot.pixelRect[0],
+                                     snapshotSlot.pixelRect[1],
+                                     snapshotSlot.pixelRect[2],
+                                     snapshotSlot.pixelRect[3]);
+    slot.pixelsPerUnit = snapshotSlot.pixelsPerUnit;
+    slot.generation = mGeneration;
+    mSlots[SlotKey(snapshotSlot.fontSize, snapshotSlot.sortKey)] = slot;
+  }
+  mNextOrigin = Vector2::Create(header.nextOrigin[0], header.nextOrigin[1]);
+  mShelfBottom = header.shelfBottom;
+  mUsedSize = Vector2i::Create(header.usedWidth, header.usedHeight);
+  mDirtyRect = Vector4::Zero();
+  return true;
+}
+
+bool
+Atlas::getNeedsCompaction() const
+{
+  if (mCompaction || mCompactionDoesNotFit || hasDirtyRect()) {
+    return false;
+  }
+  if (mShelfBottom < ATLAS_SIZE[1] * ATLAS_COMPACTION_FILL_THRESHOLD) {
+    return false;
+  }
+  float liveArea = 0.0f;
+  for (const pair<const SlotKey, AtlasSlot>& slot: mSlots) {
+    if (slot.second.generation == mGeneration) {
+      const Vector4& rect = slot.second.pixelRect;
+      liveArea += (rect[2] - rect[0]) * (rect[3] - rect[1]);
+    }
+  }
+  return liveArea < ATLAS_SIZE[0] * mShelfBottom * ATLAS_COMPACTION_LIVE_THRESHOLD;
+}
+
+bool
+Atlas::isCompacting() const
+{
+  return mCompaction != nullptr;
+}
+
+void
+Atlas::beginCompaction()
+{
+  // Pixels under the dirty rect have not been rendered yet.
+  assert(!hasDirtyRect());
+
+  vector<SlotKey> liveSlots;
+  for (const pair<const SlotKey, AtlasSlot>& slot: mSlots) {
+    if (slot.second.generation == mGeneration) {
+      liveSlots.push_back(slot.first);
+    }
+  }
+
+  // Pack the tallest glyphs first so that shelves waste less height.
+  struct {
+    const map<SlotKey, AtlasSlot>* slots;
+    bool operator()(const SlotKey& a, const SlotKey& b) const
+    {
+      const Vector4& rectA = slots->at(a).pixelRect;
+      const Vector4& rectB = slots->at(b).pixelRect;
+      return rectA[3] - rectA[1] > rectB[3] - rectB[1];
+    }
+  } tallerThan;
+  tallerThan.slots = &mSlots;
+  std::sort(liveSlots.begin(), liveSlots.end(), tallerThan);
+
+  // Shelf-pack every slot exactly like placeGlyphs() would before touching
+  // the GPU, so that a repack which overflows the texture is never started.
+  unique_ptr<AtlasCompaction> compaction = make_unique<AtlasCompaction>();
+  compaction->nextCopy = 0;
+  compaction->nextOrigin = Vector2::One();
+  compaction->shelfBottom = 2.0f;
+  for (const SlotKey& slotKey: liveSlots) {
+    const Vector4& rect = mSlots.at(slotKey).pixelRect;
+    Vector2 destOrigin = compaction->nextOrigin;
+    if (destOrigin[0] + rect[2] - rect[0] > ATLAS_SIZE[0]) {
+      destOrigin = Vector2::Create(1.0f, compaction->shelfBottom + 1.0f);
+    }
+    if (destOrigin[1] + rect[3] - rect[1] > ATLAS_SIZE[1]) {
+      mCompactionDoesNotFit = true;
+      return;
+    }
+    compaction->copies.push_back(make_pair(slotKey, destOrigin));
+    compaction->nextOrigin = Vector2::Create(destOrigin[0] + rect[2] - rect[0] + 1.0f,
+                                             destOrigin[1]);
+    compaction->shelfBottom = max(compaction->shelfBottom,
+                                  destOrigin[1] + rect[3] - rect[1] + 1.0f);
+  }
+  mCompaction = std::move(compaction);
+
+  if (!mCompactionTexture) {
+    mCompactionTexture = createFramebufferColorTexture(ATLAS_SIZE[0],
+                                                       ATLAS_SIZE[1],
+                                                       mColorAlphaFormat,
+                                                       GL_NEAREST);
+  }
+  if (!mCompactionReadFramebuffer) {
+    GLDEBUG(glCreateFramebuffers(1, &mCompactionReadFramebuffer));
+    GLDEBUG(glCreateFramebuffers(1, &mCompactionDrawFramebuffer));
+  }
+
+  // The textures trade places after every compaction, so attach them anew.
+  GLDEBUG(GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, mCompactionReadFramebuffer));
+  GLDEBUG(glFramebufferTexture2D(GL_READ_FRAMEBUFFER,
+                                 GL_COLOR_ATTACHMENT0,
+                                 GL_TEXTURE_2D,
+                                 mTexture,
+                                 0));
+  GLDEBUG(GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, mCompactionDrawFramebuffer));
+  GLDEBUG(glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER,
+                                 GL_COLOR_ATTACHMENT0,
+                                 GL_TEXTURE_2D,
+                                 mCompactionTexture,
+                                 0));
+
+  // Clear out whatever the previous texture left behind.
+  GLDEBUG(GLState::disable(GL_SCISSOR_TEST));
+  GLDEBUG(GLState::clearColor(0.0f, 0.0f, 0.0f, 0.0f));
+  GLDEBUG(glClear(GL_COLOR_BUFFER_BIT));
+}
+
+bool
+Atlas::continueCompaction(std::chrono::steady_clock::duration aBudget)
+{
+  if (!mCompaction) {
+    return false;
+  }
+  chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + aBudget;
+
+  GLDEBUG(GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, mCompactionReadFramebuffer));
+  GLDEBUG(GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, mCompactionDrawFramebuffer));
+  GLDEBUG(GLState::disable(GL_SCISSOR_TEST));
+
+  // Always move at least one slot so that a tiny budget still makes progress.
+  while (mCompaction->nextCopy < mCompaction->copies.size()) {
+    const pair<SlotKey, Vector2>& copy = mCompaction->copies[mCompaction->nextCopy++];
+    SlotKey slotKey = copy.first;
+    Vector2 destOrigin = copy.second;
+    AtlasSlot slot = mSlots.at(slotKey);
+
+    Vector4 rect = slot.pixelRect;
+    copyToCompactionTexture(rect, destOrigin);
+
+    Vector2 offset = Vector2::Create(destOrigin[0] - rect[0], destOrigin[1] - rect[1]);
+    slot.pixelRect = Vector4::Create(rect[0] + offset[0],
+                                     rect[1] + offset[1],
+                                     rect[2] + offset[0],
+                                     rect[3] + offset[1]);
+    slot.origin += offset / slot.pixelsPerUnit;
+    mCompaction->slots[slotKey] = slot;
+
+    if (chrono::steady_clock::now() >= deadline) {
+      break;
+    }
+  }
+  if (mCompaction->nextCopy < mCompaction->copies.size()) {
+    return false;
+  }
+
+  std::swap(mTexture, mCompactionTexture);
+  mSlots.swap(mCompaction->slots);
+  mNextOrigin = mCompaction->nextOrigin;
+  mShelfBottom = mCompaction->shelfBottom;
+  mUsedSize = Vector2i::Create(ATLAS_SIZE[0], mShelfBottom);
+  mCompaction.reset();
+  // The old texture is allocated afresh by the next compaction, rather than
+  // doubling the atlas memory in between.
+  releaseCompactionTexture();
+  return true;
+}
+
+void
+Atlas::abortCompaction()
+{
+  if (mCompaction) {
+    mCompaction.reset();
+    releaseCompactionTexture();
+  }
+}
+
+void
+Atlas::releaseCompactionTexture()
+{
+  if (!mCompactionTexture) {
+    return;
+  }
+  GLDEBUG(GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, mCompactionReadFramebuffer));
+  GLDEBUG(glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0));
+  GLDEBUG(GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, mCompactionDrawFramebuffer));
+  GLDEBUG(glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0));
+  GLDEBUG(GLState::deleteTextures(1, &mCompactionTexture));
+  mCompactionTexture = 0;
+}
+
+void
+Atlas::copyToCompactionTexture(const kraken::Vector4& aPixelRect, kraken::Vector2 aDestOrigin)
+{
+  GLint srcX = max(aPixelRect[0], 0.0f);
+  GLint srcY = max(aPixelRect[1], 0.0f);
+  GLsizei width = min(aPixelRect[2], (float)ATLAS_SIZE[0]) - srcX;
+  GLsizei height = min(aPixelRect[3], (float)ATLAS_SIZE[1]) - srcY;
+  GLint destX = aDestOrigin[0] + (srcX - aPixelRect[0]);
+  GLint destY = aDestOrigin[1] + (srcY - aPixelRect[1]);
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+
+#ifdef GL_VERSION_4_3
+  if (mSupportsCopyImage) {
+    GLDEBUG(glCopyImageSubData(mTexture, GL_TEXTURE_2D, 0, srcX, srcY, 0,
+                               mCompactionTexture, GL_TEXTURE_2D, 0, destX, destY, 0,
+                               width, height, 1));
+    return;
+  }
+#endif
+  GLDEBUG(glBlitFramebuffer(srcX, srcY, srcX + width, srcY + height,
+                            destX, destY, destX + width, destY + height,
+                            GL_COLOR_BUFFER_BIT, GL_NEAREST));
+}
+
+GLenum
+Atlas::getTextureFormat() const
+{
+  return mColorAlphaFormat == caf_R8 ? GL_RED : GL_RGBA;
+}
+
+int
+Atlas::getBytesPerPixel() const
+{
+  return mColorAlphaFormat == caf_R8 ? 1 : 4;
+}
+
+void
+Atlas::addDirtyRect(const kraken::Vector4& aPixelRect)
+{
+  // Include the one pixel gutter around the glyph so that stale coverage left
+  // behind by an evicted neighbor gets cleared too.
+  Vector4 rect = Vector4::Create(max(aPixelRect[0] - 1.0f, 0.0f),
+                                 max(aPixelRect[1] - 1.0f, 0.0f),
+                                 min(aPixelRect[2] + 1.0f, (float)ATLAS_SIZE[0]),
+                                 min(aPixelRect[3] + 1.0f, (float)ATLAS_SIZE[1]));
+  if (!hasDirtyRect()) {
+    mDirtyRect = rect;
+    return;
+  }
+  mDirtyRect = Vector4::Create(min(mDirtyRect[0], rect[0]),
+                               min(mDirtyRect[1], rect[1]),
+                               max(mDirtyRect[2], rect[2]),
+                               max(mDirtyRect[3], rect[3]));
+}
+
+void
+Atlas::evictStaleSlotsInDirtyRect()
+{
+  if (!hasDirtyRect()) {
+    return;
+  }
+
+  // The dirty rect is cleared before it is redrawn, and only glyphs in the
+  // current layout have path IDs to redraw them with. Slots of glyphs that
+  // are no longer laid out lose their pixels, so forget them.
+  map<SlotKey, AtlasSlot>::iterator slot = mSlots.begin();
+  while (slot != mSlots.end()) {
+    if (slot->second.generation != mGeneration &&
+        rectsIntersect(slot->second.pixelRect, mDirtyRect)) {
+      slot = mSlots.erase(slot);
+    } else {
+      ++slot;
+    }
+  }
+}
+
+kraken::Vector4
+Atlas::getDirtyRect() const
+{
+  return mDirtyRect;
+}
+
+bool
+Atlas::hasDirtyRect() const
+{
+  return mDirtyRect[2] > mDirtyRect[0] && mDirtyRect[3] > mDirtyRect[1];
+}
+
+void
+Atlas::clearDirtyRect()
+{
+  mDirtyRect = Vector4::Zero();
+}
+
+bool
+Atlas::isGlyphDirty(const GlyphKey& aGlyphKey) const
+{
+  if (!hasDirtyRect()) {
+    return false;
+  }
+  map<SlotKey, AtlasSlot>::const_iterator slot = mSlots.find(slotKeyForGlyph(aGlyphKey));
+  if (slot == mSlots.end()) {
+    return false;
+  }
+  return rectsIntersect(slot->second.pixelRect, mDirtyRect);
 }
 
 GLuint
@@ -107,6 +740,12 @@ Atlas::getTexture()
   return mTexture;
 }
 
+ColorAlphaFormat
+Atlas::getColorAlphaFormat() const
+{
+  return mColorAlphaFormat;
+}
+
 kraken::Vector2i
 Atlas::getUsedSize() const
 {
@@ -137,6 +776,12 @@ AtlasGlyph::getOrigin()
   return mOrigin;
 }
 
+void
+AtlasGlyph::setOrigin(kraken::Vector2 aOrigin)
+{
+  mOrigin = aOrigin;
+}
+
 kraken::Vector2
 AtlasGlyph::calculateSubpixelOrigin(float pixelsPerUnit) const
 {
@@ -168,9 +813,10 @@ AtlasGlyph::getPathID() const
   return mGlyphStoreIndex * SUBPIXEL_GRANULARITY + mGlyphKey.getSubpixel() + 1;
 }
 
-GlyphKey::GlyphKey(int aID, int aSubpixel)
+GlyphKey::GlyphKey(int aID, int aSubpixel, float aFontSize)
   : mID(aID)
   , mSubpixel(aSubpixel)
+  , mFontSize(aFontSize)
 {
 
 }
@@ -187,6 +833,12 @@ GlyphKey::getSubpixel() const
   return mSubpixel;
 }
 
+float
+GlyphKey::getFontSize() const
+{
+  return mFontSize;
+}
+
 int
 GlyphKey::getSortKey() const
 {
@@ -12,12 +12,18 @@
 #define PATHFINDER_ATLAS_H
 
 #include "platform.h"
+#include "gl-utils.h"
 #include <hydra.h>
 #include <vector>
+#include <map>
+#include <memory>
+#include <string>
+#include <chrono>
 
 namespace pathfinder {
 
 class AtlasGlyph;
+class GlyphKey;
 class PathfinderFont;
 class Hint;
 class RenderContext;
@@ -33,31 +39,118 @@ public:
   ~Atlas();
   Atlas(const Atlas&) = delete;
   Atlas& operator=(const Atlas&) = delete;
-  bool init(RenderContext& renderContext);
+  bool init(RenderContext& renderContext, ColorAlphaFormat aColorAlphaFormat);
+  // Places any glyphs that don't have a slot yet and restores the origins of
+  // those that do. Newly placed glyphs grow the dirty rect. If they don't
+  // fit, every slot not used by these glyphs is dropped first.
   void layoutGlyphs(std::vector<AtlasGlyph>& glyphs,
                     PathfinderFont& font,
                     float pixelsPerUnit,
                     float rotationAngle,
                     const Hint& hint,
                     kraken::Vector2 emboldenAmount);
+  // Forgets every slot. Call this whenever the rasterization parameters change.
+  void reset();
+
+  // Writes the used part of the atlas and its slot table to a file. The atlas
+  // must be fully rendered and attached to aFramebuffer. aConfigHash
+  // identifies the rasterization parameters the pixels were rendered with.
+  bool save(const std::string& aPath, GLuint aFramebuffer, __uint64_t aConfigHash);
+  // Replaces the atlas contents with a file written by save(). Fails, leaving
+  // the atlas untouched, if the file was rendered with a different
+  // aConfigHash or color format.
+  bool restore(const std::string& aPath, __uint64_t aConfigHash);
+
+  // Compaction repacks the glyphs used by the latest layout into a second
+  // texture by copying their pixels, and drops every other slot. It runs in
+  // steps so that its cost can be spread over several frames, and is
+  // abandoned if a new glyph has to be placed in the meantime. The second
+  // texture only exists while a compaction is in progress.
+  bool getNeedsCompaction() const;
+  bool isCompacting() const;
+  void beginCompaction();
+  // Copies slots until aBudget is used up. Returns true once the compaction
+  // is done and getTexture() has changed.
+  bool continueCompaction(std::chrono::steady_clock::duration aBudget);
 
   GLuint getTexture();
+  ColorAlphaFormat getColorAlphaFormat() const;
   kraken::Vector2i getUsedSize() const;
+
+  // The region that must be cleared and re-rendered, as (left, bottom, right,
+  // top) in atlas pixels. Empty when the atlas is up to date.
+  kraken::Vector4 getDirtyRect() const;
+  bool hasDirtyRect() const;
+  void clearDirtyRect();
+  // Whether the slot for the given glyph overlaps the dirty rect and thus has
+  // to be redrawn.
+  bool isGlyphDirty(const GlyphKey& aGlyphKey) const;
+
 private:
+  struct AtlasSlot {
+    kraken::Vector2 origin;
+    kraken::Vector4 pixelRect;
+    float pixelsPerUnit;
+    unsigned int generation;
+  };
+  // Glyphs are cached per rasterized font size, then per GlyphKey::getSortKey().
+  typedef std::pair<float, int> SlotKey;
+
+  struct AtlasCompaction {
+    // Each slot to copy and where it goes, planned up front.
+    std::vector<std::pair<SlotKey, kraken::Vector2>> copies;
+    size_t nextCopy;
+    std::map<SlotKey, AtlasSlot> slots;
+    kraken::Vector2 nextOrigin;
+    float shelfBottom;
+  };
+
+  static SlotKey slotKeyForGlyph(const GlyphKey& aGlyphKey);
+  void placeGlyphs(std::vector<AtlasGlyph>& glyphs,
+                   PathfinderFont& font,
+                   float pixelsPerUnit,
+                   float rotationAngle,
+                   const Hint& hint,
+                   kraken::Vector2 emboldenAmount);
+  GLenum getTextureFormat() const;
+  int getBytesPerPixel() const;
+  void abortCompaction();
+  void releaseCompactionTexture();
+  void copyToCompactionTexture(const kraken::Vector4& aPixelRect, kraken::Vector2 aDestOrigin);
+  void addDirtyRect(const kraken::Vector4& aPixelRect);
+  void evictStaleSlotsInDirtyRect();
+
   GLuint mTexture;
+  ColorAlphaFormat mColorAlphaFormat;
   kraken::Vector2i mUsedSize;
+  kraken::Vector2 mNextOrigin;
+  float mShelfBottom;
+  kraken::Vector4 mDirtyRect;
+  unsigned int mGeneration;
+  std::map<SlotKey, AtlasSlot> mSlots;
+
+  std::unique_ptr<AtlasCompaction> mCompaction;
+  GLuint mCompactionTexture;
+  GLuint mCompactionReadFramebuffer;
+  GLuint mCompactionDrawFramebuffer;
+  // Set when the live slots of the current generation do not fit a fresh
+  // texture, so that compaction is not attempted again until they change.
+  bool mCompactionDoesNotFit;
+  bool mSupportsCopyImage;
 }; // class Atlas
 
 class GlyphKey
 {
 public:
-  GlyphKey(int aID, int aSubpixel);
+  GlyphKey(int aID, int aSubpixel, float aFontSize);
   int getID() const;
   int getSubpixel() const;
+  float getFontSize() const;
   int getSortKey() const;
 private:
   int mID;
   int mSubpixel; // a value of -1 indicates no subpixel
+  float mFontSize; // the size the glyph is rasterized at
 }; // class GlyphKey
 
 class AtlasGlyph
@@ -67,6 +160,7 @@ public:
   int getGlyphStoreIndex();
   const GlyphKey getGlyphKey() const;
   kraken::Vector2 getOrigin();
+  void setOrigin(kraken::Vector2 aOrigin);
   kraken::Vector2 calculateSubpixelOrigin(float pixelsPerUnit) const;
   void setPixelLowerLeft(kraken::Vector2 pixelLowerLeft, UnitMetrics& metrics, float pixelsPerUnit);
   int getPathID() const;
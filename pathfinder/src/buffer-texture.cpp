@@ -12,6 +12,7 @@
 #include "gl-utils.h"
 #include "platform.h"
 #include "shader-loader.h"
+#include "stream-buffer.h"
 
 #include <assert.h>
 #include <math.h>
@@ -21,15 +22,17 @@ using namespace std;
 
 namespace pathfinder {
 
-PathfinderBufferTexture::PathfinderBufferTexture(UniformID aUniformID, UniformID aUniformDimensionsID)
-  : mTexture(0)
+PathfinderBufferTexture::PathfinderBufferTexture(StreamBuffer& aStreamBuffer, UniformID aUniformID)
+  : mStreamBuffer(aStreamBuffer)
+  , mTexture(0)
   , mUniformID(aUniformID)
-  , mUniformDimensionsID(aUniformDimensionsID)
-  , mSideLength(0)
   , mGLType(0)
   , mDestroyed(false)
+  , mBuffer(0)
+  , mLength(0)
 {
-  GLDEBUG(glCreateTextures(GL_TEXTURE_2D, 1, &mTexture));
+  GLDEBUG(glCreateTextures(GL_TEXTURE_BUFFER, 1, &mTexture));
+  GLDEBUG(glCreateBuffers(1, &mBuffer));
 }
 
 PathfinderBufferTexture::~PathfinderBufferTexture()
@@ -43,94 +46,57 @@ void
 PathfinderBufferTexture::destroy()
 {
   assert(!mDestroyed);
-  GLDEBUG(glDeleteTextures(1, &mTexture));
+  GLDEBUG(GLState::deleteTextures(1, &mTexture));
   mTexture = 0;
+  GLDEBUG(glDeleteBuffers(1, &mBuffer));
+  mBuffer = 0;
   mDestroyed = true;
 }
 
 void
 PathfinderBufferTexture::upload(const vector<float>& data)
 {
-  upload((__uint8_t*)(&data[0]), (GLsizei)data.size(), GL_FLOAT);
+  upload((const __uint8_t*)(&data[0]), (GLsizei)data.size(), GL_FLOAT, Range(0, (int)data.size()));
 }
 
 void
 PathfinderBufferTexture::upload(const vector<__uint8_t>& data)
 {
-  upload((__uint8_t*)(&data[0]), (GLsizei)data.size(), GL_UNSIGNED_BYTE);
+  upload(&data[0], (GLsizei)data.size(), GL_UNSIGNED_BYTE, Range(0, (int)data.size()));
 }
 
 void
-PathfinderBufferTexture::upload(__uint8_t* data, GLsizei length, GLuint glType)
+PathfinderBufferTexture::upload(const vector<float>& data, Range aRange)
 {
-  assert(!mDestroyed);
+  upload((const __uint8_t*)(&data[0]), (GLsizei)data.size(), GL_FLOAT, aRange);
+}
 
-  GLDEBUG(glActiveTexture(GL_TEXTURE0));
-  GLDEBUG(glBindTexture(GL_TEXTURE_2D, mTexture));
-
-  GLsizei areaNeeded = (length + 3) / 4; // Divide by 4, rounding up
-  if (glType != mGLType || areaNeeded > getArea()) {
-      mSideLength = 1;
-      while (mSideLength * mSideLength < areaNeeded) {
-        mSideLength <<= 1;
-      }
-      mGLType = glType;
-      setTextureParameters(GL_NEAREST);
-      GLDEBUG(glTexImage2D(GL_TEXTURE_2D,
-                           0,
-                           glType == GL_FLOAT ? GL_RGBA32F : GL_RGBA,
-                           mSideLength,
-                           mSideLength,
-                           0,
-                           GL_RGBA,
-                           glType,
-                           NULL));
-  }
+void
+PathfinderBufferTexture::upload(const __uint8_t* data, GLsizei length, GLuint glType, Range aRange)
+{
+  assert(!mDestroyed);
 
-  GLsizei mainDimensionsHeight = areaNeeded / mSideLength; 
-  GLsizei remainderDimensionsWidth = areaNeeded % mSideLength;
-  GLsizei splitIndex = mSideLength * mainDimensionsHeight * 4;
-
-  if (mSideLength > 0 && mainDimensionsHeight > 0) {
-    GLDEBUG(glTexSubImage2D(GL_TEXTURE_2D,
-                            0,
-                            0,
-                            0,
-                            mSideLength,
-                            mainDimensionsHeight,
-                            GL_RGBA,
-                            glType,
-                            data));
+  int typeSize = glType == GL_FLOAT ? 4 : 1;
+  GLDEBUG(glBindBuffer(GL_TEXTURE_BUFFER, mBuffer));
+
+  if (glType != mGLType || length != mLength) {
+    // Size the store to whole RGBA texels, and refill all of it.
+    mGLType = glType;
+    mLength = length;
+    GLDEBUG(glBufferData(GL_TEXTURE_BUFFER, (length + 3) / 4 * 4 * typeSize, NULL, GL_DYNAMIC_DRAW));
+    GLDEBUG(GLState::activeTexture(GL_TEXTURE0));
+    GLDEBUG(GLState::bindTexture(GL_TEXTURE_BUFFER, mTexture));
+    GLDEBUG(glTexBuffer(GL_TEXTURE_BUFFER, glType == GL_FLOAT ? GL_RGBA32F : GL_RGBA8, mBuffer));
+    aRange = Range(0, length);
   }
 
-  if (remainderDimensionsWidth > 0) {
-    int typeSize = glType == GL_FLOAT ? 4 : 1;
-    // Round data up to a multiple of 4 elements if necessary.
-    GLsizei remainderLength = length - splitIndex;
-    __uint8_t* remainder = data + splitIndex * typeSize;
-    bool padded = false;
-    if (remainderLength % 4) {
-      GLsizei padLength = 4 - remainderLength % 4;
-      remainder = (__uint8_t*)malloc((remainderLength + padLength) * typeSize);
-      memcpy(remainder, data + splitIndex * typeSize, remainderLength * typeSize);
-      for(int i=0; i<padLength * typeSize; i++) {
-        remainder[remainderLength * typeSize + i] = 0;
-      }
-      padded = true;
-    }
-
-    GLDEBUG(glTexSubImage2D(GL_TEXTURE_2D,
-                    0,
-                    0,
-                    mainDimensionsHeight,
-                    remainderDimensionsWidth,
-                    1,
-                    GL_RGBA,
-                    glType,
-                    remainder));
-    if (padded) {
-      free(remainder);
-    }
+  // Copying out of the stream buffer doesn't wait for draws that still read
+  // the old contents.
+  if (!aRange.isEmpty()) {
+    mStreamBuffer.upload(mBuffer,
+                         aRange.start * typeSize,
+                         data + aRange.start * typeSize,
+                         aRange.length() * typeSize);
   }
 }
 
@@ -139,21 +105,11 @@ PathfinderBufferTexture::bind(PathfinderShaderProgram& aProgram, GLuint textureU
 {
   assert(!mDestroyed);
 
-  GLDEBUG(glActiveTexture(GL_TEXTURE0 + textureUnit));
-  GLDEBUG(glBindTexture(GL_TEXTURE_2D, mTexture));
-  if (aProgram.hasUniform(mUniformDimensionsID)) {
-    GLDEBUG(glUniform2i(aProgram.getUniform(mUniformDimensionsID), mSideLength, mSideLength));
-  }
+  GLDEBUG(GLState::activeTexture(GL_TEXTURE0 + textureUnit));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_BUFFER, mTexture));
   if (aProgram.hasUniform(mUniformID)) {
     GLDEBUG(glUniform1i(aProgram.getUniform(mUniformID), textureUnit));
   }
 }
 
-GLsizei
-PathfinderBufferTexture::getArea()
-{
-  assert(!mDestroyed);
-  return mSideLength * mSideLength;
-}
-
 } // namespace pathfinder
@@ -20,13 +20,18 @@
 #include <string>
 
 #include "shader-loader.h"
+#include "utils.h"
 
 namespace pathfinder {
 
+class StreamBuffer;
+
+// An array of floats or bytes that shaders fetch four at a time by index,
+// as a buffer texture sized to the data.
 class PathfinderBufferTexture
 {
 public:
-  PathfinderBufferTexture(UniformID aUniformID, UniformID aUniformDimensionsID);
+  PathfinderBufferTexture(StreamBuffer& aStreamBuffer, UniformID aUniformID);
   ~PathfinderBufferTexture();
   PathfinderBufferTexture(const PathfinderBufferTexture&) = delete;
   PathfinderBufferTexture& operator=(const PathfinderBufferTexture&) = delete;
@@ -34,18 +39,21 @@ public:
 
   void upload(const std::vector<float>& data);
   void upload(const std::vector<__uint8_t>& data);
+  // Updates only the elements in aRange. The data must be as long as it was
+  // at the last upload.
+  void upload(const std::vector<float>& data, Range aRange);
   void bind(PathfinderShaderProgram& uniforms, GLuint textureUnit);
 
 private:
+  StreamBuffer& mStreamBuffer;
   GLuint mTexture;
   UniformID mUniformID;
-  UniformID mUniformDimensionsID;
-  GLsizei mSideLength;
   GLuint mGLType;
   bool mDestroyed;
+  GLuint mBuffer;
+  GLsizei mLength;
 
-  void upload(__uint8_t* data, GLsizei length, GLuint glType);
-  GLsizei getArea();
+  void upload(const __uint8_t* data, GLsizei length, GLuint glType, Range aRange);
 };
 
 } // namespace pathfinder
@@ -0,0 +1,214 @@
+// pathfinder/src/command-list.cpp
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#include "command-list.h"
+#include "gl-utils.h"
+
+#include <string.h>
+
+using namespace std;
+using namespace kraken;
+
+namespace pathfinder {
+
+CommandList::CommandList()
+{
+}
+
+CommandList::~CommandList()
+{
+}
+
+CommandList::Command&
+CommandList::append(CommandType aType)
+{
+  mCommands.push_back(Command());
+  Command& command = mCommands.back();
+  command.type = aType;
+  for (int i = 0; i < 4; i++) {
+    command.args[i] = 0;
+  }
+  command.dataOffset = 0;
+  return command;
+}
+
+size_t
+CommandList::appendData(const void* aData, size_t aSize)
+{
+  size_t offset = mData.size();
+  mData.resize(offset + aSize);
+  memcpy(&mData[offset], aData, aSize);
+  return offset;
+}
+
+void
+CommandList::enable(GLenum aCap)
+{
+  append(cmd_enable).args[0] = aCap;
+}
+
+void
+CommandList::disable(GLenum aCap)
+{
+  append(cmd_disable).args[0] = aCap;
+}
+
+void
+CommandList::blendEquation(GLenum aMode)
+{
+  append(cmd_blendEquation).args[0] = aMode;
+}
+
+void
+CommandList::blendFuncSeparate(GLenum aSrcRGB, GLenum aDstRGB, GLenum aSrcAlpha, GLenum aDstAlpha)
+{
+  Command& command = append(cmd_blendFuncSeparate);
+  command.args[0] = aSrcRGB;
+  command.args[1] = aDstRGB;
+  command.args[2] = aSrcAlpha;
+  command.args[3] = aDstAlpha;
+}
+
+void
+CommandList::useProgram(GLuint aProgram)
+{
+  append(cmd_useProgram).args[0] = aProgram;
+}
+
+void
+CommandList::bindVertexArray(GLuint aArray)
+{
+  append(cmd_bindVertexArray).args[0] = aArray;
+}
+
+void
+CommandList::bindTexture(GLuint aUnit, GLenum aTarget, GLuint aTexture)
+{
+  Command& command = append(cmd_bindTexture);
+  command.args[0] = aUnit;
+  command.args[1] = aTarget;
+  command.args[2] = aTexture;
+}
+
+void
+CommandList::setTextureFilter(GLint aFilter)
+{
+  append(cmd_setTextureFilter).args[0] = aFilter;
+}
+
+void
+CommandList::uniform1i(GLint aLocation, GLint aValue)
+{
+  Command& command = append(cmd_uniform1i);
+  command.args[0] = aLocation;
+  command.args[1] = aValue;
+}
+
+void
+CommandList::uniform2f(GLint aLocation, float aX, float aY)
+{
+  float values[2] = { aX, aY };
+  Command& command = append(cmd_uniform2f);
+  command.args[0] = aLocation;
+  command.dataOffset = appendData(values, sizeof(values));
+}
+
+void
+CommandList::uniform3f(GLint aLocation, float aX, float aY, float aZ)
+{
+  float values[3] = { aX, aY, aZ };
+  Command& command = append(cmd_uniform3f);
+  command.args[0] = aLocation;
+  command.dataOffset = appendData(values, sizeof(values));
+}
+
+void
+CommandList::uniformMatrix4fv(GLint aLocation, const Matrix4& aMatrix)
+{
+  Command& command = append(cmd_uniformMatrix4fv);
+  command.args[0] = aLocation;
+  command.dataOffset = appendData(aMatrix.c, sizeof(float) * 16);
+}
+
+void
+CommandList::drawArraysInstanced(GLenum aMode, GLint aFirst, GLsizei aCount, GLsizei aInstanceCount)
+{
+  Command& command = append(cmd_drawArraysInstanced);
+  command.args[0] = aMode;
+  command.args[1] = aFirst;
+  command.args[2] = aCount;
+  command.args[3] = aInstanceCount;
+}
+
+void
+CommandList::replay() const
+{
+  for (const Command& command: mCommands) {
+    const GLint* args = command.args;
+    const float* values = (const float*)(mData.data() + command.dataOffset);
+    switch (command.type) {
+    case cmd_enable:
+      GLDEBUG(GLState::enable((GLenum)args[0]));
+      break;
+    case cmd_disable:
+      GLDEBUG(GLState::disable((GLenum)args[0]));
+      break;
+    case cmd_blendEquation:
+      GLDEBUG(GLState::blendEquation((GLenum)args[0]));
+      break;
+    case cmd_blendFuncSeparate:
+      GLDEBUG(GLState::blendFuncSeparate((GLenum)args[0], (GLenum)args[1], (GLenum)args[2], (GLenum)args[3]));
+      break;
+    case cmd_useProgram:
+      GLDEBUG(GLState::useProgram((GLuint)args[0]));
+      break;
+    case cmd_bindVertexArray:
+      GLDEBUG(GLState::bindVertexArray((GLuint)args[0]));
+      break;
+    case cmd_bindTexture:
+      GLDEBUG(GLState::activeTexture(GL_TEXTURE0 + (GLenum)args[0]));
+      GLDEBUG(GLState::bindTexture((GLenum)args[1], (GLuint)args[2]));
+      break;
+    case cmd_setTextureFilter:
+      setTextureParameters((GLint)args[0]);
+      break;
+    case cmd_uniform1i:
+      GLDEBUG(glUniform1i((GLint)args[0], (GLint)args[1]));
+      break;
+    case cmd_uniform2f:
+      GLDEBUG(glUniform2f((GLint)args[0], values[0], values[1]));
+      break;
+    case cmd_uniform3f:
+      GLDEBUG(glUniform3f((GLint)args[0], values[0], values[1], values[2]));
+      break;
+    case cmd_uniformMatrix4fv:
+      GLDEBUG(glUniformMatrix4fv((GLint)args[0], 1, GL_FALSE, values));
+      break;
+    case cmd_drawArraysInstanced:
+      GLDEBUG(glDrawArraysInstanced((GLenum)args[0], (GLint)args[1], (GLsizei)args[2], (GLsizei)args[3]));
+      break;
+    }
+  }
+}
+
+void
+CommandList::reset()
+{
+  mCommands.clear();
+  mData.clear();
+}
+
+bool
+CommandList::isEmpty() const
+{
+  return mCommands.empty();
+}
+
+} // namespace pathfinder
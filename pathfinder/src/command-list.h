@@ -0,0 +1,84 @@
+// pathfinder/src/command-list.h
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#ifndef PATHFINDER_COMMAND_LIST_H
+#define PATHFINDER_COMMAND_LIST_H
+
+#include "platform.h"
+
+#include <hydra.h>
+#include <vector>
+
+namespace pathfinder {
+
+typedef enum {
+  cmd_enable,
+  cmd_disable,
+  cmd_blendEquation,
+  cmd_blendFuncSeparate,
+  cmd_useProgram,
+  cmd_bindVertexArray,
+  cmd_bindTexture,
+  cmd_setTextureFilter,
+  cmd_uniform1i,
+  cmd_uniform2f,
+  cmd_uniform3f,
+  cmd_uniformMatrix4fv,
+  cmd_drawArraysInstanced
+} CommandType;
+
+// A list of GL commands with their arguments. Recording makes no GL calls,
+// so any thread can do it; replay() must run on the thread that owns the
+// context. Recorded object names and uniform locations have to stay valid
+// until the list is replayed.
+class CommandList
+{
+public:
+  CommandList();
+  ~CommandList();
+
+  void enable(GLenum aCap);
+  void disable(GLenum aCap);
+  void blendEquation(GLenum aMode);
+  void blendFuncSeparate(GLenum aSrcRGB, GLenum aDstRGB, GLenum aSrcAlpha, GLenum aDstAlpha);
+  void useProgram(GLuint aProgram);
+  void bindVertexArray(GLuint aArray);
+  // Makes aUnit the active texture unit and binds aTexture to it.
+  void bindTexture(GLuint aUnit, GLenum aTarget, GLuint aTexture);
+  // Sets the filter and edge clamping of the bound 2D texture.
+  void setTextureFilter(GLint aFilter);
+  void uniform1i(GLint aLocation, GLint aValue);
+  void uniform2f(GLint aLocation, float aX, float aY);
+  void uniform3f(GLint aLocation, float aX, float aY, float aZ);
+  void uniformMatrix4fv(GLint aLocation, const kraken::Matrix4& aMatrix);
+  void drawArraysInstanced(GLenum aMode, GLint aFirst, GLsizei aCount, GLsizei aInstanceCount);
+
+  void replay() const;
+  // Drops every recorded command.
+  void reset();
+  bool isEmpty() const;
+
+private:
+  struct Command {
+    CommandType type;
+    GLint args[4];
+    size_t dataOffset; // into mData
+  };
+
+  std::vector<Command> mCommands;
+  std::vector<__uint8_t> mData;
+
+  Command& append(CommandType aType);
+  size_t appendData(const void* aData, size_t aSize);
+};
+
+} // namespace pathfinder
+
+#endif // PATHFINDER_COMMAND_LIST_H
@@ -0,0 +1,245 @@
+// pathfinder/src/compute-strategy.cpp
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#include "compute-strategy.h"
+
+#include "renderer.h"
+#include "buffer-texture.h"
+#include "gl-utils.h"
+#include "meshes.h"
+#include "xcaa-strategy.h"
+
+#include <hydra.h>
+
+using namespace std;
+using namespace kraken;
+
+namespace pathfinder {
+
+// Must match TILE_SIZE in the fill shaders.
+const int COVERAGE_TILE_SIZE = 16;
+// Local sizes of the fill shaders.
+const int ACCUMULATE_GROUP_SIZE = 64;
+const int RESOLVE_GROUP_SIZE = COVERAGE_TILE_SIZE;
+
+ComputeAAStrategy::ComputeAAStrategy(int aLevel, SubpixelAAType aSubpixelAA)
+  : AntialiasingStrategy(aSubpixelAA)
+  , mSegmentsTexture(0)
+  , mSegmentNormalsTexture(0)
+  , mSegmentPathIDsTexture(0)
+  , mCoverageBuffer(0)
+  , mCoverageBufferCapacity(0)
+{
+  mSupersampledFramebufferSize.init();
+  for (int i = 0; i < 4; i++) {
+    mCoverageRect[i] = 0;
+  }
+}
+
+ComputeAAStrategy::~ComputeAAStrategy()
+{
+  if (mSegmentsTexture) {
+    GLDEBUG(GLState::deleteTextures(1, &mSegmentsTexture));
+    mSegmentsTexture = 0;
+  }
+  if (mSegmentNormalsTexture) {
+    GLDEBUG(GLState::deleteTextures(1, &mSegmentNormalsTexture));
+    mSegmentNormalsTexture = 0;
+  }
+  if (mSegmentPathIDsTexture) {
+    GLDEBUG(GLState::deleteTextures(1, &mSegmentPathIDsTexture));
+    mSegmentPathIDsTexture = 0;
+  }
+  if (mCoverageBuffer) {
+    GLDEBUG(glDeleteBuffers(1, &mCoverageBuffer));
+    mCoverageBuffer = 0;
+  }
+}
+
+bool
+ComputeAAStrategy::init(Renderer& renderer)
+{
+  if (!AntialiasingStrategy::init(renderer)) {
+    return false;
+  }
+#ifdef GL_VERSION_4_3
+  GLDEBUG(glCreateTextures(GL_TEXTURE_BUFFER, 1, &mSegmentsTexture));
+  GLDEBUG(glCreateTextures(GL_TEXTURE_BUFFER, 1, &mSegmentNormalsTexture));
+  GLDEBUG(glCreateTextures(GL_TEXTURE_BUFFER, 1, &mSegmentPathIDsTexture));
+  GLDEBUG(glCreateBuffers(1, &mCoverageBuffer));
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+ComputeAAStrategy::attachMeshes(RenderContext& renderContext, Renderer& renderer)
+{
+#ifdef GL_VERSION_4_3
+  if (!renderer.getMeshesAttached()) {
+    return;
+  }
+  PathfinderPackedMeshBuffers& meshBuffers = *renderer.getMeshBuffers()[0];
+
+  // Each segment is three points, and so three texels.
+  GLDEBUG(GLState::activeTexture(GL_TEXTURE0));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_BUFFER, mSegmentsTexture));
+  GLDEBUG(glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, meshBuffers.stencilSegments));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_BUFFER, mSegmentNormalsTexture));
+  GLDEBUG(glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, meshBuffers.stencilNormals));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_BUFFER, mSegmentPathIDsTexture));
+  GLDEBUG(glTexBuffer(GL_TEXTURE_BUFFER, GL_R16UI, meshBuffers.stencilSegmentPathIDs));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_BUFFER, 0));
+#endif
+}
+
+void
+ComputeAAStrategy::setFramebufferSize(Renderer& renderer)
+{
+  Vector2i destFramebufferSize = renderer.getAtlasAllocatedSize();
+  mSupersampledFramebufferSize = Vector2i::Create(destFramebufferSize.x * getSupersampleScale().x,
+                                                  destFramebufferSize.y * getSupersampleScale().y);
+}
+
+Matrix4
+ComputeAAStrategy::getTransform() const
+{
+  return Matrix4::Identity();
+}
+
+DirectRenderingMode
+ComputeAAStrategy::getDirectRenderingMode() const
+{
+  return drm_none;
+}
+
+void
+ComputeAAStrategy::antialiasObject(Renderer& renderer, int objectIndex)
+{
+#ifdef GL_VERSION_4_3
+  if (renderer.getMeshes().size() == 0) {
+    return;
+  }
+
+  // Every object overwrites the whole dirty rect, so its coverage starts
+  // from nothing even if none of its segments are redrawn.
+  initCoverageBuffer(renderer);
+
+  // Only accumulate the segments of the paths that are being redrawn.
+  Range pathRange = renderer.pathRangeForObject(objectIndex);
+  std::vector<Range>& segmentRanges = renderer.getMeshes()[0]->stencilSegmentPathRanges;
+  int firstSegment = calculateStartFromIndexRanges(pathRange, segmentRanges);
+  int count = calculateCountFromIndexRanges(pathRange, segmentRanges);
+  if (count <= 0) {
+    return;
+  }
+
+  PathfinderShaderProgram& program = *renderer.getRenderContext()->getShaderManager().getProgram(program_fillAccumulate);
+  GLDEBUG(GLState::useProgram(program.getProgram()));
+  GLDEBUG(glUniform2i(program.getUniform(uniform_uFramebufferSize),
+                      mSupersampledFramebufferSize[0],
+                      mSupersampledFramebufferSize[1]));
+  setCoverageUniforms(program);
+  GLDEBUG(glUniform1i(program.getUniform(uniform_uFirstSegment), firstSegment));
+  GLDEBUG(glUniform1i(program.getUniform(uniform_uSegmentCount), count));
+  renderer.getPathTransformBufferTextures()[0]->ext->bind(program, 0);
+  renderer.getPathTransformBufferTextures()[0]->st->bind(program, 1);
+  bindSegmentTexture(program, uniform_uSegments, mSegmentsTexture, 2);
+  bindSegmentTexture(program, uniform_uSegmentNormals, mSegmentNormalsTexture, 3);
+  bindSegmentTexture(program, uniform_uSegmentPathIDs, mSegmentPathIDsTexture, 4);
+
+  GLDEBUG(glDispatchCompute((count + ACCUMULATE_GROUP_SIZE - 1) / ACCUMULATE_GROUP_SIZE, 1, 1));
+  GLDEBUG(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+#endif
+}
+
+void
+ComputeAAStrategy::resolveAAForObject(Renderer& renderer, int objectIndex)
+{
+#ifdef GL_VERSION_4_3
+  if (renderer.getMeshes().size() == 0) {
+    return;
+  }
+
+  PathfinderShaderProgram& program = *renderer.getRenderContext()->getShaderManager().getProgram(program_fillResolve);
+  GLDEBUG(GLState::useProgram(program.getProgram()));
+  setCoverageUniforms(program);
+  GLDEBUG(glUniform1i(program.getUniform(uniform_uSupersampleScale), getSupersampleScale().x));
+  GLDEBUG(glUniform4fv(program.getUniform(uniform_uBGColor), 1, renderer.getBGColor().c));
+  GLDEBUG(glUniform4fv(program.getUniform(uniform_uFGColor), 1, renderer.getFGColor().c));
+  setSubpixelAAKernelUniform(renderer, program);
+
+  // The atlas texture's unsized format resolves to one of these.
+  GLenum imageFormat = renderer.getAtlasColorAlphaFormat() == caf_R8 ? GL_R8 : GL_RGBA8;
+  GLDEBUG(glBindImageTexture(0, renderer.getAtlasTexture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, imageFormat));
+  GLDEBUG(glUniform1i(program.getUniform(uniform_uAtlas), 0));
+
+  // One invocation per atlas column.
+  int columnCount = mCoverageRect[2] / getSupersampleScale().x;
+  GLDEBUG(glDispatchCompute((columnCount + RESOLVE_GROUP_SIZE - 1) / RESOLVE_GROUP_SIZE, 1, 1));
+
+  // The atlas is next sampled by the composite, copied by compaction or
+  // drawn to by another strategy.
+  GLDEBUG(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT |
+                          GL_TEXTURE_UPDATE_BARRIER_BIT |
+                          GL_FRAMEBUFFER_BARRIER_BIT));
+#endif
+}
+
+void
+ComputeAAStrategy::initCoverageBuffer(Renderer& renderer)
+{
+#ifdef GL_VERSION_4_3
+  Vector4 dirtyRect = renderer.getAtlasDirtyRect();
+  Vector2i scale = getSupersampleScale();
+  mCoverageRect[0] = (GLint)dirtyRect[0] * scale[0];
+  mCoverageRect[1] = (GLint)dirtyRect[1] * scale[1];
+  mCoverageRect[2] = (GLint)(dirtyRect[2] - dirtyRect[0]) * scale[0];
+  mCoverageRect[3] = (GLint)(dirtyRect[3] - dirtyRect[1]) * scale[1];
+
+  GLsizeiptr tilesAcross = (mCoverageRect[2] + COVERAGE_TILE_SIZE - 1) / COVERAGE_TILE_SIZE;
+  GLsizeiptr tilesDown = (mCoverageRect[3] + COVERAGE_TILE_SIZE - 1) / COVERAGE_TILE_SIZE;
+  GLsizeiptr size = tilesAcross * tilesDown * COVERAGE_TILE_SIZE * COVERAGE_TILE_SIZE * sizeof(GLint);
+
+  GLDEBUG(glBindBuffer(GL_SHADER_STORAGE_BUFFER, mCoverageBuffer));
+  if (size > mCoverageBufferCapacity) {
+    GLDEBUG(glBufferData(GL_SHADER_STORAGE_BUFFER, size, NULL, GL_DYNAMIC_COPY));
+    mCoverageBufferCapacity = size;
+  }
+  GLDEBUG(glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32I, 0, size, GL_RED_INTEGER, GL_INT, NULL));
+  GLDEBUG(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mCoverageBuffer));
+#endif
+}
+
+void
+ComputeAAStrategy::bindSegmentTexture(PathfinderShaderProgram& aProgram,
+                                      UniformID aUniformID,
+                                      GLuint aTexture,
+                                      GLuint aTextureUnit)
+{
+#ifdef GL_VERSION_4_3
+  GLDEBUG(GLState::activeTexture(GL_TEXTURE0 + aTextureUnit));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_BUFFER, aTexture));
+  GLDEBUG(glUniform1i(aProgram.getUniform(aUniformID), aTextureUnit));
+#endif
+}
+
+void
+ComputeAAStrategy::setCoverageUniforms(PathfinderShaderProgram& aProgram)
+{
+  GLDEBUG(glUniform4i(aProgram.getUniform(uniform_uCoverageRect),
+                      mCoverageRect[0],
+                      mCoverageRect[1],
+                      mCoverageRect[2],
+                      mCoverageRect[3]));
+}
+
+} // namespace pathfinder
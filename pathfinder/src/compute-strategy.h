@@ -0,0 +1,78 @@
+// pathfinder/src/compute-strategy.h
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#ifndef PATHFINDER_COMPUTE_STRATEGY_H
+#define PATHFINDER_COMPUTE_STRATEGY_H
+
+#include "aa-strategy.h"
+#include "platform.h"
+
+#include <hydra.h>
+
+namespace pathfinder {
+
+// Rasterizes the stencil segments with compute shaders, for GL 4.3.
+//
+// One dispatch adds the exact area each segment covers to a coverage buffer
+// laid out in 16x16 pixel tiles; a second sums that up each column of the
+// dirty rect and stores the shaded pixels straight into the atlas. Unlike
+// StencilAAAStrategy, there is no AA alpha framebuffer to clear or resolve
+// with a draw.
+class ComputeAAStrategy : public AntialiasingStrategy
+{
+public:
+  ComputeAAStrategy(int aLevel, SubpixelAAType aSubpixelAA);
+  virtual ~ComputeAAStrategy();
+  ComputeAAStrategy(const ComputeAAStrategy&) = delete;
+  ComputeAAStrategy& operator=(const ComputeAAStrategy&) = delete;
+
+  int getPassCount() const override {
+    return 1;
+  }
+
+  virtual bool init(Renderer& renderer) override;
+  virtual void attachMeshes(RenderContext& renderContext, Renderer& renderer) override;
+  virtual void setFramebufferSize(Renderer& renderer) override;
+  virtual kraken::Matrix4 getTransform() const override;
+  void prepareForRendering(Renderer& renderer) override { }
+  void prepareForDirectRendering(Renderer& renderer) override { }
+  void prepareToRenderObject(Renderer& renderer, int objectIndex) override { }
+  void finishDirectlyRenderingObject(Renderer& renderer, int objectIndex) override { }
+  virtual void antialiasObject(Renderer& renderer, int objectIndex) override;
+  void finishAntialiasingObject(Renderer& renderer, int objectIndex) override { }
+  virtual void resolveAAForObject(Renderer& renderer, int objectIndex) override;
+  void resolve(int pass, Renderer& renderer) override { }
+  DirectRenderingMode getDirectRenderingMode() const override;
+
+private:
+  kraken::Vector2i getSupersampleScale() const {
+    return kraken::Vector2i::Create(mSubpixelAA != saat_none ? 3 : 1, 1);
+  }
+  void initCoverageBuffer(Renderer& renderer);
+  void bindSegmentTexture(PathfinderShaderProgram& aProgram,
+                          UniformID aUniformID,
+                          GLuint aTexture,
+                          GLuint aTextureUnit);
+  void setCoverageUniforms(PathfinderShaderProgram& aProgram);
+
+  kraken::Vector2i mSupersampledFramebufferSize;
+  // Texture buffer views of the stencil segment mesh buffers.
+  GLuint mSegmentsTexture;
+  GLuint mSegmentNormalsTexture;
+  GLuint mSegmentPathIDsTexture;
+  GLuint mCoverageBuffer;
+  GLsizeiptr mCoverageBufferCapacity;
+  // The dirty rect in supersampled pixels, as (x, y, width, height).
+  GLint mCoverageRect[4];
+}; // class ComputeAAStrategy
+
+} // namespace pathfinder
+
+#endif // PATHFINDER_COMPUTE_STRATEGY_H
@@ -10,11 +10,16 @@
 
 #include "context.h"
 #include "gl-utils.h"
+#include "gpu-timer.h"
+#include "readback-ring.h"
 #include "shader-loader.h"
+#include "stream-buffer.h"
+#include "thread-pool.h"
 #include "resources/gamma_lut.h"
 #include "resources/area_lut.h"
 
 #include <string>
+#include <algorithm>
 
 const int MAX_VERTICES = 4 * 1024 * 1024;
 const int MAX_PATHS = 65535;
@@ -31,12 +36,20 @@ RenderContext::RenderContext()
   , mAreaLUTTexture(0)
   , mVertexIDVBO(0)
   , mInstancedPathIDVBO(0)
+  , mImageTexture(0)
+  , mImageFramebuffer(0)
+  , mGLVersion(0)
 {
+  mImageSize[0] = mImageSize[1] = 0;
   mShaderManager = make_unique<ShaderManager>();
+  mStreamBuffer = make_unique<StreamBuffer>();
+  mReadbackRing = make_unique<ReadbackRing>();
+  mGPUTimer = make_unique<GPUTimer>();
 }
 
 RenderContext::~RenderContext()
 {
+  makeCurrent();
   if (mQuadPositionsBuffer) {
     glDeleteBuffers(1, &mQuadPositionsBuffer);
     mQuadPositionsBuffer = 0;
@@ -50,11 +63,11 @@ RenderContext::~RenderContext()
     mQuadElementsBuffer = 0;
   }
   if (mGammaLUTTexture) {
-    glDeleteTextures(1, &mGammaLUTTexture);
+    GLState::deleteTextures(1, &mGammaLUTTexture);
     mGammaLUTTexture = 0;
   }
   if (mAreaLUTTexture) {
-    glDeleteTextures(1, &mAreaLUTTexture);
+    GLState::deleteTextures(1, &mAreaLUTTexture);
     mAreaLUTTexture = 0;
   }
   if (mVertexIDVBO) {
@@ -65,15 +78,35 @@ RenderContext::~RenderContext()
     glDeleteBuffers(1, &mInstancedPathIDVBO);
     mInstancedPathIDVBO = 0;
   }
+  if (mImageFramebuffer) {
+    GLState::deleteFramebuffers(1, &mImageFramebuffer);
+    mImageFramebuffer = 0;
+  }
+  if (mImageTexture) {
+    GLState::deleteTextures(1, &mImageTexture);
+    mImageTexture = 0;
+  }
+  // The cache goes away with the context.
+  if (GLState::getCache() == &mGLStateCache) {
+    GLState::setCache(nullptr);
+  }
 }
 
 bool
 RenderContext::init()
 {
+  makeCurrent();
+  GLBackend::init();
+  if (!initCapabilities()) {
+    return false;
+  }
   if (!initContext()) {
     return false;
   }
-  if (!mShaderManager->init()) {
+  if (!mShaderManager->init(getSupportsCompute())) {
+    return false;
+  }
+  if (!mStreamBuffer->init(getSupportsBufferStorage())) {
     return false;
   }
   if (!initGammaLUTTexture()) {
@@ -106,6 +139,88 @@ RenderContext::initQuadVAO(PathfinderShaderProgram& aProgram)
   GLDEBUG(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mQuadElementsBuffer));
 }
 
+bool
+RenderContext::initCapabilities()
+{
+  GLint majorVersion = 0;
+  GLint minorVersion = 0;
+  GLDEBUG(glGetIntegerv(GL_MAJOR_VERSION, &majorVersion));
+  GLDEBUG(glGetIntegerv(GL_MINOR_VERSION, &minorVersion));
+  mGLVersion = majorVersion * 10 + minorVersion;
+  return true;
+}
+
+bool
+RenderContext::getSupportsCopyImage() const
+{
+#ifdef GL_VERSION_4_3
+  return mGLVersion >= 43;
+#else
+  return false;
+#endif
+}
+
+bool
+RenderContext::getSupportsBaseInstance() const
+{
+#ifdef GL_VERSION_4_2
+  return mGLVersion >= 42;
+#else
+  return false;
+#endif
+}
+
+bool
+RenderContext::getSupportsBufferStorage() const
+{
+#ifdef GL_VERSION_4_4
+  return mGLVersion >= 44;
+#else
+  return false;
+#endif
+}
+
+bool
+RenderContext::getSupportsCompute() const
+{
+#ifdef GL_VERSION_4_3
+  return mGLVersion >= 43;
+#else
+  return false;
+#endif
+}
+
+ThreadPool&
+RenderContext::getThreadPool()
+{
+  if (!mThreadPool) {
+    mThreadPool = make_unique<ThreadPool>(max((int)thread::hardware_concurrency(), 1));
+  }
+  return *mThreadPool;
+}
+
+GLuint
+RenderContext::getImageFramebuffer(int aWidth, int aHeight)
+{
+  if (mImageFramebuffer && aWidth <= mImageSize[0] && aHeight <= mImageSize[1]) {
+    return mImageFramebuffer;
+  }
+  if (mImageFramebuffer) {
+    GLState::deleteFramebuffers(1, &mImageFramebuffer);
+    mImageFramebuffer = 0;
+  }
+  if (mImageTexture) {
+    GLState::deleteTextures(1, &mImageTexture);
+    mImageTexture = 0;
+  }
+
+  mImageSize[0] = max(aWidth, mImageSize[0]);
+  mImageSize[1] = max(aHeight, mImageSize[1]);
+  mImageTexture = createFramebufferColorTexture(mImageSize[0], mImageSize[1], caf_RGBA8);
+  mImageFramebuffer = createFramebuffer(mImageTexture, 0);
+  return mImageFramebuffer;
+}
+
 bool
 RenderContext::initContext()
 {
@@ -130,7 +245,7 @@ RenderContext::initGammaLUTTexture()
 {
   // TODO(kearwood) - Error handling
   GLDEBUG(glCreateTextures(GL_TEXTURE_2D, 1, &mGammaLUTTexture));
-  GLDEBUG(glBindTexture(GL_TEXTURE_2D, mGammaLUTTexture));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_2D, mGammaLUTTexture));
   GLDEBUG(glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, gamma_lut_width, gamma_lut_height, 0, GL_RED, GL_UNSIGNED_BYTE, gamma_lut_raw));
   GLDEBUG(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
   GLDEBUG(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
@@ -145,7 +260,7 @@ RenderContext::initAreaLUTTexture()
 {
   // TODO(kearwood) - Error handling
   GLDEBUG(glCreateTextures(GL_TEXTURE_2D, 1, &mAreaLUTTexture));
-  GLDEBUG(glBindTexture(GL_TEXTURE_2D, mAreaLUTTexture));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_2D, mAreaLUTTexture));
   GLDEBUG(glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, area_lut_width, area_lut_height, 0, GL_RED, GL_UNSIGNED_BYTE, area_lut_raw));
   GLDEBUG(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
   GLDEBUG(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
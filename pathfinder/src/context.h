@@ -23,6 +23,10 @@ namespace pathfinder {
 
 class PathfinderShaderProgram;
 class ShaderManager;
+class GPUTimer;
+class ReadbackRing;
+class StreamBuffer;
+class ThreadPool;
 
 class RenderContext
 {
@@ -34,13 +38,69 @@ public:
   virtual bool init();
   void initQuadVAO(PathfinderShaderProgram& aProgram);
 
+  // Points GLState at the state shadowed for this context's GL context. The
+  // entry points that issue GL calls make their context current first, on
+  // the thread its GL context is current on. Another render context may have
+  // used the GL context in between, so the shadowed state is only trusted
+  // while the context keeps it.
+  void makeCurrent() {
+    if (GLState::getCache() != &mGLStateCache) {
+      GLState::setCache(&mGLStateCache);
+      mGLStateCache.invalidate();
+    }
+  }
+
   ColorAlphaFormat getColorAlphaFormat() const;
 
+  // The context's GL version as major * 10 + minor, e.g. 43 for GL 4.3.
+  int getGLVersion() const {
+    return mGLVersion;
+  }
+  bool getSupportsCopyImage() const;
+  // Whether instanced draws can start partway into the instanced attributes,
+  // so that a VAO doesn't have to be rebuilt for every range drawn.
+  bool getSupportsBaseInstance() const;
+  // Whether buffers can be persistently mapped (GL_ARB_buffer_storage).
+  bool getSupportsBufferStorage() const;
+  // Whether compute shaders, shader storage buffers and image stores are
+  // available, for ComputeAAStrategy.
+  bool getSupportsCompute() const;
+
   ShaderManager& getShaderManager() {
     assert(mShaderManager);
     return *mShaderManager;
   }
 
+  // Per-frame data is uploaded through this ring, shared by every renderer
+  // of the context.
+  StreamBuffer& getStreamBuffer() {
+    assert(mStreamBuffer);
+    return *mStreamBuffer;
+  }
+
+  // Worker threads for the strategies that do part of their rasterization
+  // on the CPU, one per core. Started on first use.
+  ThreadPool& getThreadPool();
+
+  // Asynchronous readbacks of rendered images, shared by every view of the
+  // context.
+  ReadbackRing& getReadbackRing() {
+    assert(mReadbackRing);
+    return *mReadbackRing;
+  }
+
+  // Times the rendering phases of every renderer of the context. A frame
+  // ends with each TextBatch::prepare().
+  GPUTimer& getGPUTimer() {
+    assert(mGPUTimer);
+    return *mGPUTimer;
+  }
+
+  // An RGBA8 framebuffer at least aWidth x aHeight in size, for rendering
+  // text into images without a window. Kept between calls, and only
+  // reallocated to grow.
+  GLuint getImageFramebuffer(int aWidth, int aHeight);
+
   GLuint quadPositionsBuffer() {
     assert(mQuadPositionsBuffer);
     return mQuadPositionsBuffer;
@@ -71,12 +131,18 @@ public:
   }
 private:
   bool initContext();
+  bool initCapabilities();
   bool initGammaLUTTexture();
   bool initAreaLUTTexture();
   bool initVertexIDVBO();
   bool initInstancedPathIDVBO();
 
   std::unique_ptr<ShaderManager> mShaderManager;
+  std::unique_ptr<StreamBuffer> mStreamBuffer;
+  std::unique_ptr<ThreadPool> mThreadPool;
+  std::unique_ptr<ReadbackRing> mReadbackRing;
+  std::unique_ptr<GPUTimer> mGPUTimer;
+  GLStateCache mGLStateCache;
   GLuint mQuadPositionsBuffer;
   GLuint mQuadTexCoordsBuffer;
   GLuint mQuadElementsBuffer;
@@ -84,6 +150,10 @@ private:
   GLuint mAreaLUTTexture;
   GLuint mVertexIDVBO;
   GLuint mInstancedPathIDVBO;
+  GLuint mImageTexture;
+  GLuint mImageFramebuffer;
+  int mImageSize[2];
+  int mGLVersion;
 };
 
 } // namespace pathfinder
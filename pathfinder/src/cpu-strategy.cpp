@@ -0,0 +1,344 @@
+// pathfinder/src/cpu-strategy.cpp
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#include "cpu-strategy.h"
+
+#include "renderer.h"
+#include "context.h"
+#include "gl-utils.h"
+#include "meshes.h"
+#include "thread-pool.h"
+#include "xcaa-strategy.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace kraken;
+
+namespace pathfinder {
+
+namespace {
+
+// The antiderivative of clamp(u, 0, 1), as in fill-accumulate.cs.glsl.
+float
+integrateClampedLinear(float u)
+{
+  float c = std::min(std::max(u, 0.0f), 1.0f);
+  return c * c * 0.5f + std::max(u - 1.0f, 0.0f);
+}
+
+// The area of the pixel in `row`, `width` wide, that lies above the line
+// running from height `y0` on its left to `y1` on its right.
+float
+areaAbove(float row, float width, float y0, float y1)
+{
+  float u0 = row + 1.0f - y0, u1 = row + 1.0f - y1;
+  if (fabsf(u1 - u0) < 0.00001f) {
+    return width * std::min(std::max(u0, 0.0f), 1.0f);
+  }
+  return width * (integrateClampedLinear(u1) - integrateClampedLinear(u0)) / (u1 - u0);
+}
+
+// Adds each row of aRows, which are aWidth floats apart, to the one above,
+// so that the differences left by the fills become coverage.
+void
+sumColumns(float* aRows, int aWidth, int aRowCount)
+{
+  for (int row = 1; row < aRowCount; row++) {
+    const float* below = aRows + (row - 1) * aWidth;
+    float* above = aRows + row * aWidth;
+    int x = 0;
+#ifdef __AVX__
+    for (; x + 8 <= aWidth; x += 8) {
+      _mm256_storeu_ps(above + x, _mm256_add_ps(_mm256_loadu_ps(above + x), _mm256_loadu_ps(below + x)));
+    }
+#endif
+#ifdef __SSE2__
+    for (; x + 4 <= aWidth; x += 4) {
+      _mm_storeu_ps(above + x, _mm_add_ps(_mm_loadu_ps(above + x), _mm_loadu_ps(below + x)));
+    }
+#endif
+    for (; x < aWidth; x++) {
+      above[x] += below[x];
+    }
+  }
+}
+
+// Turns signed coverage into alpha, min(abs(c), 1), in place.
+void
+clampCoverage(float* aCoverage, int aCount)
+{
+  int i = 0;
+#ifdef __AVX__
+  const __m256 absMask8 = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  const __m256 one8 = _mm256_set1_ps(1.0f);
+  for (; i + 8 <= aCount; i += 8) {
+    __m256 c = _mm256_and_ps(_mm256_loadu_ps(aCoverage + i), absMask8);
+    _mm256_storeu_ps(aCoverage + i, _mm256_min_ps(c, one8));
+  }
+#endif
+#ifdef __SSE2__
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (; i + 4 <= aCount; i += 4) {
+    __m128 c = _mm_and_ps(_mm_loadu_ps(aCoverage + i), absMask);
+    _mm_storeu_ps(aCoverage + i, _mm_min_ps(c, one));
+  }
+#endif
+  for (; i < aCount; i++) {
+    aCoverage[i] = std::min(fabsf(aCoverage[i]), 1.0f);
+  }
+}
+
+// The conversion GL does when storing a float into a normalized byte.
+__uint8_t
+toUnorm8(float aValue)
+{
+  return (__uint8_t)(std::min(std::max(aValue, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+float
+convolve7Tap(const float aShades[7], const float* aKernel)
+{
+  return aShades[0] * aKernel[0] + aShades[1] * aKernel[1] + aShades[2] * aKernel[2] +
+    aShades[3] * aKernel[3] +
+    aShades[4] * aKernel[2] + aShades[5] * aKernel[1] + aShades[6] * aKernel[0];
+}
+
+} // anonymous namespace
+
+CPUAAStrategy::CPUAAStrategy(int aLevel, SubpixelAAType aSubpixelAA)
+  : AntialiasingStrategy(aSubpixelAA)
+  , mBytesPerPixel(1)
+  , mRowStride(0)
+{
+  mSupersampledFramebufferSize.init();
+  mBGColor = Vector4::Zero();
+  mFGColor = Vector4::Zero();
+  for (int i = 0; i < 4; i++) {
+    mCoverageRect[i] = 0;
+  }
+}
+
+CPUAAStrategy::~CPUAAStrategy()
+{
+
+}
+
+void
+CPUAAStrategy::setFramebufferSize(Renderer& renderer)
+{
+  Vector2i destFramebufferSize = renderer.getAtlasAllocatedSize();
+  mSupersampledFramebufferSize = Vector2i::Create(destFramebufferSize.x * getSupersampleScale().x,
+                                                  destFramebufferSize.y * getSupersampleScale().y);
+}
+
+Matrix4
+CPUAAStrategy::getTransform() const
+{
+  return Matrix4::Identity();
+}
+
+DirectRenderingMode
+CPUAAStrategy::getDirectRenderingMode() const
+{
+  return drm_none;
+}
+
+void
+CPUAAStrategy::antialiasObject(Renderer& renderer, int objectIndex)
+{
+  if (renderer.getMeshes().size() == 0) {
+    return;
+  }
+
+  Vector4 dirtyRect = renderer.getAtlasDirtyRect();
+  Vector2i scale = getSupersampleScale();
+  mCoverageRect[0] = (int)dirtyRect[0] * scale[0];
+  mCoverageRect[1] = (int)dirtyRect[1] * scale[1];
+  mCoverageRect[2] = (int)(dirtyRect[2] - dirtyRect[0]) * scale[0];
+  mCoverageRect[3] = (int)(dirtyRect[3] - dirtyRect[1]) * scale[1];
+
+  // Every object overwrites the whole dirty rect, so its pixels start from
+  // the background even if none of its segments are redrawn.
+  mBGColor = renderer.getBGColor();
+  mFGColor = renderer.getFGColor();
+  mBytesPerPixel = renderer.getAtlasColorAlphaFormat() == caf_R8 ? 1 : 4;
+  mRowStride = ((mCoverageRect[2] / scale[0]) * mBytesPerPixel + 3) & ~3;
+  mPixels.resize((size_t)mRowStride * std::max(mCoverageRect[3], 0));
+
+  Range pathRange = renderer.pathRangeForObject(objectIndex);
+  std::vector<Range>& segmentRanges = renderer.getMeshes()[0]->stencilSegmentPathRanges;
+  int firstSegment = calculateStartFromIndexRanges(pathRange, segmentRanges);
+  int count = std::max(calculateCountFromIndexRanges(pathRange, segmentRanges), 0);
+
+  ThreadPool& threadPool = renderer.getRenderContext()->getThreadPool();
+  mTiler.tile(renderer, firstSegment, count, mSupersampledFramebufferSize, mCoverageRect, threadPool);
+  int tilesDown = (mCoverageRect[3] + TILER_TILE_SIZE - 1) / TILER_TILE_SIZE;
+  binFills(tilesDown);
+
+  // Each task owns a band of whole pixel rows, so no two write the same
+  // bytes of mPixels.
+  threadPool.run(tilesDown, [this](int aBand) {
+    std::vector<float> coverage;
+    rasterizeBand(aBand, coverage);
+  });
+}
+
+void
+CPUAAStrategy::resolveAAForObject(Renderer& renderer, int objectIndex)
+{
+  if (renderer.getMeshes().size() == 0 || mPixels.empty()) {
+    return;
+  }
+
+  int width = mCoverageRect[2] / getSupersampleScale().x;
+  GLenum format = mBytesPerPixel == 1 ? GL_RED : GL_RGBA;
+  GLDEBUG(GLState::activeTexture(GL_TEXTURE0));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_2D, renderer.getAtlasTexture()));
+  GLDEBUG(glTexSubImage2D(GL_TEXTURE_2D, 0,
+                          mCoverageRect[0] / getSupersampleScale().x, mCoverageRect[1],
+                          width, mCoverageRect[3],
+                          format, GL_UNSIGNED_BYTE, &mPixels[0]));
+}
+
+void
+CPUAAStrategy::binFills(int aTilesDown)
+{
+  const std::vector<TileFill>& fills = mTiler.getFills();
+
+  // A counting sort on the row of tiles keeps the fills of each row in the
+  // order the tiler emitted them.
+  mBandStarts.assign(aTilesDown + 1, 0);
+  for (const TileFill& fill : fills) {
+    int band = (int)(fill.tileTop / TILER_TILE_SIZE) - 1;
+    mBandStarts[band + 1]++;
+  }
+  for (int band = 0; band < aTilesDown; band++) {
+    mBandStarts[band + 1] += mBandStarts[band];
+  }
+  std::vector<int> next(mBandStarts.begin(), mBandStarts.end() - 1);
+  mBandFills.resize(fills.size());
+  for (const TileFill& fill : fills) {
+    int band = (int)(fill.tileTop / TILER_TILE_SIZE) - 1;
+    mBandFills[next[band]++] = fill;
+  }
+}
+
+void
+CPUAAStrategy::rasterizeBand(int aBand, std::vector<float>& aCoverage)
+{
+  // Fills may run to the right edge of the last tile, past the region.
+  int stride = (mCoverageRect[2] + TILER_TILE_SIZE - 1) / TILER_TILE_SIZE * TILER_TILE_SIZE;
+  aCoverage.assign((size_t)stride * TILER_TILE_SIZE, 0.0f);
+  float bandBottom = (float)(aBand * TILER_TILE_SIZE);
+
+  // Leave the area above each line in every pixel it crosses, as the
+  // difference from the pixel below, as fill-accumulate.cs.glsl does. Each
+  // fill only covers up to the top of its tile, so nothing spills over into
+  // the next band.
+  for (int i = mBandStarts[aBand]; i < mBandStarts[aBand + 1]; i++) {
+    const TileFill& fill = mBandFills[i];
+    float leftX = fill.from[0], leftY = fill.from[1] - bandBottom;
+    float rightX = fill.to[0], rightY = fill.to[1] - bandBottom;
+    if (rightX - leftX < 0.00001f) {
+      continue;
+    }
+    float slope = (rightY - leftY) / (rightX - leftX);
+
+    int firstColumn = std::max((int)floorf(leftX), 0);
+    int lastColumn = std::min((int)ceilf(rightX) - 1, stride - 1);
+    for (int x = firstColumn; x <= lastColumn; x++) {
+      float x0 = std::max((float)x, leftX), x1 = std::min((float)(x + 1), rightX);
+      float width = x1 - x0;
+      if (width <= 0.0f) {
+        continue;
+      }
+      float y0 = leftY + (x0 - leftX) * slope, y1 = leftY + (x1 - leftX) * slope;
+
+      int firstRow = std::max((int)floorf(std::min(y0, y1)), 0);
+      int lastRow = (int)floorf(std::max(y0, y1));
+      float lastArea = 0.0f;
+      for (int row = firstRow; row <= lastRow && row < TILER_TILE_SIZE; row++) {
+        float area = areaAbove((float)row, width, y0, y1) * fill.winding;
+        aCoverage[row * stride + x] += area - lastArea;
+        lastArea = area;
+      }
+      if (lastRow + 1 < TILER_TILE_SIZE) {
+        aCoverage[(lastRow + 1) * stride + x] += width * fill.winding - lastArea;
+      }
+    }
+  }
+
+  sumColumns(&aCoverage[0], stride, TILER_TILE_SIZE);
+
+  int rowCount = std::min(TILER_TILE_SIZE, mCoverageRect[3] - aBand * TILER_TILE_SIZE);
+  clampCoverage(&aCoverage[0], stride * rowCount);
+  for (int row = 0; row < rowCount; row++) {
+    size_t pixelRow = (size_t)(aBand * TILER_TILE_SIZE + row);
+    shadeRow(&aCoverage[row * stride], &mPixels[pixelRow * mRowStride]);
+  }
+}
+
+void
+CPUAAStrategy::shadeRow(const float* aCoverage, __uint8_t* aPixels) const
+{
+  int scale = getSupersampleScale().x;
+  int width = mCoverageRect[2] / scale;
+
+  if (scale == 1) {
+    for (int x = 0; x < width; x++) {
+      float alpha = aCoverage[x];
+      for (int channel = 0; channel < mBytesPerPixel; channel++) {
+        float color = mBGColor[channel] + (mFGColor[channel] - mBGColor[channel]) * alpha;
+        aPixels[x * mBytesPerPixel + channel] = toUnorm8(color);
+      }
+    }
+    return;
+  }
+
+  // The LCD filter of xcaa-mono-subpixel-resolve.fs.glsl, over the nine
+  // supersampled columns around the center of each pixel. Outside the
+  // region nothing has been drawn.
+  const float* kernel = SUBPIXEL_AA_KERNELS[mSubpixelAA];
+  for (int x = 0; x < width; x++) {
+    int center = x * scale + scale / 2;
+    float taps[9];
+    for (int tap = 0; tap < 9; tap++) {
+      int column = center + tap - 4;
+      taps[tap] = column >= 0 && column < mCoverageRect[2] ? aCoverage[column] : 0.0f;
+    }
+
+    float shades[3];
+    for (int channel = 0; channel < 3; channel++) {
+      shades[channel] = convolve7Tap(&taps[channel], kernel);
+    }
+    float alpha = shades[0] > 0.0f || shades[1] > 0.0f || shades[2] > 0.0f ? mFGColor[3] : mBGColor[3];
+    float color[4];
+    for (int channel = 0; channel < 3; channel++) {
+      color[channel] = alpha * (mBGColor[channel] + (mFGColor[channel] - mBGColor[channel]) * shades[channel]);
+    }
+    color[3] = alpha;
+    for (int channel = 0; channel < mBytesPerPixel; channel++) {
+      aPixels[x * mBytesPerPixel + channel] = toUnorm8(color[channel]);
+    }
+  }
+}
+
+} // namespace pathfinder
@@ -0,0 +1,83 @@
+// pathfinder/src/cpu-strategy.h
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#ifndef PATHFINDER_CPU_STRATEGY_H
+#define PATHFINDER_CPU_STRATEGY_H
+
+#include "aa-strategy.h"
+#include "platform.h"
+#include "tiler.h"
+
+#include <vector>
+#include <hydra.h>
+
+namespace pathfinder {
+
+// Rasterizes the stencil segments on the CPU, for contexts without a fast
+// GPU, such as software GL.
+//
+// The Tiler bins the segments into 16x16 pixel tiles; each row of tiles is
+// then accumulated, summed and shaded on the render context's thread pool,
+// and the dirty rect is uploaded into the atlas with one glTexSubImage2D.
+// Every pixel sums its fills in the same order however many threads there
+// are, so the atlas comes out the same on any machine, which makes it a
+// reference for the GPU strategies.
+class CPUAAStrategy : public AntialiasingStrategy
+{
+public:
+  CPUAAStrategy(int aLevel, SubpixelAAType aSubpixelAA);
+  virtual ~CPUAAStrategy();
+  CPUAAStrategy(const CPUAAStrategy&) = delete;
+  CPUAAStrategy& operator=(const CPUAAStrategy&) = delete;
+
+  int getPassCount() const override {
+    return 1;
+  }
+
+  void attachMeshes(RenderContext& renderContext, Renderer& renderer) override { }
+  virtual void setFramebufferSize(Renderer& renderer) override;
+  virtual kraken::Matrix4 getTransform() const override;
+  void prepareForRendering(Renderer& renderer) override { }
+  void prepareForDirectRendering(Renderer& renderer) override { }
+  void prepareToRenderObject(Renderer& renderer, int objectIndex) override { }
+  void finishDirectlyRenderingObject(Renderer& renderer, int objectIndex) override { }
+  virtual void antialiasObject(Renderer& renderer, int objectIndex) override;
+  void finishAntialiasingObject(Renderer& renderer, int objectIndex) override { }
+  virtual void resolveAAForObject(Renderer& renderer, int objectIndex) override;
+  void resolve(int pass, Renderer& renderer) override { }
+  DirectRenderingMode getDirectRenderingMode() const override;
+
+private:
+  kraken::Vector2i getSupersampleScale() const {
+    return kraken::Vector2i::Create(mSubpixelAA != saat_none ? 3 : 1, 1);
+  }
+  void binFills(int aTilesDown);
+  void rasterizeBand(int aBand, std::vector<float>& aCoverage);
+  void shadeRow(const float* aCoverage, __uint8_t* aPixels) const;
+
+  kraken::Vector2i mSupersampledFramebufferSize;
+  // The dirty rect in supersampled pixels, as (x, y, width, height).
+  int mCoverageRect[4];
+  Tiler mTiler;
+  // The tiler's fills grouped by row of tiles; the fills of row i are
+  // [mBandStarts[i], mBandStarts[i + 1]).
+  std::vector<TileFill> mBandFills;
+  std::vector<int> mBandStarts;
+  kraken::Vector4 mBGColor;
+  kraken::Vector4 mFGColor;
+  int mBytesPerPixel;
+  // Rows of mPixels are padded to GL's default unpack alignment of 4.
+  int mRowStride;
+  std::vector<__uint8_t> mPixels;
+}; // class CPUAAStrategy
+
+} // namespace pathfinder
+
+#endif // PATHFINDER_CPU_STRATEGY_H
@@ -0,0 +1,482 @@
+// pathfinder/src/gl-backend.cpp
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#include "gl-backend.h"
+
+#include <memory>
+#include <string.h>
+#include <vector>
+
+using namespace std;
+
+namespace pathfinder {
+
+const char* const GL_FUNCTION_NAMES[glf_count] {
+#define GL_FUNCTION_ITEM(name) \
+  #name ,
+GL_FUNCTION_LIST
+#undef GL_FUNCTION_ITEM
+};
+
+#define GL_FUNCTION_ITEM(name) \
+  std::decay<decltype(::name)>::type name = ::name;
+GL_FUNCTION_LIST
+#undef GL_FUNCTION_ITEM
+
+namespace {
+
+struct NullBackendState
+{
+  __uint64_t calls[glf_count];
+  __uint64_t bufferUploadBytes;
+  __uint64_t textureUploadBytes;
+  GLuint nextName;
+  // Pixels read into a pack buffer have nowhere to go.
+  GLuint pixelPackBuffer;
+  // Mapped ranges are never unmapped for real; a persistent mapping must
+  // stay valid, so older blocks are kept when a larger one is needed.
+  vector<unique_ptr<__uint8_t[]>> mappings;
+  GLsizeiptr mappingSize;
+};
+
+NullBackendState&
+state()
+{
+  static NullBackendState sState;
+  return sState;
+}
+
+GLBackendType sType = glb_native;
+// Whether the entry points currently lead to the null backend.
+bool sNullInitialized = false;
+
+template <GLFunction F, typename T>
+struct NullFunction;
+
+// Counts the call and returns a zeroed result. Functions with results
+// written through pointers have their own implementations below.
+template <GLFunction F, typename R, typename... A>
+struct NullFunction<F, R (APIENTRY*)(A...)>
+{
+  static R APIENTRY call(A...) {
+    state().calls[F]++;
+    return R();
+  }
+};
+
+template <GLFunction F>
+void APIENTRY
+nullGenNames(GLsizei aCount, GLuint* aNames)
+{
+  state().calls[F]++;
+  for (GLsizei i = 0; i < aCount; i++) {
+    aNames[i] = ++state().nextName;
+  }
+}
+
+void APIENTRY
+nullCreateTextures(GLenum aTarget, GLsizei aCount, GLuint* aTextures)
+{
+#ifdef __APPLE__
+  nullGenNames<glf_glGenTextures>(aCount, aTextures);
+#else
+  nullGenNames<glf_glCreateTextures>(aCount, aTextures);
+#endif
+}
+
+GLuint APIENTRY
+nullCreateShader(GLenum aType)
+{
+  state().calls[glf_glCreateShader]++;
+  return ++state().nextName;
+}
+
+GLuint APIENTRY
+nullCreateProgram()
+{
+  state().calls[glf_glCreateProgram]++;
+  return ++state().nextName;
+}
+
+void APIENTRY
+nullBufferData(GLenum aTarget, GLsizeiptr aSize, const void* aData, GLenum aUsage)
+{
+  state().calls[glf_glBufferData]++;
+  if (aData) {
+    state().bufferUploadBytes += aSize;
+  }
+}
+
+void APIENTRY
+nullBufferSubData(GLenum aTarget, GLintptr aOffset, GLsizeiptr aSize, const void* aData)
+{
+  state().calls[glf_glBufferSubData]++;
+  state().bufferUploadBytes += aSize;
+}
+
+#ifdef GL_VERSION_4_4
+void APIENTRY
+nullBufferStorage(GLenum aTarget, GLsizeiptr aSize, const void* aData, GLbitfield aFlags)
+{
+  state().calls[glf_glBufferStorage]++;
+  if (aData) {
+    state().bufferUploadBytes += aSize;
+  }
+}
+#endif
+
+// Whatever a writable mapping is given counts as uploaded. Readable
+// mappings hold zeros.
+void* APIENTRY
+nullMapBufferRange(GLenum aTarget, GLintptr aOffset, GLsizeiptr aLength, GLbitfield aAccess)
+{
+  NullBackendState& s = state();
+  s.calls[glf_glMapBufferRange]++;
+  if (aAccess & GL_MAP_WRITE_BIT) {
+    s.bufferUploadBytes += aLength;
+  }
+  if (s.mappings.empty() || aLength > s.mappingSize) {
+    s.mappings.push_back(unique_ptr<__uint8_t[]>(new __uint8_t[aLength]()));
+    s.mappingSize = aLength;
+  }
+  __uint8_t* mapping = s.mappings.back().get();
+  if (aAccess & GL_MAP_READ_BIT) {
+    memset(mapping, 0, aLength);
+  }
+  return mapping;
+}
+
+void APIENTRY
+nullBindBuffer(GLenum aTarget, GLuint aBuffer)
+{
+  state().calls[glf_glBindBuffer]++;
+  if (aTarget == GL_PIXEL_PACK_BUFFER) {
+    state().pixelPackBuffer = aBuffer;
+  }
+}
+
+GLboolean APIENTRY
+nullUnmapBuffer(GLenum aTarget)
+{
+  state().calls[glf_glUnmapBuffer]++;
+  return GL_TRUE;
+}
+
+size_t
+getTexelSize(GLenum aFormat, GLenum aType)
+{
+  if (aType == GL_UNSIGNED_SHORT_5_5_5_1) {
+    return 2;
+  }
+  size_t components = 4;
+  switch (aFormat) {
+  case GL_RED:
+  case GL_DEPTH_COMPONENT:
+    components = 1;
+    break;
+  case GL_RG:
+    components = 2;
+    break;
+  case GL_RGB:
+    components = 3;
+    break;
+  }
+  switch (aType) {
+  case GL_FLOAT:
+    return components * 4;
+  case GL_HALF_FLOAT:
+  case GL_UNSIGNED_SHORT:
+    return components * 2;
+  default:
+    return components;
+  }
+}
+
+void APIENTRY
+nullTexImage2D(GLenum aTarget,
+               GLint aLevel,
+               GLint aInternalFormat,
+               GLsizei aWidth,
+               GLsizei aHeight,
+               GLint aBorder,
+               GLenum aFormat,
+               GLenum aType,
+               const void* aPixels)
+{
+  state().calls[glf_glTexImage2D]++;
+  if (aPixels) {
+    state().textureUploadBytes += aWidth * aHeight * getTexelSize(aFormat, aType);
+  }
+}
+
+void APIENTRY
+nullTexSubImage2D(GLenum aTarget,
+                  GLint aLevel,
+                  GLint aXOffset,
+                  GLint aYOffset,
+                  GLsizei aWidth,
+                  GLsizei aHeight,
+                  GLenum aFormat,
+                  GLenum aType,
+                  const void* aPixels)
+{
+  state().calls[glf_glTexSubImage2D]++;
+  state().textureUploadBytes += aWidth * aHeight * getTexelSize(aFormat, aType);
+}
+
+// Reads back black, with rows padded to the default pack alignment of 4.
+void APIENTRY
+nullReadPixels(GLint aX,
+               GLint aY,
+               GLsizei aWidth,
+               GLsizei aHeight,
+               GLenum aFormat,
+               GLenum aType,
+               void* aPixels)
+{
+  state().calls[glf_glReadPixels]++;
+  if (state().pixelPackBuffer || aWidth <= 0 || aHeight <= 0) {
+    return;
+  }
+  size_t rowSize = aWidth * getTexelSize(aFormat, aType);
+  size_t rowStride = (rowSize + 3) & ~(size_t)3;
+  memset(aPixels, 0, rowStride * (aHeight - 1) + rowSize);
+}
+
+void APIENTRY
+nullGetIntegerv(GLenum aName, GLint* aData)
+{
+  state().calls[glf_glGetIntegerv]++;
+  switch (aName) {
+  // Report GL 4.3, which leaves persistent mapping off, so that every
+  // stream buffer write goes through a map that is counted.
+  case GL_MAJOR_VERSION:
+    *aData = 4;
+    break;
+  case GL_MINOR_VERSION:
+    *aData = 3;
+    break;
+  case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:
+    *aData = 256;
+    break;
+  default:
+    *aData = 0;
+    break;
+  }
+}
+
+void APIENTRY
+nullGetShaderiv(GLuint aShader, GLenum aName, GLint* aParams)
+{
+  state().calls[glf_glGetShaderiv]++;
+  *aParams = aName == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+void APIENTRY
+nullGetProgramiv(GLuint aProgram, GLenum aName, GLint* aParams)
+{
+  state().calls[glf_glGetProgramiv]++;
+  *aParams = aName == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+
+template <GLFunction F>
+void APIENTRY
+nullGetInfoLog(GLuint aObject, GLsizei aBufSize, GLsizei* aLength, GLchar* aInfoLog)
+{
+  state().calls[F]++;
+  if (aLength) {
+    *aLength = 0;
+  }
+  if (aBufSize > 0) {
+    aInfoLog[0] = '\0';
+  }
+}
+
+#ifdef GL_VERSION_3_3
+// Every query has finished, having timed nothing.
+void APIENTRY
+nullGetQueryObjectiv(GLuint aQuery, GLenum aName, GLint* aParams)
+{
+  state().calls[glf_glGetQueryObjectiv]++;
+  *aParams = aName == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+void APIENTRY
+nullGetQueryObjectui64v(GLuint aQuery, GLenum aName, GLuint64* aParams)
+{
+  state().calls[glf_glGetQueryObjectui64v]++;
+  *aParams = 0;
+}
+#endif
+
+// There is no GPU to wait for.
+GLenum APIENTRY
+nullClientWaitSync(GLsync aSync, GLbitfield aFlags, GLuint64 aTimeout)
+{
+  state().calls[glf_glClientWaitSync]++;
+  return GL_ALREADY_SIGNALED;
+}
+
+void APIENTRY
+nullGetFramebufferAttachmentParameteriv(GLenum aTarget, GLenum aAttachment, GLenum aName, GLint* aParams)
+{
+  state().calls[glf_glGetFramebufferAttachmentParameteriv]++;
+  *aParams = aName == GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE ? GL_TEXTURE : 0;
+}
+
+GLenum APIENTRY
+nullCheckFramebufferStatus(GLenum aTarget)
+{
+  state().calls[glf_glCheckFramebufferStatus]++;
+  return GL_FRAMEBUFFER_COMPLETE;
+}
+
+// Other threads may be calling through the entry points while another
+// context initializes, so only the ones a loader has changed are written.
+void
+initNative()
+{
+#define GL_FUNCTION_ITEM(name) \
+  if (name != ::name) { \
+    name = ::name; \
+  }
+GL_FUNCTION_LIST
+#undef GL_FUNCTION_ITEM
+  sNullInitialized = false;
+}
+
+void
+initNull()
+{
+#define GL_FUNCTION_ITEM(name) \
+  name = &NullFunction<glf_ ## name, decltype(name)>::call;
+GL_FUNCTION_LIST
+#undef GL_FUNCTION_ITEM
+
+  // The results callers act on.
+#ifdef __APPLE__
+  glGenBuffers = nullGenNames<glf_glGenBuffers>;
+  glGenTextures = nullGenNames<glf_glGenTextures>;
+  glGenFramebuffers = nullGenNames<glf_glGenFramebuffers>;
+#else
+  glCreateBuffers = nullGenNames<glf_glCreateBuffers>;
+  glCreateTextures = nullCreateTextures;
+  glCreateFramebuffers = nullGenNames<glf_glCreateFramebuffers>;
+  glCreateVertexArrays = nullGenNames<glf_glCreateVertexArrays>;
+#endif
+  glGenVertexArrays = nullGenNames<glf_glGenVertexArrays>;
+#ifdef GL_VERSION_3_3
+  glGenQueries = nullGenNames<glf_glGenQueries>;
+#endif
+  glCreateShader = nullCreateShader;
+  glCreateProgram = nullCreateProgram;
+  glMapBufferRange = nullMapBufferRange;
+  glUnmapBuffer = nullUnmapBuffer;
+  glGetIntegerv = nullGetIntegerv;
+  glGetShaderiv = nullGetShaderiv;
+  glGetProgramiv = nullGetProgramiv;
+  glGetFramebufferAttachmentParameteriv = nullGetFramebufferAttachmentParameteriv;
+  glCheckFramebufferStatus = nullCheckFramebufferStatus;
+  glBindBuffer = nullBindBuffer;
+  glReadPixels = nullReadPixels;
+  glGetShaderInfoLog = nullGetInfoLog<glf_glGetShaderInfoLog>;
+  glGetProgramInfoLog = nullGetInfoLog<glf_glGetProgramInfoLog>;
+#ifdef GL_VERSION_3_3
+  glGetQueryObjectiv = nullGetQueryObjectiv;
+  glGetQueryObjectui64v = nullGetQueryObjectui64v;
+#endif
+  glClientWaitSync = nullClientWaitSync;
+
+  // The uploads.
+  glBufferData = nullBufferData;
+  glBufferSubData = nullBufferSubData;
+#ifdef GL_VERSION_4_4
+  glBufferStorage = nullBufferStorage;
+#endif
+  glTexImage2D = nullTexImage2D;
+  glTexSubImage2D = nullTexSubImage2D;
+  sNullInitialized = true;
+}
+
+} // anonymous namespace
+
+void
+GLBackend::use(GLBackendType aType)
+{
+  sType = aType;
+  init();
+}
+
+GLBackendType
+GLBackend::get()
+{
+  return sType;
+}
+
+void
+GLBackend::init()
+{
+  switch (sType) {
+  case glb_native:
+    initNative();
+    break;
+  case glb_null:
+    // Nothing is resolved at run time, so the entry points stay put.
+    if (!sNullInitialized) {
+      initNull();
+    }
+    break;
+  }
+}
+
+__uint64_t
+GLBackend::getCallCount(GLFunction aFunction)
+{
+  return state().calls[aFunction];
+}
+
+__uint64_t
+GLBackend::getDrawCount()
+{
+  NullBackendState& s = state();
+  __uint64_t count = s.calls[glf_glDrawArrays] +
+                     s.calls[glf_glDrawArraysInstanced] +
+                     s.calls[glf_glDrawElements] +
+                     s.calls[glf_glDrawElementsInstanced];
+#ifdef GL_VERSION_4_2
+  count += s.calls[glf_glDrawElementsInstancedBaseInstance];
+#endif
+  return count;
+}
+
+__uint64_t
+GLBackend::getBufferUploadBytes()
+{
+  return state().bufferUploadBytes;
+}
+
+__uint64_t
+GLBackend::getTextureUploadBytes()
+{
+  return state().textureUploadBytes;
+}
+
+void
+GLBackend::resetCounts()
+{
+  NullBackendState& s = state();
+  for (int i = 0; i < glf_count; i++) {
+    s.calls[i] = 0;
+  }
+  s.bufferUploadBytes = 0;
+  s.textureUploadBytes = 0;
+}
+
+} // namespace pathfinder
@@ -0,0 +1,217 @@
+// pathfinder/src/gl-backend.h
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#ifndef PATHFINDER_GL_BACKEND_H
+#define PATHFINDER_GL_BACKEND_H
+
+#include "platform.h"
+
+#include <type_traits>
+
+namespace pathfinder {
+
+// Every GL entry point Pathfinder calls. Each one is declared below as a
+// function pointer of the same name in namespace pathfinder, which hides the
+// global function, so code in the namespace reaches GL only through the
+// backend selected with GLBackend::use().
+#define GL_CORE_FUNCTION_LIST \
+GL_FUNCTION_ITEM(glActiveTexture) \
+GL_FUNCTION_ITEM(glAttachShader) \
+GL_FUNCTION_ITEM(glBindBuffer) \
+GL_FUNCTION_ITEM(glBindBufferBase) \
+GL_FUNCTION_ITEM(glBindBufferRange) \
+GL_FUNCTION_ITEM(glBindFramebuffer) \
+GL_FUNCTION_ITEM(glBindTexture) \
+GL_FUNCTION_ITEM(glBindVertexArray) \
+GL_FUNCTION_ITEM(glBlendEquation) \
+GL_FUNCTION_ITEM(glBlendFunc) \
+GL_FUNCTION_ITEM(glBlendFuncSeparate) \
+GL_FUNCTION_ITEM(glBlitFramebuffer) \
+GL_FUNCTION_ITEM(glBufferData) \
+GL_FUNCTION_ITEM(glBufferSubData) \
+GL_FUNCTION_ITEM(glCheckFramebufferStatus) \
+GL_FUNCTION_ITEM(glClear) \
+GL_FUNCTION_ITEM(glClearColor) \
+GL_FUNCTION_ITEM(glClearDepth) \
+GL_FUNCTION_ITEM(glClientWaitSync) \
+GL_FUNCTION_ITEM(glCompileShader) \
+GL_FUNCTION_ITEM(glCopyBufferSubData) \
+GL_FUNCTION_ITEM(glCreateProgram) \
+GL_FUNCTION_ITEM(glCreateShader) \
+GL_FUNCTION_ITEM(glCullFace) \
+GL_FUNCTION_ITEM(glDeleteBuffers) \
+GL_FUNCTION_ITEM(glDeleteFramebuffers) \
+GL_FUNCTION_ITEM(glDeleteProgram) \
+GL_FUNCTION_ITEM(glDeleteShader) \
+GL_FUNCTION_ITEM(glDeleteSync) \
+GL_FUNCTION_ITEM(glDeleteTextures) \
+GL_FUNCTION_ITEM(glDeleteVertexArrays) \
+GL_FUNCTION_ITEM(glDepthFunc) \
+GL_FUNCTION_ITEM(glDepthMask) \
+GL_FUNCTION_ITEM(glDisable) \
+GL_FUNCTION_ITEM(glDrawArrays) \
+GL_FUNCTION_ITEM(glDrawArraysInstanced) \
+GL_FUNCTION_ITEM(glDrawElements) \
+GL_FUNCTION_ITEM(glDrawElementsInstanced) \
+GL_FUNCTION_ITEM(glEnable) \
+GL_FUNCTION_ITEM(glEnableVertexAttribArray) \
+GL_FUNCTION_ITEM(glFenceSync) \
+GL_FUNCTION_ITEM(glFramebufferTexture2D) \
+GL_FUNCTION_ITEM(glFrontFace) \
+GL_FUNCTION_ITEM(glGenVertexArrays) \
+GL_FUNCTION_ITEM(glGetAttribLocation) \
+GL_FUNCTION_ITEM(glGetError) \
+GL_FUNCTION_ITEM(glGetFramebufferAttachmentParameteriv) \
+GL_FUNCTION_ITEM(glGetIntegerv) \
+GL_FUNCTION_ITEM(glGetProgramInfoLog) \
+GL_FUNCTION_ITEM(glGetProgramiv) \
+GL_FUNCTION_ITEM(glGetShaderInfoLog) \
+GL_FUNCTION_ITEM(glGetShaderiv) \
+GL_FUNCTION_ITEM(glGetUniformBlockIndex) \
+GL_FUNCTION_ITEM(glGetUniformLocation) \
+GL_FUNCTION_ITEM(glLinkProgram) \
+GL_FUNCTION_ITEM(glMapBufferRange) \
+GL_FUNCTION_ITEM(glReadPixels) \
+GL_FUNCTION_ITEM(glScissor) \
+GL_FUNCTION_ITEM(glShaderSource) \
+GL_FUNCTION_ITEM(glTexImage2D) \
+GL_FUNCTION_ITEM(glTexParameteri) \
+GL_FUNCTION_ITEM(glTexSubImage2D) \
+GL_FUNCTION_ITEM(glUniform1i) \
+GL_FUNCTION_ITEM(glUniform2f) \
+GL_FUNCTION_ITEM(glUniform2i) \
+GL_FUNCTION_ITEM(glUniform3f) \
+GL_FUNCTION_ITEM(glUniform4f) \
+GL_FUNCTION_ITEM(glUniform4fv) \
+GL_FUNCTION_ITEM(glUniform4i) \
+GL_FUNCTION_ITEM(glUniformBlockBinding) \
+GL_FUNCTION_ITEM(glUniformMatrix4fv) \
+GL_FUNCTION_ITEM(glUnmapBuffer) \
+GL_FUNCTION_ITEM(glUseProgram) \
+GL_FUNCTION_ITEM(glVertexAttribDivisor) \
+GL_FUNCTION_ITEM(glVertexAttribPointer) \
+GL_FUNCTION_ITEM(glViewport)
+
+// platform.h maps the create functions to the gen ones on Apple.
+#ifdef __APPLE__
+#define GL_CREATE_FUNCTION_LIST \
+GL_FUNCTION_ITEM(glGenBuffers) \
+GL_FUNCTION_ITEM(glGenTextures) \
+GL_FUNCTION_ITEM(glGenFramebuffers)
+#else
+#define GL_CREATE_FUNCTION_LIST \
+GL_FUNCTION_ITEM(glCreateBuffers) \
+GL_FUNCTION_ITEM(glCreateTextures) \
+GL_FUNCTION_ITEM(glCreateFramebuffers) \
+GL_FUNCTION_ITEM(glCreateVertexArrays)
+#endif
+
+// Entry points whose callers are compiled only against headers that have them.
+#ifdef GL_VERSION_3_3
+#define GL_3_3_FUNCTION_LIST \
+GL_FUNCTION_ITEM(glBeginQuery) \
+GL_FUNCTION_ITEM(glDeleteQueries) \
+GL_FUNCTION_ITEM(glEndQuery) \
+GL_FUNCTION_ITEM(glGenQueries) \
+GL_FUNCTION_ITEM(glGetQueryObjectiv) \
+GL_FUNCTION_ITEM(glGetQueryObjectui64v)
+#else
+#define GL_3_3_FUNCTION_LIST
+#endif
+
+#ifdef GL_VERSION_4_2
+#define GL_4_2_FUNCTION_LIST \
+GL_FUNCTION_ITEM(glBindImageTexture) \
+GL_FUNCTION_ITEM(glDrawElementsInstancedBaseInstance) \
+GL_FUNCTION_ITEM(glMemoryBarrier)
+#else
+#define GL_4_2_FUNCTION_LIST
+#endif
+
+#ifdef GL_VERSION_4_3
+#define GL_4_3_FUNCTION_LIST \
+GL_FUNCTION_ITEM(glClearBufferSubData) \
+GL_FUNCTION_ITEM(glCopyImageSubData) \
+GL_FUNCTION_ITEM(glDispatchCompute)
+#else
+#define GL_4_3_FUNCTION_LIST
+#endif
+
+#ifdef GL_VERSION_4_4
+#define GL_4_4_FUNCTION_LIST \
+GL_FUNCTION_ITEM(glBufferStorage)
+#else
+#define GL_4_4_FUNCTION_LIST
+#endif
+
+#ifdef GL_TEXTURE_BUFFER
+#define GL_TEXTURE_BUFFER_FUNCTION_LIST \
+GL_FUNCTION_ITEM(glTexBuffer)
+#else
+#define GL_TEXTURE_BUFFER_FUNCTION_LIST
+#endif
+
+#define GL_FUNCTION_LIST \
+GL_CORE_FUNCTION_LIST \
+GL_CREATE_FUNCTION_LIST \
+GL_3_3_FUNCTION_LIST \
+GL_4_2_FUNCTION_LIST \
+GL_4_3_FUNCTION_LIST \
+GL_4_4_FUNCTION_LIST \
+GL_TEXTURE_BUFFER_FUNCTION_LIST
+
+typedef enum {
+#define GL_FUNCTION_ITEM(name) \
+  glf_ ## name ,
+GL_FUNCTION_LIST
+#undef GL_FUNCTION_ITEM
+  glf_count
+} GLFunction;
+
+extern const char* const GL_FUNCTION_NAMES[glf_count];
+
+#define GL_FUNCTION_ITEM(name) \
+  extern std::decay<decltype(::name)>::type name;
+GL_FUNCTION_LIST
+#undef GL_FUNCTION_ITEM
+
+typedef enum {
+  glb_native,
+  glb_null
+} GLBackendType;
+
+// Selects where the GL calls go. The null backend issues none and needs no
+// context; it counts the calls and the bytes they would have uploaded, so
+// that the CPU side of a frame can be measured on its own.
+//
+// The entry points are plain globals, written without synchronization. Only
+// select a backend while no other thread is calling through them.
+class GLBackend
+{
+public:
+  static void use(GLBackendType aType);
+  static GLBackendType get();
+  // Points the entry points at the selected backend. Loaders such as glad
+  // resolve the native functions at run time, so this runs again once a
+  // context is current. Entry points that already lead to the right place
+  // are left alone, which lets a context initialize while another draws.
+  static void init();
+
+  // Counted by the null backend only.
+  static __uint64_t getCallCount(GLFunction aFunction);
+  static __uint64_t getDrawCount();
+  static __uint64_t getBufferUploadBytes();
+  static __uint64_t getTextureUploadBytes();
+  static void resetCounts();
+}; // class GLBackend
+
+} // namespace pathfinder
+
+#endif // PATHFINDER_GL_BACKEND_H
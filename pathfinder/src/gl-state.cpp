@@ -0,0 +1,325 @@
+// pathfinder/src/gl-state.cpp
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#include "gl-state.h"
+
+#include <atomic>
+
+using namespace std;
+
+namespace pathfinder {
+
+const char* const GL_STATE_CALL_NAMES[glsc_count] {
+#define GL_STATE_CALL_ITEM(name) \
+  #name ,
+GL_STATE_CALL_LIST
+#undef GL_STATE_CALL_ITEM
+};
+
+namespace {
+
+// Shared by the threads of every context, so the counts are atomic. Nothing
+// is ordered by them.
+struct GLStateCounts
+{
+  atomic<__uint64_t> issued[glsc_count];
+  atomic<__uint64_t> elided[glsc_count];
+};
+
+GLStateCounts&
+counts()
+{
+  static GLStateCounts sCounts;
+  return sCounts;
+}
+
+thread_local GLStateCache* sCurrentCache = nullptr;
+
+GLStateCache&
+cache()
+{
+  if (sCurrentCache) {
+    return *sCurrentCache;
+  }
+  // Nothing is known about a context without a cache, so every call is
+  // issued.
+  static thread_local GLStateCache sUncached;
+  sUncached.invalidate();
+  return sUncached;
+}
+
+// Counts the call and returns whether it has to be issued.
+bool
+count(GLStateCall aCall, bool aChanged)
+{
+  if (aChanged) {
+    counts().issued[aCall].fetch_add(1, memory_order_relaxed);
+  } else {
+    counts().elided[aCall].fetch_add(1, memory_order_relaxed);
+  }
+  return aChanged;
+}
+
+} // anonymous namespace
+
+void
+GLState::setCache(GLStateCache* aCache)
+{
+  sCurrentCache = aCache;
+}
+
+GLStateCache*
+GLState::getCache()
+{
+  return sCurrentCache;
+}
+
+void
+GLState::enable(GLenum aCap)
+{
+  if (count(glsc_enable, cache().capabilities[aCap].set(true))) {
+    glEnable(aCap);
+  }
+}
+
+void
+GLState::disable(GLenum aCap)
+{
+  if (count(glsc_disable, cache().capabilities[aCap].set(false))) {
+    glDisable(aCap);
+  }
+}
+
+void
+GLState::depthMask(GLboolean aFlag)
+{
+  if (count(glsc_depthMask, cache().depthMask.set(aFlag))) {
+    glDepthMask(aFlag);
+  }
+}
+
+void
+GLState::depthFunc(GLenum aFunc)
+{
+  if (count(glsc_depthFunc, cache().depthFunc.set(aFunc))) {
+    glDepthFunc(aFunc);
+  }
+}
+
+void
+GLState::blendEquation(GLenum aMode)
+{
+  if (count(glsc_blendEquation, cache().blendEquation.set(aMode))) {
+    glBlendEquation(aMode);
+  }
+}
+
+void
+GLState::blendFunc(GLenum aSrc, GLenum aDst)
+{
+  array<GLenum, 4> func = {{ aSrc, aDst, aSrc, aDst }};
+  if (count(glsc_blendFunc, cache().blendFunc.set(func))) {
+    glBlendFunc(aSrc, aDst);
+  }
+}
+
+void
+GLState::blendFuncSeparate(GLenum aSrcRGB, GLenum aDstRGB, GLenum aSrcAlpha, GLenum aDstAlpha)
+{
+  array<GLenum, 4> func = {{ aSrcRGB, aDstRGB, aSrcAlpha, aDstAlpha }};
+  if (count(glsc_blendFuncSeparate, cache().blendFunc.set(func))) {
+    glBlendFuncSeparate(aSrcRGB, aDstRGB, aSrcAlpha, aDstAlpha);
+  }
+}
+
+void
+GLState::cullFace(GLenum aMode)
+{
+  if (count(glsc_cullFace, cache().cullFace.set(aMode))) {
+    glCullFace(aMode);
+  }
+}
+
+void
+GLState::frontFace(GLenum aMode)
+{
+  if (count(glsc_frontFace, cache().frontFace.set(aMode))) {
+    glFrontFace(aMode);
+  }
+}
+
+void
+GLState::useProgram(GLuint aProgram)
+{
+  if (count(glsc_useProgram, cache().program.set(aProgram))) {
+    glUseProgram(aProgram);
+  }
+}
+
+void
+GLState::bindFramebuffer(GLenum aTarget, GLuint aFramebuffer)
+{
+  // GL_FRAMEBUFFER binds both targets, so it is only skipped if neither
+  // would change.
+  bool changed = false;
+  if (aTarget != GL_DRAW_FRAMEBUFFER) {
+    changed |= cache().readFramebuffer.set(aFramebuffer);
+  }
+  if (aTarget != GL_READ_FRAMEBUFFER) {
+    changed |= cache().drawFramebuffer.set(aFramebuffer);
+  }
+  if (count(glsc_bindFramebuffer, changed)) {
+    glBindFramebuffer(aTarget, aFramebuffer);
+  }
+}
+
+void
+GLState::viewport(GLint aX, GLint aY, GLsizei aWidth, GLsizei aHeight)
+{
+  array<GLint, 4> rect = {{ aX, aY, aWidth, aHeight }};
+  if (count(glsc_viewport, cache().viewport.set(rect))) {
+    glViewport(aX, aY, aWidth, aHeight);
+  }
+}
+
+void
+GLState::scissor(GLint aX, GLint aY, GLsizei aWidth, GLsizei aHeight)
+{
+  array<GLint, 4> rect = {{ aX, aY, aWidth, aHeight }};
+  if (count(glsc_scissor, cache().scissor.set(rect))) {
+    glScissor(aX, aY, aWidth, aHeight);
+  }
+}
+
+void
+GLState::activeTexture(GLenum aTexture)
+{
+  if (count(glsc_activeTexture, cache().activeTexture.set(aTexture))) {
+    glActiveTexture(aTexture);
+  }
+}
+
+void
+GLState::bindTexture(GLenum aTarget, GLuint aTexture)
+{
+  // Only 2D bindings are shadowed, and only once the active unit is known.
+  GLStateCache& state = cache();
+  bool changed = aTarget != GL_TEXTURE_2D || !state.activeTexture.known ||
+                 state.textures[state.activeTexture.value].set(aTexture);
+  if (count(glsc_bindTexture, changed)) {
+    glBindTexture(aTarget, aTexture);
+  }
+}
+
+void
+GLState::bindVertexArray(GLuint aArray)
+{
+  if (count(glsc_bindVertexArray, cache().vertexArray.set(aArray))) {
+    glBindVertexArray(aArray);
+  }
+}
+
+void
+GLState::clearColor(GLfloat aRed, GLfloat aGreen, GLfloat aBlue, GLfloat aAlpha)
+{
+  array<GLfloat, 4> color = {{ aRed, aGreen, aBlue, aAlpha }};
+  if (count(glsc_clearColor, cache().clearColor.set(color))) {
+    glClearColor(aRed, aGreen, aBlue, aAlpha);
+  }
+}
+
+void
+GLState::clearDepth(GLdouble aDepth)
+{
+  if (count(glsc_clearDepth, cache().clearDepth.set(aDepth))) {
+    glClearDepth(aDepth);
+  }
+}
+
+void
+GLState::deleteTextures(GLsizei aCount, const GLuint* aTextures)
+{
+  for (GLsizei i = 0; i < aCount; i++) {
+    for (pair<const GLenum, CachedState<GLuint>>& unit: cache().textures) {
+      unit.second.reset(aTextures[i]);
+    }
+  }
+  glDeleteTextures(aCount, aTextures);
+}
+
+void
+GLState::deleteFramebuffers(GLsizei aCount, const GLuint* aFramebuffers)
+{
+  for (GLsizei i = 0; i < aCount; i++) {
+    cache().readFramebuffer.reset(aFramebuffers[i]);
+    cache().drawFramebuffer.reset(aFramebuffers[i]);
+  }
+  glDeleteFramebuffers(aCount, aFramebuffers);
+}
+
+void
+GLState::deleteVertexArrays(GLsizei aCount, const GLuint* aArrays)
+{
+  for (GLsizei i = 0; i < aCount; i++) {
+    cache().vertexArray.reset(aArrays[i]);
+  }
+  glDeleteVertexArrays(aCount, aArrays);
+}
+
+void
+GLStateCache::invalidate()
+{
+  capabilities.clear();
+  depthMask.known = false;
+  depthFunc.known = false;
+  blendEquation.known = false;
+  blendFunc.known = false;
+  cullFace.known = false;
+  frontFace.known = false;
+  program.known = false;
+  readFramebuffer.known = false;
+  drawFramebuffer.known = false;
+  viewport.known = false;
+  scissor.known = false;
+  activeTexture.known = false;
+  textures.clear();
+  vertexArray.known = false;
+  clearColor.known = false;
+  clearDepth.known = false;
+}
+
+void
+GLState::invalidate()
+{
+  cache().invalidate();
+}
+
+__uint64_t
+GLState::getIssuedCount(GLStateCall aCall)
+{
+  return counts().issued[aCall].load(memory_order_relaxed);
+}
+
+__uint64_t
+GLState::getElidedCount(GLStateCall aCall)
+{
+  return counts().elided[aCall].load(memory_order_relaxed);
+}
+
+void
+GLState::resetCounts()
+{
+  for (int i = 0; i < glsc_count; i++) {
+    counts().issued[i].store(0, memory_order_relaxed);
+    counts().elided[i].store(0, memory_order_relaxed);
+  }
+}
+
+} // namespace pathfinder
@@ -0,0 +1,149 @@
+// pathfinder/src/gl-state.h
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#ifndef PATHFINDER_GL_STATE_H
+#define PATHFINDER_GL_STATE_H
+
+#include "platform.h"
+
+#include <array>
+#include <map>
+
+namespace pathfinder {
+
+#define GL_STATE_CALL_LIST \
+GL_STATE_CALL_ITEM(enable) \
+GL_STATE_CALL_ITEM(disable) \
+GL_STATE_CALL_ITEM(depthMask) \
+GL_STATE_CALL_ITEM(depthFunc) \
+GL_STATE_CALL_ITEM(blendEquation) \
+GL_STATE_CALL_ITEM(blendFunc) \
+GL_STATE_CALL_ITEM(blendFuncSeparate) \
+GL_STATE_CALL_ITEM(cullFace) \
+GL_STATE_CALL_ITEM(frontFace) \
+GL_STATE_CALL_ITEM(useProgram) \
+GL_STATE_CALL_ITEM(bindFramebuffer) \
+GL_STATE_CALL_ITEM(viewport) \
+GL_STATE_CALL_ITEM(scissor) \
+GL_STATE_CALL_ITEM(activeTexture) \
+GL_STATE_CALL_ITEM(bindTexture) \
+GL_STATE_CALL_ITEM(bindVertexArray) \
+GL_STATE_CALL_ITEM(clearColor) \
+GL_STATE_CALL_ITEM(clearDepth)
+
+typedef enum {
+#define GL_STATE_CALL_ITEM(name) \
+  glsc_ ## name ,
+GL_STATE_CALL_LIST
+#undef GL_STATE_CALL_ITEM
+  glsc_count
+} GLStateCall;
+
+extern const char* const GL_STATE_CALL_NAMES[glsc_count];
+
+template <typename T>
+struct CachedState
+{
+  CachedState()
+    : known(false)
+  { }
+  // Records the new value, returning false if the context already has it.
+  bool set(const T& aValue) {
+    if (known && value == aValue) {
+      return false;
+    }
+    value = aValue;
+    known = true;
+    return true;
+  }
+  void reset(const T& aValue) {
+    if (known && value == aValue) {
+      value = T();
+    }
+  }
+  T value;
+  bool known;
+};
+
+// The state GLState shadows for one GL context. Each RenderContext owns one.
+struct GLStateCache
+{
+  // Forgets all shadowed state, so that the next call of each kind is issued.
+  void invalidate();
+
+  std::map<GLenum, CachedState<bool>> capabilities;
+  CachedState<GLboolean> depthMask;
+  CachedState<GLenum> depthFunc;
+  CachedState<GLenum> blendEquation;
+  CachedState<std::array<GLenum, 4>> blendFunc;
+  CachedState<GLenum> cullFace;
+  CachedState<GLenum> frontFace;
+  CachedState<GLuint> program;
+  CachedState<GLuint> readFramebuffer;
+  CachedState<GLuint> drawFramebuffer;
+  CachedState<std::array<GLint, 4>> viewport;
+  CachedState<std::array<GLint, 4>> scissor;
+  CachedState<GLenum> activeTexture;
+  // The GL_TEXTURE_2D binding of each texture unit.
+  std::map<GLenum, CachedState<GLuint>> textures;
+  CachedState<GLuint> vertexArray;
+  CachedState<std::array<GLfloat, 4>> clearColor;
+  CachedState<GLdouble> clearDepth;
+};
+
+// Shadows the GL state that the renderers set over and over, and skips the
+// calls that wouldn't change it. All of Pathfinder's state changes go
+// through here; anything else that touches the GL context must be followed
+// by invalidate().
+//
+// The state is shadowed in the cache set on the calling thread, which must
+// belong to the GL context current on that thread. Without one, every call
+// is issued.
+class GLState
+{
+public:
+  static void setCache(GLStateCache* aCache);
+  static GLStateCache* getCache();
+
+  static void enable(GLenum aCap);
+  static void disable(GLenum aCap);
+  static void depthMask(GLboolean aFlag);
+  static void depthFunc(GLenum aFunc);
+  static void blendEquation(GLenum aMode);
+  static void blendFunc(GLenum aSrc, GLenum aDst);
+  static void blendFuncSeparate(GLenum aSrcRGB, GLenum aDstRGB, GLenum aSrcAlpha, GLenum aDstAlpha);
+  static void cullFace(GLenum aMode);
+  static void frontFace(GLenum aMode);
+  static void useProgram(GLuint aProgram);
+  static void bindFramebuffer(GLenum aTarget, GLuint aFramebuffer);
+  static void viewport(GLint aX, GLint aY, GLsizei aWidth, GLsizei aHeight);
+  static void scissor(GLint aX, GLint aY, GLsizei aWidth, GLsizei aHeight);
+  static void activeTexture(GLenum aTexture);
+  static void bindTexture(GLenum aTarget, GLuint aTexture);
+  static void bindVertexArray(GLuint aArray);
+  static void clearColor(GLfloat aRed, GLfloat aGreen, GLfloat aBlue, GLfloat aAlpha);
+  static void clearDepth(GLdouble aDepth);
+
+  // Deleting a bound object reverts its binding to zero.
+  static void deleteTextures(GLsizei aCount, const GLuint* aTextures);
+  static void deleteFramebuffers(GLsizei aCount, const GLuint* aFramebuffers);
+  static void deleteVertexArrays(GLsizei aCount, const GLuint* aArrays);
+
+  // Forgets the state shadowed in the current cache.
+  static void invalidate();
+
+  static __uint64_t getIssuedCount(GLStateCall aCall);
+  static __uint64_t getElidedCount(GLStateCall aCall);
+  static void resetCounts();
+}; // class GLState
+
+} // namespace pathfinder
+
+#endif // PATHFINDER_GL_STATE_H
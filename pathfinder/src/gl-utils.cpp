@@ -19,8 +19,8 @@ GLuint createFramebufferDepthTexture(kraken::Vector2i size)
 {
   GLuint texture = 0;
   GLDEBUG(glCreateTextures(GL_TEXTURE_2D, 1, &texture));
-  GLDEBUG(glActiveTexture(GL_TEXTURE0));
-  GLDEBUG(glBindTexture(GL_TEXTURE_2D, texture));
+  GLDEBUG(GLState::activeTexture(GL_TEXTURE0));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_2D, texture));
   GLDEBUG(glTexImage2D(GL_TEXTURE_2D,
                        0,
                        GL_DEPTH_COMPONENT,
@@ -48,7 +48,7 @@ createFramebuffer(GLuint colorAttachment, GLuint depthAttachment)
 {
   GLuint framebuffer = 0;
   GLDEBUG(glCreateFramebuffers(1, &framebuffer));
-  GLDEBUG(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+  GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, framebuffer));
 
   GLDEBUG(glFramebufferTexture2D(GL_FRAMEBUFFER,
                                  GL_COLOR_ATTACHMENT0,
@@ -92,6 +92,11 @@ createFramebufferColorTexture(GLsizei width,
       format = internalFormat = GL_RGBA;
       type = GL_UNSIGNED_BYTE;
       bufferSize = width * height * 4;
+  } else if (colorAlphaFormat == caf_R8) {
+      format = GL_RED;
+      internalFormat = GL_R8;
+      type = GL_UNSIGNED_BYTE;
+      bufferSize = width * height;
   } else {
       format = internalFormat = GL_RGBA;
       type = GL_UNSIGNED_SHORT_5_5_5_1;
@@ -102,8 +107,8 @@ createFramebufferColorTexture(GLsizei width,
 
   GLuint texture = 0;
   GLDEBUG(glCreateTextures(GL_TEXTURE_2D, 1, &texture));
-  GLDEBUG(glActiveTexture(GL_TEXTURE0));
-  GLDEBUG(glBindTexture(GL_TEXTURE_2D, texture));
+  GLDEBUG(GLState::activeTexture(GL_TEXTURE0));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_2D, texture));
   GLDEBUG(glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, zeroes));
   setTextureParameters(filter);
 
@@ -12,6 +12,7 @@
 #define PATHFINDER_GL_UTILS_H
 
 #include "platform.h"
+#include "gl-state.h"
 #include <hydra.h>
 #include <GLFW/glfw3.h>
 #include <map>
@@ -41,7 +42,8 @@ namespace pathfinder {
 
 typedef enum {
  caf_RGBA8,
- caf_RGB5_A1
+ caf_RGB5_A1,
+ caf_R8
 } ColorAlphaFormat;
 
 const float QUAD_POSITIONS[] = {
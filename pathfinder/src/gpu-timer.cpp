@@ -0,0 +1,159 @@
+// pathfinder/src/gpu-timer.cpp
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#include "gpu-timer.h"
+#include "gl-utils.h"
+
+using namespace std;
+
+namespace pathfinder {
+
+GPUTimer::GPUTimer()
+  : mEnabled(false)
+  , mOldest(0)
+  , mFrameCount(1)
+  , mActive(false)
+  , mCollectedFrames(0)
+{
+  for (int phase = 0; phase < gp_count; phase++) {
+    mElapsed[phase] = 0;
+  }
+}
+
+GPUTimer::~GPUTimer()
+{
+  end();
+  for (int frame = 0; frame < GPU_TIMER_FRAME_COUNT; frame++) {
+    release(mFrames[frame]);
+  }
+#ifdef GL_VERSION_3_3
+  if (!mFreeQueries.empty()) {
+    GLDEBUG(glDeleteQueries((GLsizei)mFreeQueries.size(), &mFreeQueries[0]));
+  }
+#endif
+}
+
+void
+GPUTimer::setEnabled(bool aEnabled)
+{
+  if (!aEnabled) {
+    end();
+  }
+  mEnabled = aEnabled;
+}
+
+void
+GPUTimer::nextFrame()
+{
+  end();
+
+  while (mFrameCount > 0 && collect(mFrames[mOldest])) {
+    release(mFrames[mOldest]);
+    mOldest = (mOldest + 1) % GPU_TIMER_FRAME_COUNT;
+    mFrameCount--;
+  }
+  // Rather than wait for a frame the GPU is this far behind on, lose it.
+  if (mFrameCount == GPU_TIMER_FRAME_COUNT) {
+    release(mFrames[mOldest]);
+    mOldest = (mOldest + 1) % GPU_TIMER_FRAME_COUNT;
+    mFrameCount--;
+  }
+  mFrameCount++;
+}
+
+void
+GPUTimer::begin(GPUPhase aPhase)
+{
+  if (!mEnabled) {
+    return;
+  }
+  end();
+#ifdef GL_VERSION_3_3
+  Query query;
+  query.phase = aPhase;
+  if (mFreeQueries.empty()) {
+    GLDEBUG(glGenQueries(1, &query.query));
+  } else {
+    query.query = mFreeQueries.back();
+    mFreeQueries.pop_back();
+  }
+  GLDEBUG(glBeginQuery(GL_TIME_ELAPSED, query.query));
+  mFrames[(mOldest + mFrameCount - 1) % GPU_TIMER_FRAME_COUNT].queries.push_back(query);
+  mActive = true;
+#endif
+}
+
+void
+GPUTimer::end()
+{
+  if (!mActive) {
+    return;
+  }
+#ifdef GL_VERSION_3_3
+  GLDEBUG(glEndQuery(GL_TIME_ELAPSED));
+#endif
+  mActive = false;
+}
+
+bool
+GPUTimer::collect(Frame& aFrame)
+{
+  if (aFrame.queries.empty()) {
+    return true;
+  }
+#ifdef GL_VERSION_3_3
+  // Queries finish in order, so the frame is done once its last one is.
+  GLint available = 0;
+  GLDEBUG(glGetQueryObjectiv(aFrame.queries.back().query, GL_QUERY_RESULT_AVAILABLE, &available));
+  if (!available) {
+    return false;
+  }
+  for (const Query& query : aFrame.queries) {
+    GLuint64 elapsed = 0;
+    GLDEBUG(glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &elapsed));
+    mElapsed[query.phase] += elapsed;
+  }
+  mCollectedFrames++;
+#endif
+  return true;
+}
+
+void
+GPUTimer::release(Frame& aFrame)
+{
+  for (const Query& query : aFrame.queries) {
+    mFreeQueries.push_back(query.query);
+  }
+  aFrame.queries.clear();
+}
+
+GPUTimings
+GPUTimer::getTimings() const
+{
+  GPUTimings timings;
+  timings.frameCount = mCollectedFrames;
+  timings.clear = mElapsed[gp_clear] / 1000000.0;
+  timings.directRendering = mElapsed[gp_directRendering] / 1000000.0;
+  timings.antialiasing = mElapsed[gp_antialiasing] / 1000000.0;
+  timings.resolve = mElapsed[gp_resolve] / 1000000.0;
+  timings.blit = mElapsed[gp_blit] / 1000000.0;
+  return timings;
+}
+
+void
+GPUTimer::resetTimings()
+{
+  for (int phase = 0; phase < gp_count; phase++) {
+    mElapsed[phase] = 0;
+  }
+  mCollectedFrames = 0;
+}
+
+} // namespace pathfinder
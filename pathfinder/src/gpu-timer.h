@@ -0,0 +1,105 @@
+// pathfinder/src/gpu-timer.h
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#ifndef PATHFINDER_GPU_TIMER_H
+#define PATHFINDER_GPU_TIMER_H
+
+#include "platform.h"
+#include "../include/pathfinder.h"
+
+#include <vector>
+
+namespace pathfinder {
+
+typedef enum {
+  gp_clear,
+  gp_directRendering,
+  gp_antialiasing,
+  gp_resolve,
+  gp_blit,
+  gp_count
+} GPUPhase;
+
+// A frame's queries are read this many frames after it was started, or
+// dropped if the GPU still hasn't finished them by then.
+const int GPU_TIMER_FRAME_COUNT = 4;
+
+// Times the phases of rendering on the GPU with GL_TIME_ELAPSED queries.
+// Results are only read once they are available, a few frames later, so
+// timing never stalls the pipeline. Time-elapsed queries can't nest, so
+// starting a phase ends the one before it.
+class GPUTimer
+{
+public:
+  GPUTimer();
+  ~GPUTimer();
+  GPUTimer(const GPUTimer&) = delete;
+  GPUTimer& operator=(const GPUTimer&) = delete;
+
+  void setEnabled(bool aEnabled);
+  bool getEnabled() const {
+    return mEnabled;
+  }
+
+  // Adds up the frames whose queries have come back, and starts a new one.
+  void nextFrame();
+  void begin(GPUPhase aPhase);
+  void end();
+
+  GPUTimings getTimings() const;
+  void resetTimings();
+
+private:
+  struct Query {
+    GPUPhase phase;
+    GLuint query;
+  };
+  struct Frame {
+    std::vector<Query> queries;
+  };
+
+  // Adds up aFrame if all of its queries are available, and returns whether
+  // they were.
+  bool collect(Frame& aFrame);
+  void release(Frame& aFrame);
+
+  bool mEnabled;
+  Frame mFrames[GPU_TIMER_FRAME_COUNT];
+  int mOldest;
+  // Including the frame being recorded, which is the newest.
+  int mFrameCount;
+  bool mActive;
+  std::vector<GLuint> mFreeQueries;
+  __uint64_t mElapsed[gp_count];
+  size_t mCollectedFrames;
+}; // class GPUTimer
+
+// Times what is issued from its construction to its destruction as aPhase.
+class GPUTimerScope
+{
+public:
+  GPUTimerScope(GPUTimer& aTimer, GPUPhase aPhase)
+    : mTimer(aTimer)
+  {
+    mTimer.begin(aPhase);
+  }
+  ~GPUTimerScope() {
+    mTimer.end();
+  }
+  GPUTimerScope(const GPUTimerScope&) = delete;
+  GPUTimerScope& operator=(const GPUTimerScope&) = delete;
+
+private:
+  GPUTimer& mTimer;
+}; // class GPUTimerScope
+
+} // namespace pathfinder
+
+#endif // PATHFINDER_GPU_TIMER_H
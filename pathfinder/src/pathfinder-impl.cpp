@@ -14,124 +14,516 @@
 #include "platform.h"
 #include "gl-utils.h"
 #include "atlas.h"
+#include "context.h"
+#include "gpu-timer.h"
+#include "readback-ring.h"
 #include "shader-loader.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <string.h>
 
 using namespace std;
 using namespace kraken;
 
 namespace pathfinder {
 
+TextStyle::TextStyle()
+  : fontSize(72.0f)
+  , emboldenAmount(0.0f)
+  , rotationAngle(0.0f)
+  , useHinting(false)
+{
+}
+
+bool
+TextStyle::operator==(const TextStyle& aOther) const
+{
+  return font == aOther.font &&
+         fontSize == aOther.fontSize &&
+         emboldenAmount == aOther.emboldenAmount &&
+         rotationAngle == aOther.rotationAngle &&
+         useHinting == aOther.useHinting;
+}
+
 TextViewImpl::TextViewImpl()
+  : mOwnsBatch(false)
+  , mStyleDirty(true)
+  , mTextDirty(true)
+  , mTextID(-1)
 {
 }
 
 TextViewImpl::~TextViewImpl()
 {
+  if (mBatch) {
+    mBatch->mImpl->removeView(this);
+  }
+}
+
+void
+TextViewImpl::setStyle(const TextStyle& aStyle)
+{
+  if (aStyle == mStyle) {
+    return;
+  }
+  mStyle = aStyle;
+  mStyleDirty = true;
 }
 
 void
 TextViewImpl::setText(const std::string& aText)
 {
-  mRenderer->setText(aText);
+  if (aText == mText) {
+    return;
+  }
+  mText = aText;
+  mTextDirty = true;
 }
 
 std::string
 TextViewImpl::getText() const
 {
-  return mRenderer->getText();
+  return mText;
 }
 
 void
 TextViewImpl::setFontSize(float aFontSize)
 {
-  mRenderer->setFontSize(aFontSize);
+  TextStyle style = mStyle;
+  style.fontSize = aFontSize;
+  setStyle(style);
 }
 
 float
 TextViewImpl::getFontSize() const
 {
-  return mRenderer->getFontSize();
+  return mStyle.fontSize;
 }
 
 void TextViewImpl::setEmboldenAmount(float aEmboldenAmount)
 {
-  mRenderer->setEmboldenAmount(aEmboldenAmount);
+  TextStyle style = mStyle;
+  style.emboldenAmount = aEmboldenAmount;
+  setStyle(style);
 }
 
 float TextViewImpl::getEmboldenAmount() const
 {
-  return mRenderer->getEmboldenAmount();
+  return mStyle.emboldenAmount;
 }
 
 void
 TextViewImpl::setRotationAngle(float aRotationAngle)
 {
-  mRenderer->setRotationAngle(aRotationAngle);
+  TextStyle style = mStyle;
+  style.rotationAngle = aRotationAngle;
+  setStyle(style);
 }
 
 float TextViewImpl::getRotationAngle() const
 {
-  return mRenderer->getRotationAngle();
+  return mStyle.rotationAngle;
 }
 
 bool
 TextViewImpl::getUseHinting() const
 {
-  return mRenderer->getUseHinting();
+  return mStyle.useHinting;
 }
 
 void
 TextViewImpl::setUseHinting(bool aUseHinting)
 {
-  mRenderer->setUseHinting(aUseHinting);
+  TextStyle style = mStyle;
+  style.useHinting = aUseHinting;
+  setStyle(style);
 }
 
 void
 TextViewImpl::setFont(std::shared_ptr<Font> aFont)
 {
-  mFont = aFont;
-  mRenderer->setFont(aFont->mImpl->getFont());
+  TextStyle style = mStyle;
+  style.font = aFont;
+  setStyle(style);
 }
 
 std::shared_ptr<Font>
 TextViewImpl::getFont() const
 {
-  return mFont;
+  return mStyle.font;
+}
+
+bool
+TextViewImpl::saveAtlas(const std::string& aPath)
+{
+  if (!mRenderer) {
+    return false;
+  }
+  mRenderer->getRenderContext()->makeCurrent();
+  return mRenderer->saveAtlas(aPath);
+}
+
+bool
+TextViewImpl::restoreAtlas(const std::string& aPath)
+{
+  // The atlas belongs to the renderer for this view's style, which the batch
+  // would otherwise only pick on the next prepare().
+  if (!mBatch || (mStyleDirty && !mBatch->mImpl->assignRenderer(*this))) {
+    return false;
+  }
+  if (!mRenderer) {
+    return false;
+  }
+  mRenderer->getRenderContext()->makeCurrent();
+  return mRenderer->restoreAtlas(aPath);
+}
+
+bool
+TextViewImpl::drawToImageFramebuffer(int aWidth, int aHeight)
+{
+  if (!mRenderer || aWidth <= 0 || aHeight <= 0) {
+    return false;
+  }
+
+  RenderContext& renderContext = *mRenderer->getRenderContext();
+  renderContext.makeCurrent();
+  GLuint framebuffer = renderContext.getImageFramebuffer(aWidth, aHeight);
+  GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+  GLDEBUG(GLState::viewport(0, 0, aWidth, aHeight));
+  GLDEBUG(GLState::disable(GL_SCISSOR_TEST));
+  // The composite adds the glyphs' color and keeps the destination alpha.
+  GLDEBUG(GLState::clearColor(0.0f, 0.0f, 0.0f, 1.0f));
+  GLDEBUG(glClear(GL_COLOR_BUFFER_BIT));
+
+  // Pixels, with y pointing up from the bottom row of the image, to clip
+  // space; the text hangs from the top left corner, so the first baseline
+  // sits one ascent below it.
+  float ascent = mRenderer->getFont() ? mRenderer->getAscent() : 0.0f;
+  Matrix4 transform = Matrix4::Identity();
+  transform.translate(0.0f, (float)aHeight - ascent, 0.0f);
+  transform.scale(2.0f / (float)aWidth, 2.0f / (float)aHeight, 1.0f);
+  transform.translate(-1.0f, -1.0f, 0.0f);
+  mRenderer->draw(mTextID, transform);
+  GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+  return true;
+}
+
+bool
+TextViewImpl::renderToImage(Image& aImage, int aWidth, int aHeight)
+{
+  if (!drawToImageFramebuffer(aWidth, aHeight)) {
+    return false;
+  }
+
+  // Rows of RGBA8 are always a multiple of the default pack alignment.
+  aImage.width = aWidth;
+  aImage.height = aHeight;
+  aImage.pixels.resize((size_t)aWidth * aHeight * 4);
+  GLDEBUG(glReadPixels(0, 0, aWidth, aHeight, GL_RGBA, GL_UNSIGNED_BYTE, &aImage.pixels[0]));
+
+  // GL reads the bottom row first.
+  size_t rowSize = (size_t)aWidth * 4;
+  vector<unsigned char> row(rowSize);
+  for (int y = 0; y < aHeight / 2; y++) {
+    unsigned char* top = &aImage.pixels[y * rowSize];
+    unsigned char* bottom = &aImage.pixels[(aHeight - 1 - y) * rowSize];
+    memcpy(&row[0], top, rowSize);
+    memcpy(top, bottom, rowSize);
+    memcpy(bottom, &row[0], rowSize);
+  }
+  return true;
+}
+
+bool
+TextViewImpl::renderToImageAsync(int aWidth, int aHeight, ImageCallback aCallback)
+{
+  if (!drawToImageFramebuffer(aWidth, aHeight)) {
+    return false;
+  }
+  mRenderer->getRenderContext()->getReadbackRing().read(aWidth, aHeight, aCallback);
+  return true;
 }
 
 void
 TextViewImpl::prepare()
 {
-  mRenderer->prepare();
+  // A shared batch is prepared once per frame by its owner.
+  if (mOwnsBatch) {
+    mBatch->prepare();
+  }
 }
 
 void
 TextViewImpl::draw(const Matrix4& aTransform)
 {
-  mRenderer->draw(aTransform);
+  if (mRenderer) {
+    mRenderer->getRenderContext()->makeCurrent();
+    mRenderer->draw(mTextID, aTransform);
+  }
+}
+
+void
+TextViewImpl::record(DrawListImpl& aDrawList, const Matrix4& aTransform)
+{
+  if (mRenderer) {
+    aDrawList.setRenderContext(mRenderer->getRenderContext());
+    mRenderer->recordDraw(mTextID, aTransform, aDrawList.getCommands());
+  }
+}
+
+void
+DrawListImpl::replay()
+{
+  if (mRenderContext) {
+    mRenderContext->makeCurrent();
+  }
+  mCommands.replay();
+}
+
+void
+DrawListImpl::reset()
+{
+  mCommands.reset();
+  mRenderContext.reset();
+}
+
+void
+DrawListImpl::setRenderContext(std::shared_ptr<RenderContext> aRenderContext)
+{
+  mRenderContext = aRenderContext;
+}
+
+CommandList&
+DrawListImpl::getCommands()
+{
+  return mCommands;
 }
 
 bool
-TextViewImpl::init()
+TextViewImpl::init(std::shared_ptr<TextBatch> aBatch)
 {
-  bool bUseSubpixelPositioning = true;
+  mOwnsBatch = !aBatch;
+  if (mOwnsBatch) {
+    aBatch = make_shared<TextBatch>();
+    if (!aBatch->init()) {
+      return false;
+    }
+  }
+  mBatch = aBatch;
+  mBatch->mImpl->addView(this);
+  return true;
+}
 
-  AAOptions options;
-  options.gammaCorrection = gcm_on;
-  options.stemDarkening = sdm_dark;
-  options.subpixelAA = saat_none;
+TextBatchImpl::TextBatchImpl()
+  : mAAType(asn_xcaa)
+{
+}
 
+TextBatchImpl::~TextBatchImpl()
+{
+  // The renderers delete their GL objects as they go.
+  if (mRenderContext) {
+    mRenderContext->makeCurrent();
+  }
+}
+
+bool
+TextBatchImpl::init()
+{
   mRenderContext = make_shared<RenderContext>();
   if (!mRenderContext->init()) {
     return false;
   }
-  mRenderer = make_shared<TextRenderer>(mRenderContext, bUseSubpixelPositioning);
-  if (!mRenderer->init(asn_xcaa, 1, options)) {
+  return true;
+}
+
+void
+TextBatchImpl::setRasterizer(Rasterizer aRasterizer)
+{
+  switch (aRasterizer) {
+  case rz_default:
+    mAAType = asn_xcaa;
+    break;
+  case rz_tiled:
+    mAAType = asn_tiled;
+    break;
+  case rz_compute:
+    mAAType = asn_compute;
+    break;
+  case rz_cpu:
+    mAAType = asn_cpu;
+    break;
+  }
+}
+
+void
+TextBatchImpl::finishReadbacks()
+{
+  if (mRenderContext) {
+    mRenderContext->makeCurrent();
+    mRenderContext->getReadbackRing().poll(true);
+  }
+}
+
+void
+TextBatchImpl::setGPUTimingEnabled(bool aEnabled)
+{
+  if (mRenderContext) {
+    mRenderContext->makeCurrent();
+    mRenderContext->getGPUTimer().setEnabled(aEnabled);
+  }
+}
+
+GPUTimings
+TextBatchImpl::getGPUTimings() const
+{
+  if (!mRenderContext) {
+    GPUTimings timings = {};
+    return timings;
+  }
+  return mRenderContext->getGPUTimer().getTimings();
+}
+
+void
+TextBatchImpl::resetGPUTimings()
+{
+  if (mRenderContext) {
+    mRenderContext->getGPUTimer().resetTimings();
+  }
+}
+
+void
+TextBatchImpl::addView(TextViewImpl* aView)
+{
+  mViews.push_back(aView);
+}
+
+void
+TextBatchImpl::removeView(TextViewImpl* aView)
+{
+  releaseRenderer(*aView);
+  mViews.erase(std::remove(mViews.begin(), mViews.end(), aView), mViews.end());
+}
+
+void
+TextBatchImpl::prepare()
+{
+  PATHFINDER_TRACE_SCOPE("TextBatch::prepare");
+  mRenderContext->makeCurrent();
+  mRenderContext->getGPUTimer().nextFrame();
+  // Callbacks may change the views, so deliver them first.
+  mRenderContext->getReadbackRing().poll(false);
+  for (TextViewImpl* view: mViews) {
+    if (view->mStyleDirty) {
+      assignRenderer(*view);
+    }
+    if (view->mTextDirty && view->mRenderer) {
+      view->mRenderer->setText(view->mTextID, view->mText);
+      view->mTextDirty = false;
+    }
+  }
+  for (StyledRenderer& styled: mRenderers) {
+    styled.renderer->prepare();
+  }
+}
+
+bool
+TextBatchImpl::assignRenderer(TextViewImpl& aView)
+{
+  if (!aView.mStyle.font) {
+    releaseRenderer(aView);
+    aView.mStyleDirty = false;
+    return false;
+  }
+
+  // Join the views that already have this style.
+  for (StyledRenderer& styled: mRenderers) {
+    if (styled.style == aView.mStyle) {
+      shared_ptr<TextRenderer> renderer = styled.renderer;
+      if (renderer != aView.mRenderer) {
+        releaseRenderer(aView);
+        aView.mRenderer = renderer;
+        aView.mTextID = renderer->addText();
+        aView.mTextDirty = true;
+      }
+      aView.mStyleDirty = false;
+      return true;
+    }
+  }
+
+  // A renderer that only draws this view is restyled in place, which keeps
+  // its atlas and lets it scale glyphs while the font size animates.
+  for (StyledRenderer& styled: mRenderers) {
+    if (styled.renderer == aView.mRenderer && styled.renderer->getTextCount() == 1) {
+      styled.style = aView.mStyle;
+      applyStyle(*styled.renderer, styled.style);
+      aView.mStyleDirty = false;
+      return true;
+    }
+  }
+
+  releaseRenderer(aView);
+  shared_ptr<TextRenderer> renderer = createRenderer();
+  if (!renderer) {
     return false;
   }
+  applyStyle(*renderer, aView.mStyle);
+  mRenderers.push_back(StyledRenderer{aView.mStyle, renderer});
+  aView.mRenderer = renderer;
+  aView.mTextID = renderer->addText();
+  aView.mTextDirty = true;
+  aView.mStyleDirty = false;
   return true;
 }
 
+void
+TextBatchImpl::releaseRenderer(TextViewImpl& aView)
+{
+  if (!aView.mRenderer) {
+    return;
+  }
+  aView.mRenderer->removeText(aView.mTextID);
+  if (aView.mRenderer->getTextCount() == 0) {
+    for (vector<StyledRenderer>::iterator itr = mRenderers.begin(); itr != mRenderers.end(); itr++) {
+      if (itr->renderer == aView.mRenderer) {
+        mRenderers.erase(itr);
+        break;
+      }
+    }
+  }
+  aView.mRenderer.reset();
+  aView.mTextID = -1;
+  aView.mTextDirty = true;
+}
+
+std::shared_ptr<TextRenderer>
+TextBatchImpl::createRenderer()
+{
+  bool bUseSubpixelPositioning = true;
+
+  AAOptions options;
+  options.gammaCorrection = gcm_on;
+  options.stemDarkening = sdm_dark;
+  options.subpixelAA = saat_none;
+
+  shared_ptr<TextRenderer> renderer = make_shared<TextRenderer>(mRenderContext, bUseSubpixelPositioning);
+  if (!renderer->init(mAAType, 1, options)) {
+    return nullptr;
+  }
+  return renderer;
+}
+
+void
+TextBatchImpl::applyStyle(TextRenderer& aRenderer, const TextStyle& aStyle)
+{
+  aRenderer.setFont(aStyle.font->mImpl->getFont());
+  aRenderer.setFontSize(aStyle.fontSize);
+  aRenderer.setEmboldenAmount(aStyle.emboldenAmount);
+  aRenderer.setRotationAngle(aStyle.rotationAngle);
+  aRenderer.setUseHinting(aStyle.useHinting);
+}
+
 FontImpl::FontImpl()
   : mFTLibrary(nullptr)
 {
@@ -13,9 +13,11 @@
 
 #include "text.h"
 #include "text-renderer.h"
+#include "command-list.h"
 #include "../include/pathfinder.h"
 
 #include <string>
+#include <vector>
 #include <hydra.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -27,6 +29,19 @@ class ShaderManager;
 
 typedef std::map<GLuint, std::string> ShaderMap;
 
+// The inputs that decide which TextRenderer a view can share.
+struct TextStyle
+{
+  TextStyle();
+  bool operator==(const TextStyle& aOther) const;
+
+  std::shared_ptr<Font> font;
+  float fontSize;
+  float emboldenAmount;
+  float rotationAngle;
+  bool useHinting;
+};
+
 class TextViewImpl
 {
 public:
@@ -35,10 +50,11 @@ public:
   TextViewImpl(const TextViewImpl&) = delete;
   TextViewImpl& operator=(const TextViewImpl&) = delete;
 
-  bool init();
+  bool init(std::shared_ptr<TextBatch> aBatch);
 
   void prepare();
   void draw(const kraken::Matrix4& aTransform);
+  void record(DrawListImpl& aDrawList, const kraken::Matrix4& aTransform);
 
   void setText(const std::string& aText);
   std::string getText() const;
@@ -53,15 +69,82 @@ public:
   bool getUseHinting() const;
   void setUseHinting(bool aUseHinting);
   std::shared_ptr<Atlas> getAtlas();
+  bool saveAtlas(const std::string& aPath);
+  bool restoreAtlas(const std::string& aPath);
+  bool renderToImage(Image& aImage, int aWidth, int aHeight);
+  bool renderToImageAsync(int aWidth, int aHeight, ImageCallback aCallback);
 
 private:
-
+  void setStyle(const TextStyle& aStyle);
+  // Draws into the render context's image framebuffer, and leaves it bound.
+  bool drawToImageFramebuffer(int aWidth, int aHeight);
+
+  std::shared_ptr<TextBatch> mBatch;
+  bool mOwnsBatch;
+  TextStyle mStyle;
+  std::string mText;
+  bool mStyleDirty;
+  bool mTextDirty;
+
+  // Assigned by the batch.
   std::shared_ptr<TextRenderer> mRenderer;
-  std::shared_ptr<RenderContext> mRenderContext;
-  std::shared_ptr<Font> mFont;
+  int mTextID;
 
+  friend class TextBatchImpl;
 }; // class TextViewImpl
 
+// Groups the views of a batch by style, so that each group is laid out and
+// rasterized by a single TextRenderer.
+class TextBatchImpl
+{
+public:
+  TextBatchImpl();
+  ~TextBatchImpl();
+  TextBatchImpl(const TextBatchImpl&) = delete;
+  TextBatchImpl& operator=(const TextBatchImpl&) = delete;
+
+  bool init();
+  void prepare();
+  void setRasterizer(Rasterizer aRasterizer);
+  void finishReadbacks();
+  void setGPUTimingEnabled(bool aEnabled);
+  GPUTimings getGPUTimings() const;
+  void resetGPUTimings();
+
+  void addView(TextViewImpl* aView);
+  void removeView(TextViewImpl* aView);
+  bool assignRenderer(TextViewImpl& aView);
+
+private:
+  struct StyledRenderer {
+    TextStyle style;
+    std::shared_ptr<TextRenderer> renderer;
+  };
+
+  std::shared_ptr<TextRenderer> createRenderer();
+  void applyStyle(TextRenderer& aRenderer, const TextStyle& aStyle);
+  void releaseRenderer(TextViewImpl& aView);
+
+  std::shared_ptr<RenderContext> mRenderContext;
+  AntialiasingStrategyName mAAType;
+  std::vector<StyledRenderer> mRenderers;
+  std::vector<TextViewImpl*> mViews;
+}; // class TextBatchImpl
+
+class DrawListImpl
+{
+public:
+  void replay();
+  void reset();
+  CommandList& getCommands();
+  // The context whose GL state the replay goes through, from the last
+  // recorded view.
+  void setRenderContext(std::shared_ptr<RenderContext> aRenderContext);
+private:
+  CommandList mCommands;
+  std::shared_ptr<RenderContext> mRenderContext;
+}; // class DrawListImpl
+
 class FontImpl
 {
 public:
@@ -13,12 +13,102 @@
 #include "platform.h"
 
 #include "pathfinder-impl.h"
+#include "trace.h"
 
 using namespace std;
 using namespace kraken;
 
 namespace pathfinder {
 
+void
+setGraphicsBackend(GraphicsBackend aBackend)
+{
+  GLBackend::use(aBackend == gb_null ? glb_null : glb_native);
+}
+
+GraphicsStats
+getGraphicsStats()
+{
+  GraphicsStats stats;
+  stats.calls = 0;
+  for (int i = 0; i < glf_count; i++) {
+    __uint64_t count = GLBackend::getCallCount((GLFunction)i);
+    if (count) {
+      stats.callsByFunction[GL_FUNCTION_NAMES[i]] = count;
+      stats.calls += count;
+    }
+  }
+  stats.drawCalls = GLBackend::getDrawCount();
+  stats.bufferUploadBytes = GLBackend::getBufferUploadBytes();
+  stats.textureUploadBytes = GLBackend::getTextureUploadBytes();
+
+  stats.stateChangesIssued = 0;
+  stats.stateChangesElided = 0;
+  for (int i = 0; i < glsc_count; i++) {
+    __uint64_t issued = GLState::getIssuedCount((GLStateCall)i);
+    __uint64_t elided = GLState::getElidedCount((GLStateCall)i);
+    if (issued || elided) {
+      stats.stateChangesByCall[GL_STATE_CALL_NAMES[i]] = make_pair(issued, elided);
+      stats.stateChangesIssued += issued;
+      stats.stateChangesElided += elided;
+    }
+  }
+  return stats;
+}
+
+void
+resetGraphicsStats()
+{
+  GLBackend::resetCounts();
+  GLState::resetCounts();
+}
+
+void
+invalidateGLState()
+{
+  GLState::invalidate();
+}
+
+void
+setTracingEnabled(bool aEnabled)
+{
+  Trace::setEnabled(aEnabled);
+}
+
+std::string
+getTraceJSON()
+{
+  return Trace::toJSON();
+}
+
+void
+resetTrace()
+{
+  Trace::reset();
+}
+
+DrawList::DrawList()
+{
+  mImpl = new DrawListImpl();
+}
+
+DrawList::~DrawList()
+{
+  delete mImpl;
+}
+
+void
+DrawList::replay()
+{
+  mImpl->replay();
+}
+
+void
+DrawList::reset()
+{
+  mImpl->reset();
+}
+
 TextView::TextView()
 {
   mImpl = new TextViewImpl();
@@ -99,10 +189,46 @@ TextView::draw(const Matrix4& aTransform)
   mImpl->draw(aTransform);
 }
 
+void
+TextView::record(DrawList& aDrawList, const Matrix4& aTransform)
+{
+  mImpl->record(*aDrawList.mImpl, aTransform);
+}
+
 bool
 TextView::init()
 {
-  return mImpl->init();
+  return mImpl->init(nullptr);
+}
+
+bool
+TextView::init(std::shared_ptr<TextBatch> aBatch)
+{
+  return mImpl->init(aBatch);
+}
+
+bool
+TextView::saveAtlas(const std::string& aPath)
+{
+  return mImpl->saveAtlas(aPath);
+}
+
+bool
+TextView::restoreAtlas(const std::string& aPath)
+{
+  return mImpl->restoreAtlas(aPath);
+}
+
+bool
+TextView::renderToImage(Image& aImage, int aWidth, int aHeight)
+{
+  return mImpl->renderToImage(aImage, aWidth, aHeight);
+}
+
+bool
+TextView::renderToImageAsync(int aWidth, int aHeight, ImageCallback aCallback)
+{
+  return mImpl->renderToImageAsync(aWidth, aHeight, aCallback);
 }
 
 Font::Font()
@@ -121,4 +247,56 @@ Font::~Font()
   delete mImpl;
 }
 
+TextBatch::TextBatch()
+{
+  mImpl = new TextBatchImpl();
+}
+
+TextBatch::~TextBatch()
+{
+  delete mImpl;
+}
+
+bool
+TextBatch::init()
+{
+  return mImpl->init();
+}
+
+void
+TextBatch::prepare()
+{
+  mImpl->prepare();
+}
+
+void
+TextBatch::setRasterizer(Rasterizer aRasterizer)
+{
+  mImpl->setRasterizer(aRasterizer);
+}
+
+void
+TextBatch::finishReadbacks()
+{
+  mImpl->finishReadbacks();
+}
+
+void
+TextBatch::setGPUTimingEnabled(bool aEnabled)
+{
+  mImpl->setGPUTimingEnabled(aEnabled);
+}
+
+GPUTimings
+TextBatch::getGPUTimings() const
+{
+  return mImpl->getGPUTimings();
+}
+
+void
+TextBatch::resetGPUTimings()
+{
+  mImpl->resetGPUTimings();
+}
+
 } // namespace pathfinder
@@ -19,6 +19,7 @@
 
 typedef __int32 __int32_t;
 typedef unsigned __int32 __uint32_t;
+typedef unsigned __int64 __uint64_t;
 typedef __int16 __int16_t;
 typedef unsigned __int16 __uint16_t;
 typedef __int8 __int8_t;
@@ -55,4 +56,7 @@ typedef unsigned __int8 __uint8_t;
 #  error platform not supported.
 #endif
 
+// Pathfinder's own GL calls go through the selected backend.
+#include "gl-backend.h"
+
 #endif // PATHFINDER_PLATFORM_H
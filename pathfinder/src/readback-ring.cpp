@@ -0,0 +1,137 @@
+// pathfinder/src/readback-ring.cpp
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#include "readback-ring.h"
+#include "gl-utils.h"
+
+#include <string.h>
+
+using namespace std;
+
+namespace pathfinder {
+
+ReadbackRing::ReadbackRing()
+  : mOldest(0)
+  , mPendingCount(0)
+{
+  for (int i = 0; i < READBACK_RING_SIZE; i++) {
+    mSlots[i].buffer = 0;
+    mSlots[i].capacity = 0;
+    mSlots[i].fence = 0;
+    mSlots[i].width = 0;
+    mSlots[i].height = 0;
+  }
+  mImage.width = 0;
+  mImage.height = 0;
+}
+
+ReadbackRing::~ReadbackRing()
+{
+  // Readbacks still in flight are dropped without calling back.
+  for (int i = 0; i < READBACK_RING_SIZE; i++) {
+    if (mSlots[i].fence) {
+      GLDEBUG(glDeleteSync(mSlots[i].fence));
+      mSlots[i].fence = 0;
+    }
+    if (mSlots[i].buffer) {
+      GLDEBUG(glDeleteBuffers(1, &mSlots[i].buffer));
+      mSlots[i].buffer = 0;
+    }
+  }
+}
+
+void
+ReadbackRing::read(GLsizei aWidth, GLsizei aHeight, std::function<void(const Image&)> aCallback)
+{
+  if (mPendingCount == READBACK_RING_SIZE) {
+    finishOldest();
+  }
+  Slot& slot = mSlots[(mOldest + mPendingCount) % READBACK_RING_SIZE];
+
+  // Rows of RGBA8 are always a multiple of the default pack alignment.
+  GLsizeiptr size = (GLsizeiptr)aWidth * aHeight * 4;
+  if (!slot.buffer) {
+    GLDEBUG(glCreateBuffers(1, &slot.buffer));
+  }
+  GLDEBUG(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+  if (size > slot.capacity) {
+    GLDEBUG(glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ));
+    slot.capacity = size;
+  }
+  GLDEBUG(glReadPixels(0, 0, aWidth, aHeight, GL_RGBA, GL_UNSIGNED_BYTE, 0));
+  GLDEBUG(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.width = aWidth;
+  slot.height = aHeight;
+  slot.callback = aCallback;
+  mPendingCount++;
+}
+
+void
+ReadbackRing::poll(bool aWait)
+{
+  while (mPendingCount > 0) {
+    Slot& slot = mSlots[mOldest];
+    if (!aWait && slot.fence) {
+      // Flushing makes sure the fence is on its way to the GPU, or it might
+      // never signal.
+      GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+      if (status == GL_TIMEOUT_EXPIRED) {
+        return;
+      }
+    }
+    finishOldest();
+  }
+}
+
+void
+ReadbackRing::finishOldest()
+{
+  Slot& slot = mSlots[mOldest];
+  if (slot.fence) {
+    GLenum status;
+    do {
+      status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    } while (status == GL_TIMEOUT_EXPIRED);
+    GLDEBUG(glDeleteSync(slot.fence));
+    slot.fence = 0;
+  }
+
+  // GL reads the bottom row first.
+  mImage.width = slot.width;
+  mImage.height = slot.height;
+  size_t rowSize = (size_t)slot.width * 4;
+  mImage.pixels.resize(rowSize * slot.height);
+  if (!mImage.pixels.empty()) {
+    GLDEBUG(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+    const __uint8_t* pixels = (const __uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+                                                                 0,
+                                                                 mImage.pixels.size(),
+                                                                 GL_MAP_READ_BIT);
+    if (pixels) {
+      for (GLsizei y = 0; y < slot.height; y++) {
+        memcpy(&mImage.pixels[y * rowSize], pixels + (slot.height - 1 - y) * rowSize, rowSize);
+      }
+      GLDEBUG(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+    GLDEBUG(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  }
+
+  // Retire the slot before calling back, which may queue another readback.
+  std::function<void(const Image&)> callback;
+  callback.swap(slot.callback);
+  mOldest = (mOldest + 1) % READBACK_RING_SIZE;
+  mPendingCount--;
+  if (callback) {
+    callback(mImage);
+  }
+}
+
+} // namespace pathfinder
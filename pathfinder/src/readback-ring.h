@@ -0,0 +1,73 @@
+// pathfinder/src/readback-ring.h
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#ifndef PATHFINDER_READBACK_RING_H
+#define PATHFINDER_READBACK_RING_H
+
+#include "platform.h"
+#include "../include/pathfinder.h"
+
+#include <functional>
+
+namespace pathfinder {
+
+// How many readbacks can be in flight before read() waits for the oldest.
+const int READBACK_RING_SIZE = 4;
+
+// Reads framebuffer pixels back through a ring of pixel pack buffers, so that
+// glReadPixels only queues a copy on the GPU instead of stalling until
+// everything before it has been drawn. Each copy is fenced, and poll() maps
+// the buffers whose fences have signaled and hands their pixels to the
+// callbacks, oldest first.
+class ReadbackRing
+{
+public:
+  ReadbackRing();
+  ~ReadbackRing();
+  ReadbackRing(const ReadbackRing&) = delete;
+  ReadbackRing& operator=(const ReadbackRing&) = delete;
+
+  // Queues a copy of the aWidth x aHeight RGBA8 pixels at the bottom left of
+  // the bound read framebuffer. If every buffer is in flight, the oldest
+  // readback is finished first.
+  void read(GLsizei aWidth, GLsizei aHeight, std::function<void(const Image&)> aCallback);
+  // Calls back the readbacks the GPU has finished, or with aWait, all of
+  // them. The image passed is only valid during the call. Callbacks may
+  // queue further readbacks, but not poll.
+  void poll(bool aWait);
+
+  int getPendingCount() const {
+    return mPendingCount;
+  }
+
+private:
+  struct Slot {
+    GLuint buffer;
+    GLsizeiptr capacity;
+    GLsync fence;
+    GLsizei width;
+    GLsizei height;
+    std::function<void(const Image&)> callback;
+  };
+
+  // Waits for the oldest readback if it has to, and calls it back.
+  void finishOldest();
+
+  Slot mSlots[READBACK_RING_SIZE];
+  // The oldest pending readback; the next is issued mPendingCount after it.
+  int mOldest;
+  int mPendingCount;
+  // Lent to the callbacks, so that its pixels aren't reallocated every time.
+  Image mImage;
+}; // class ReadbackRing
+
+} // namespace pathfinder
+
+#endif // PATHFINDER_READBACK_RING_H
@@ -15,13 +15,18 @@
 #include "context.h"
 #include "aa-strategy.h"
 #include "gl-utils.h"
+#include "gpu-timer.h"
+#include "trace.h"
 #include "buffer-texture.h"
 #include "meshes.h"
 #include "shader-loader.h"
+#include "stream-buffer.h"
 #include "resources.h"
 #include "platform.h"
 
 #include <assert.h>
+#include <string.h>
+#include <algorithm>
 
 using namespace std;
 using namespace kraken;
@@ -31,21 +36,13 @@ namespace pathfinder {
 Renderer::Renderer(shared_ptr<RenderContext> renderContext)
  : mRenderContext(renderContext)
  , mGammaCorrectionMode(gcm_on)
- , mImplicitCoverInteriorVAO(0)
- , mImplicitCoverCurveVAO(0)
 {
+  memset(&mPathUniforms, 0, sizeof(mPathUniforms));
 }
 
 Renderer::~Renderer()
 {
-  if (mImplicitCoverInteriorVAO) {
-    GLDEBUG(glDeleteVertexArrays(1, &mImplicitCoverInteriorVAO));
-    mImplicitCoverInteriorVAO = 0;
-  }
-  if (mImplicitCoverCurveVAO) {
-    GLDEBUG(glDeleteVertexArrays(1, &mImplicitCoverCurveVAO));
-    mImplicitCoverCurveVAO = 0;
-  }
+  deleteImplicitCoverVAOs();
 }
 
 bool
@@ -55,9 +52,6 @@ Renderer::init(AntialiasingStrategyName aaType,
 {
   setAntialiasingOptions(aaType, aaLevel, aaOptions);
 
-  GLDEBUG(glGenVertexArrays(1, &mImplicitCoverInteriorVAO)); // was vertexArrayObjectExt.createVertexArrayOES()
-  GLDEBUG(glGenVertexArrays(1, &mImplicitCoverCurveVAO)); // was vertexArrayObjectExt.createVertexArrayOES
-
   return true;
 }
 
@@ -67,10 +61,20 @@ Renderer::attachMeshes(vector<shared_ptr<PathfinderPackedMeshes>>& meshes)
   assert(mAntialiasingStrategy);
   mMeshes = meshes;
   mMeshBuffers.clear();
+  PATHFINDER_TRACE_SCOPE("mesh upload");
   for (shared_ptr<PathfinderPackedMeshes>& m: meshes) {
     mMeshBuffers.push_back(make_unique<PathfinderPackedMeshBuffers>(*m));
   }
   mAntialiasingStrategy->attachMeshes(*mRenderContext, *this);
+  initImplicitCoverVAOs();
+}
+
+void
+Renderer::detachMeshes()
+{
+  deleteImplicitCoverVAOs();
+  mMeshes.clear();
+  mMeshBuffers.clear();
 }
 
 
@@ -80,23 +84,44 @@ Renderer::renderAtlas()
   if (mMeshBuffers.size() == 0) {
     return;
   }
+  if (!getAtlasIsDirty()) {
+    return;
+  }
+
+  // Each phase ends the one before it, so that consecutive objects add up
+  // into the same few phases.
+  GPUTimer& timer = mRenderContext->getGPUTimer();
+  timer.begin(gp_clear);
 
+  PATHFINDER_TRACE_SCOPE("renderAtlas");
   clearDestFramebuffer();
 
   assert(mAntialiasingStrategy);
-  mAntialiasingStrategy->prepareForRendering(*this);
+  {
+    PATHFINDER_TRACE_SCOPE("prepareForRendering");
+    mAntialiasingStrategy->prepareForRendering(*this);
+  }
 
   int passCount = mAntialiasingStrategy->getPassCount();
   for (int pass = 0; pass < passCount; pass++) {
     if (mAntialiasingStrategy->getDirectRenderingMode() != drm_none) {
+      timer.begin(gp_directRendering);
+      PATHFINDER_TRACE_SCOPE("prepareForDirectRendering");
       mAntialiasingStrategy->prepareForDirectRendering(*this);
     }
 
     int objectCount = getObjectCount();
     for (int objectIndex = 0; objectIndex < objectCount; objectIndex++) {
+      uploadPathUniforms(pass, objectIndex);
+
       if (mAntialiasingStrategy->getDirectRenderingMode() != drm_none) {
+        timer.begin(gp_directRendering);
+
         // Prepare for direct rendering.
-        mAntialiasingStrategy->prepareToRenderObject(*this, objectIndex);
+        {
+          PATHFINDER_TRACE_SCOPE("prepareToRenderObject");
+          mAntialiasingStrategy->prepareToRenderObject(*this, objectIndex);
+        }
 
         // Clear.
         clearForDirectRendering(objectIndex);
@@ -106,16 +131,31 @@ Renderer::renderAtlas()
       }
 
       // Antialias.
-      mAntialiasingStrategy->antialiasObject(*this, objectIndex);
+      timer.begin(gp_antialiasing);
+      {
+        PATHFINDER_TRACE_SCOPE("antialiasObject");
+        mAntialiasingStrategy->antialiasObject(*this, objectIndex);
+      }
 
       // Perform post-antialiasing tasks.
-      mAntialiasingStrategy->finishAntialiasingObject(*this, objectIndex);
+      {
+        PATHFINDER_TRACE_SCOPE("finishAntialiasingObject");
+        mAntialiasingStrategy->finishAntialiasingObject(*this, objectIndex);
+      }
 
-      mAntialiasingStrategy->resolveAAForObject(*this, objectIndex);
+      timer.begin(gp_resolve);
+      {
+        PATHFINDER_TRACE_SCOPE("resolveAAForObject");
+        mAntialiasingStrategy->resolveAAForObject(*this, objectIndex);
+      }
     }
 
+    timer.begin(gp_resolve);
+    PATHFINDER_TRACE_SCOPE("resolve");
     mAntialiasingStrategy->resolve(pass, *this);
   }
+
+  timer.end();
 }
 
 void
@@ -133,10 +173,38 @@ Renderer::setAntialiasingOptions(AntialiasingStrategyName aaType,
   mAntialiasingStrategy->init(*this);
   if (mMeshes.size() != 0) {
     mAntialiasingStrategy->attachMeshes(*mRenderContext, *this);
+    // The direct rendering programs, and so the attribute locations, depend
+    // on the strategy.
+    initImplicitCoverVAOs();
   }
   mAntialiasingStrategy->setFramebufferSize(*this);
 }
 
+kraken::Vector4
+Renderer::getAtlasDirtyRect() const
+{
+  Vector2i usedSize = getAtlasUsedSize();
+  return Vector4::Create(0.0f, 0.0f, (float)usedSize[0], (float)usedSize[1]);
+}
+
+bool
+Renderer::getAtlasIsDirty() const
+{
+  Vector4 dirtyRect = getAtlasDirtyRect();
+  return dirtyRect[2] > dirtyRect[0] && dirtyRect[3] > dirtyRect[1];
+}
+
+void
+Renderer::setAtlasDirtyScissor(kraken::Vector2i aScale)
+{
+  Vector4 dirtyRect = getAtlasDirtyRect();
+  GLDEBUG(GLState::scissor((GLint)dirtyRect[0] * aScale[0],
+                    (GLint)dirtyRect[1] * aScale[1],
+                    (GLsizei)(dirtyRect[2] - dirtyRect[0]) * aScale[0],
+                    (GLsizei)(dirtyRect[3] - dirtyRect[1]) * aScale[1]));
+  GLDEBUG(GLState::enable(GL_SCISSOR_TEST));
+}
+
 void
 Renderer::setFramebufferSizeUniform(PathfinderShaderProgram& aProgram)
 {
@@ -194,49 +262,35 @@ Renderer::setTransformSTAndTexScaleUniformsForDest(PathfinderShaderProgram& aPro
 }
 
 void
-Renderer::setTransformUniform(PathfinderShaderProgram& aProgram, int pass, int objectIndex)
+Renderer::uploadPathUniforms(int pass, int objectIndex)
 {
-  if (aProgram.hasUniform(uniform_uTransform)) {
-    Matrix4 transform = computeTransform(pass, objectIndex);
-    GLDEBUG(glUniformMatrix4fv(aProgram.getUniform(uniform_uTransform), 1, GL_FALSE, transform.c));
-  }
-}
+  PathUniforms uniforms;
 
-void
-Renderer::setTransformSTUniform(PathfinderShaderProgram& aProgram, int objectIndex)
-{
-  if (aProgram.hasUniform(uniform_uTransformST)) {
-    // FIXME(pcwalton): Lossy conversion from a 4x4 matrix to an ST matrix is ugly and fragile.
-    // Refactor.
-
-    Matrix4 transform = computeTransform(0, objectIndex);
-
-    GLDEBUG(glUniform4f(aProgram.getUniform(uniform_uTransformST),
-                        transform[0],
-                        transform[5],
-                        transform[12],
-                        transform[13]));
-  }
-}
+  Matrix4 transform = computeTransform(pass, objectIndex);
+  memcpy(uniforms.transform, transform.c, sizeof(uniforms.transform));
 
-void
-Renderer::setTransformAffineUniforms(PathfinderShaderProgram& aProgram, int objectIndex)
-{
   // FIXME(pcwalton): Lossy conversion from a 4x4 matrix to an affine matrix is ugly and
   // fragile. Refactor.
-
-  Matrix4 transform = computeTransform(0, objectIndex);
-
-  if (aProgram.hasUniform(uniform_uTransformST)) {
-    GLDEBUG(glUniform4f(aProgram.getUniform(uniform_uTransformST),
-                        transform[0],
-                        transform[5],
-                        transform[12],
-                        transform[13]));
-  }
-  if (aProgram.hasUniform(uniform_uTransformExt)) {
-    GLDEBUG(glUniform2f(aProgram.getUniform(uniform_uTransformExt), transform[1], transform[4]));
+  Matrix4 affineTransform = computeTransform(0, objectIndex);
+  uniforms.transformST[0] = affineTransform[0];
+  uniforms.transformST[1] = affineTransform[5];
+  uniforms.transformST[2] = affineTransform[12];
+  uniforms.transformST[3] = affineTransform[13];
+  uniforms.transformExt[0] = affineTransform[1];
+  uniforms.transformExt[1] = affineTransform[4];
+
+  Vector4 hints = getHints();
+  for (int i = 0; i < 4; i++) {
+    uniforms.hints[i] = hints[i];
   }
+  Vector2 emboldenAmount = getTotalEmboldenAmount();
+  uniforms.emboldenAmount[0] = emboldenAmount[0];
+  uniforms.emboldenAmount[1] = emboldenAmount[1];
+
+  // Each pass gets a fresh slice of the ring, so a draw still reading the
+  // previous pass's block doesn't stall the upload.
+  mRenderContext->getStreamBuffer().bindUniformBlock(uniform_block_PathUniforms, &uniforms, sizeof(uniforms));
+  mPathUniforms = uniforms;
 }
 
 void
@@ -249,7 +303,8 @@ Renderer::uploadPathColors(int objectCount)
     shared_ptr<PathfinderBufferTexture> pathColorsBufferTexture;
     pathColorsBufferTexture = mPathColorsBufferTextures[objectIndex];
     if (pathColorsBufferTexture == nullptr) {
-      pathColorsBufferTexture = make_shared<PathfinderBufferTexture>(uniform_uPathColors, uniform_uPathColorsDimensions);
+      pathColorsBufferTexture = make_shared<PathfinderBufferTexture>(mRenderContext->getStreamBuffer(),
+                                                                     uniform_uPathColors);
       mPathColorsBufferTextures[objectIndex] = pathColorsBufferTexture;
     }
     pathColorsBufferTexture->upload(pathColors);
@@ -260,15 +315,19 @@ void
 Renderer::uploadPathTransforms(int objectCount)
 {
   mPathTransformBufferTextures.resize(objectCount, nullptr);
+  mPathTransformData.resize(objectCount, nullptr);
   for (int objectIndex = 0; objectIndex < objectCount; objectIndex++) {
     shared_ptr<PathTransformBuffers<vector<float>>> pathTransforms = pathTransformsForObject(objectIndex);
+    mPathTransformData[objectIndex] = pathTransforms;
 
     shared_ptr<PathTransformBuffers<PathfinderBufferTexture>> pathTransformBufferTextures;
     pathTransformBufferTextures = mPathTransformBufferTextures[objectIndex];
     if (pathTransformBufferTextures == nullptr) {
       pathTransformBufferTextures = make_shared<PathTransformBuffers<PathfinderBufferTexture>>(
-        make_shared<PathfinderBufferTexture>(uniform_uPathTransformST, uniform_uPathTransformSTDimensions),
-        make_shared<PathfinderBufferTexture>(uniform_uPathTransformExt, uniform_uPathTransformExtDimensions));
+        make_shared<PathfinderBufferTexture>(mRenderContext->getStreamBuffer(),
+                                             uniform_uPathTransformST),
+        make_shared<PathfinderBufferTexture>(mRenderContext->getStreamBuffer(),
+                                             uniform_uPathTransformExt));
       mPathTransformBufferTextures[objectIndex] = pathTransformBufferTextures;
     }
 
@@ -278,20 +337,34 @@ Renderer::uploadPathTransforms(int objectCount)
 }
 
 void
-Renderer::setPathColorsUniform(int objectIndex, PathfinderShaderProgram& aProgram, GLuint textureUnit)
+Renderer::uploadPathTransforms(int objectIndex,
+                               const PathTransformBuffers<vector<float>>& aPathTransforms,
+                               Range aPathRange)
 {
-  int meshIndex = meshIndexForObject(objectIndex);
-  mPathColorsBufferTextures[meshIndex]->bind(aProgram, textureUnit);
+  if (aPathRange.isEmpty()) {
+    return;
+  }
+  PathTransformBuffers<PathfinderBufferTexture>& textures = *mPathTransformBufferTextures[objectIndex];
+  textures.st->upload(*aPathTransforms.st, Range(aPathRange.start * 4, aPathRange.end * 4));
+  textures.ext->upload(*aPathTransforms.ext, Range(aPathRange.start * 2, aPathRange.end * 2));
+
+  // Keep the CPU copy in step, unless the caller updated it in place.
+  PathTransformBuffers<vector<float>>& data = *mPathTransformData[objectIndex];
+  if (data.st != aPathTransforms.st) {
+    copy(aPathTransforms.st->begin() + aPathRange.start * 4,
+         aPathTransforms.st->begin() + aPathRange.end * 4,
+         data.st->begin() + aPathRange.start * 4);
+    copy(aPathTransforms.ext->begin() + aPathRange.start * 2,
+         aPathTransforms.ext->begin() + aPathRange.end * 2,
+         data.ext->begin() + aPathRange.start * 2);
+  }
 }
 
 void
-Renderer::setEmboldenAmountUniform(int objectIndex, PathfinderShaderProgram& aProgram)
+Renderer::setPathColorsUniform(int objectIndex, PathfinderShaderProgram& aProgram, GLuint textureUnit)
 {
-  if (!aProgram.hasUniform(uniform_uEmboldenAmount)) {
-    return;
-  }
-  Vector2 emboldenAmount = getTotalEmboldenAmount();
-  GLDEBUG(glUniform2f(aProgram.getUniform(uniform_uEmboldenAmount), emboldenAmount[0], emboldenAmount[1]));
+  int meshIndex = meshIndexForObject(objectIndex);
+  mPathColorsBufferTextures[meshIndex]->bind(aProgram, textureUnit);
 }
 
 int
@@ -314,8 +387,8 @@ void
 Renderer::bindGammaLUT(Vector3 bgColor, GLuint textureUnit, PathfinderShaderProgram& aProgram)
 {
   if (aProgram.hasUniform(uniform_uGammaLUT)) {
-    GLDEBUG(glActiveTexture(GL_TEXTURE0 + textureUnit));
-    GLDEBUG(glBindTexture(GL_TEXTURE_2D, mRenderContext->getGammaLUTTexture()));
+    GLDEBUG(GLState::activeTexture(GL_TEXTURE0 + textureUnit));
+    GLDEBUG(GLState::bindTexture(GL_TEXTURE_2D, mRenderContext->getGammaLUTTexture()));
     GLDEBUG(glUniform1i(aProgram.getUniform(uniform_uGammaLUT), textureUnit));
   }
 
@@ -328,8 +401,8 @@ void
 Renderer::bindAreaLUT(GLuint textureUnit, PathfinderShaderProgram& aProgram)
 {
   if (aProgram.hasUniform(uniform_uAreaLUT)) {
-    GLDEBUG(glActiveTexture(GL_TEXTURE0 + textureUnit));
-    GLDEBUG(glBindTexture(GL_TEXTURE_2D, mRenderContext->getAreaLUTTexture()));
+    GLDEBUG(GLState::activeTexture(GL_TEXTURE0 + textureUnit));
+    GLDEBUG(GLState::bindTexture(GL_TEXTURE_2D, mRenderContext->getAreaLUTTexture()));
     GLDEBUG(glUniform1i(aProgram.getUniform(uniform_uAreaLUT), textureUnit));
   }
 }
@@ -339,11 +412,12 @@ Renderer::clearDestFramebuffer()
 {
   Vector4 clearColor = getBGColor();
   Vector2i destAllocatedSize = getAtlasAllocatedSize();
-  GLDEBUG(glBindFramebuffer(GL_FRAMEBUFFER, getAtlasFramebuffer()));
-  GLDEBUG(glDepthMask(GL_TRUE));
-  GLDEBUG(glViewport(0, 0, destAllocatedSize[0], destAllocatedSize[1]));
-  GLDEBUG(glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
-  GLDEBUG(glClearDepth(0.0));
+  GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, getAtlasFramebuffer()));
+  GLDEBUG(GLState::depthMask(GL_TRUE));
+  GLDEBUG(GLState::viewport(0, 0, destAllocatedSize[0], destAllocatedSize[1]));
+  setAtlasDirtyScissor(Vector2i::One());
+  GLDEBUG(GLState::clearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
+  GLDEBUG(GLState::clearDepth(0.0));
   GLDEBUG(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 }
 
@@ -359,9 +433,9 @@ Renderer::clearForDirectRendering(int objectIndex)
   //   return;
   // }
 
-  GLDEBUG(glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
-  GLDEBUG(glClearDepth(0.0));
-  GLDEBUG(glDepthMask(GL_TRUE));
+  GLDEBUG(GLState::clearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
+  GLDEBUG(GLState::clearDepth(0.0));
+  GLDEBUG(GLState::depthMask(GL_TRUE));
   GLDEBUG(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 }
 
@@ -401,6 +475,9 @@ Renderer::directlyRenderObject(int pass, int objectIndex)
     return;
   }
 
+  // The VAOs are built for every object whenever meshes are attached.
+  assert(objectIndex < (int)mImplicitCoverInteriorVAOs.size());
+
   Range pathRange = pathRangeForObject(objectIndex);
   int meshIndex = meshIndexForObject(objectIndex);
 
@@ -408,30 +485,24 @@ Renderer::directlyRenderObject(int pass, int objectIndex)
   shared_ptr<PathfinderPackedMeshes> meshData = mMeshes[meshIndex];
 
   // Set up implicit cover state.
-  GLDEBUG(glDepthFunc(GL_GREATER));
-  GLDEBUG(glDepthMask(GL_TRUE));
-  GLDEBUG(glEnable(GL_DEPTH_TEST));
-  GLDEBUG(glDisable(GL_BLEND));
-  GLDEBUG(glCullFace(GL_BACK));
-  GLDEBUG(glFrontFace(GL_CCW));
-  GLDEBUG(glEnable(GL_CULL_FACE));
-
-  // Set up the implicit cover interior VAO.
+  GLDEBUG(GLState::depthFunc(GL_GREATER));
+  GLDEBUG(GLState::depthMask(GL_TRUE));
+  GLDEBUG(GLState::enable(GL_DEPTH_TEST));
+  GLDEBUG(GLState::disable(GL_BLEND));
+  GLDEBUG(GLState::cullFace(GL_BACK));
+  GLDEBUG(GLState::frontFace(GL_CCW));
+  GLDEBUG(GLState::enable(GL_CULL_FACE));
+
+  // Bind the implicit cover interior VAO.
   ProgramID directInteriorProgramName = getDirectInteriorProgramName(renderingMode);
   shared_ptr<PathfinderShaderProgram> directInteriorProgram = mRenderContext->getShaderManager().getProgram(directInteriorProgramName);
-  GLDEBUG(glBindVertexArray(mImplicitCoverInteriorVAO)); // was vertexArrayObjectExt.bindVertexArrayOES
-  initImplicitCoverInteriorVAO(objectIndex, instanceRange, renderingMode);
+  GLDEBUG(GLState::useProgram(directInteriorProgram->getProgram()));
+  GLDEBUG(GLState::bindVertexArray(mImplicitCoverInteriorVAOs[objectIndex])); // was vertexArrayObjectExt.bindVertexArrayOES
 
-  // Draw direct interior parts.
-  if (renderingMode == drm_conservative) {
-    setTransformAffineUniforms(*directInteriorProgram, objectIndex);
-  } else {
-    setTransformUniform(*directInteriorProgram, pass, objectIndex);
-  }
+  // Draw direct interior parts. The transform, hints and embolden amount are
+  // in the path uniform block.
   setFramebufferSizeUniform(*directInteriorProgram);
-  setHintsUniform(*directInteriorProgram);
   setPathColorsUniform(objectIndex, *directInteriorProgram, 0);
-  setEmboldenAmountUniform(objectIndex, *directInteriorProgram);
   mPathTransformBufferTextures[meshIndex]->st->bind(*directInteriorProgram, 1);
   mPathTransformBufferTextures[meshIndex]->ext->bind(*directInteriorProgram, 2);
   Range bQuadInteriorRange = getMeshIndexRange(meshes->bQuadVertexInteriorIndexPathRanges,
@@ -450,31 +521,26 @@ Renderer::directlyRenderObject(int pass, int objectIndex)
                                     )); // was instancedArraysExt.drawElementsInstancedANGLE
   }
 
-  GLDEBUG(glDisable(GL_CULL_FACE));
+  GLDEBUG(GLState::disable(GL_CULL_FACE));
 
   // Render curves, if applicable.
   if (renderingMode != drm_conservative) {
       // Set up direct curve state.
-      GLDEBUG(glDepthMask(GL_FALSE));
-      GLDEBUG(glEnable(GL_BLEND));
-      GLDEBUG(glBlendEquation(GL_FUNC_ADD));
-      GLDEBUG(glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE));
-
-      // Set up the direct curve VAO.
-      //
-      // TODO(pcwalton): Cache these.
+      GLDEBUG(GLState::depthMask(GL_FALSE));
+      GLDEBUG(GLState::enable(GL_BLEND));
+      GLDEBUG(GLState::blendEquation(GL_FUNC_ADD));
+      GLDEBUG(GLState::blendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE));
+
+      // Bind the direct curve VAO.
       ProgramID directCurveProgramName = getDirectCurveProgramName();
       shared_ptr<PathfinderShaderProgram> directCurveProgram = mRenderContext->getShaderManager().getProgram(directCurveProgramName);
+      GLDEBUG(GLState::useProgram(directCurveProgram->getProgram()));
       // was vertexArrayObjectExt.bindVertexArrayOES
-      GLDEBUG(glBindVertexArray(mImplicitCoverCurveVAO));
-      initImplicitCoverCurveVAO(objectIndex, instanceRange);
+      GLDEBUG(GLState::bindVertexArray(mImplicitCoverCurveVAOs[objectIndex]));
 
       // Draw direct curve parts.
-      setTransformUniform(*directCurveProgram, pass, objectIndex);
       setFramebufferSizeUniform(*directCurveProgram);
-      setHintsUniform(*directCurveProgram);
       setPathColorsUniform(objectIndex, *directCurveProgram, 0);
-      setEmboldenAmountUniform(objectIndex, *directCurveProgram);
       mPathTransformBufferTextures[meshIndex]
           ->st
           ->bind(*directCurveProgram, 1);
@@ -492,12 +558,52 @@ Renderer::directlyRenderObject(int pass, int objectIndex)
   }
 
   // was vertexArrayObjectExt.bindVertexArrayOES
-  GLDEBUG(glBindVertexArray(0));
+  GLDEBUG(GLState::bindVertexArray(0));
 
   // Finish direct rendering. Right now, this performs compositing if necessary.
   mAntialiasingStrategy->finishDirectlyRenderingObject(*this, objectIndex);
 }
 
+void
+Renderer::initImplicitCoverVAOs()
+{
+  deleteImplicitCoverVAOs();
+
+  DirectRenderingMode renderingMode = mAntialiasingStrategy->getDirectRenderingMode();
+  if (renderingMode == drm_none || mMeshBuffers.size() == 0) {
+    return;
+  }
+
+  int objectCount = getObjectCount();
+  mImplicitCoverInteriorVAOs.resize(objectCount);
+  mImplicitCoverCurveVAOs.resize(objectCount);
+  GLDEBUG(glGenVertexArrays(objectCount, &mImplicitCoverInteriorVAOs[0])); // was vertexArrayObjectExt.createVertexArrayOES()
+  GLDEBUG(glGenVertexArrays(objectCount, &mImplicitCoverCurveVAOs[0])); // was vertexArrayObjectExt.createVertexArrayOES
+  for (int objectIndex = 0; objectIndex < objectCount; objectIndex++) {
+    Range instanceRange = instanceRangeForObject(objectIndex);
+    GLDEBUG(GLState::bindVertexArray(mImplicitCoverInteriorVAOs[objectIndex])); // was vertexArrayObjectExt.bindVertexArrayOES
+    initImplicitCoverInteriorVAO(objectIndex, instanceRange, renderingMode);
+    if (renderingMode != drm_conservative) {
+      GLDEBUG(GLState::bindVertexArray(mImplicitCoverCurveVAOs[objectIndex])); // was vertexArrayObjectExt.bindVertexArrayOES
+      initImplicitCoverCurveVAO(objectIndex, instanceRange);
+    }
+  }
+  GLDEBUG(GLState::bindVertexArray(0)); // was vertexArrayObjectExt.bindVertexArrayOES
+}
+
+void
+Renderer::deleteImplicitCoverVAOs()
+{
+  if (mImplicitCoverInteriorVAOs.size()) {
+    GLDEBUG(GLState::deleteVertexArrays(mImplicitCoverInteriorVAOs.size(), &mImplicitCoverInteriorVAOs[0]));
+    mImplicitCoverInteriorVAOs.clear();
+  }
+  if (mImplicitCoverCurveVAOs.size()) {
+    GLDEBUG(GLState::deleteVertexArrays(mImplicitCoverCurveVAOs.size(), &mImplicitCoverCurveVAOs[0]));
+    mImplicitCoverCurveVAOs.clear();
+  }
+}
+
 void
 Renderer::initImplicitCoverCurveVAO(int objectIndex, Range instanceRange)
 {
@@ -511,7 +617,7 @@ Renderer::initImplicitCoverCurveVAO(int objectIndex, Range instanceRange)
 
   ProgramID directCurveProgramName = getDirectCurveProgramName();
   shared_ptr<PathfinderShaderProgram> directCurveProgram = mRenderContext->getShaderManager().getProgram(directCurveProgramName);
-  GLDEBUG(glUseProgram(directCurveProgram->getProgram()));
+  GLDEBUG(GLState::useProgram(directCurveProgram->getProgram()));
   GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, meshes->bQuadVertexPositions));
   GLDEBUG(glVertexAttribPointer(directCurveProgram->getAttribute(attribute_aPosition), 2, GL_FLOAT, GL_FALSE, 0, 0));
   GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, mRenderContext->getVertexIDVBO()));
@@ -551,7 +657,7 @@ Renderer::initImplicitCoverInteriorVAO(int objectIndex, Range instanceRange, Dir
 
   ProgramID directInteriorProgramName = getDirectInteriorProgramName(renderingMode);
   shared_ptr<PathfinderShaderProgram> directInteriorProgram = mRenderContext->getShaderManager().getProgram(directInteriorProgramName);
-  GLDEBUG(glUseProgram(directInteriorProgram->getProgram()));
+  GLDEBUG(GLState::useProgram(directInteriorProgram->getProgram()));
   GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, meshes->bQuadVertexPositions));
   GLDEBUG(glVertexAttribPointer(directInteriorProgram->getAttribute(attribute_aPosition),
                         2,
@@ -38,6 +38,16 @@ struct PathTransformBuffers {
   std::shared_ptr<T> ext;
 };
 
+// The std140 layout of the PathUniforms block that the path programs share.
+struct PathUniforms {
+  GLfloat transform[16];
+  GLfloat transformST[4];
+  GLfloat hints[4];
+  GLfloat transformExt[2];
+  GLfloat emboldenAmount[2];
+};
+static_assert(sizeof(PathUniforms) == 112, "PathUniforms must match the std140 layout");
+
 class RenderContext;
 class PathfinderBufferTexture;
 class PathfinderPackedMeshBuffers;
@@ -77,28 +87,49 @@ public:
   virtual bool getIsMulticolor() const = 0;
   virtual bool getNeedsStencil() const = 0;
   virtual GLuint getAtlasFramebuffer() const = 0;
+  // The color attachment of the atlas framebuffer, for strategies that write
+  // the atlas without drawing to it.
+  virtual GLuint getAtlasTexture() const = 0;
+  virtual ColorAlphaFormat getAtlasColorAlphaFormat() const = 0;
   virtual kraken::Vector2i getAtlasAllocatedSize() const = 0;
   virtual kraken::Vector2i getAtlasUsedSize() const = 0;
+  // The part of the atlas that needs to be cleared and re-rendered, as (left,
+  // bottom, right, top) in atlas pixels. Defaults to the whole used area.
+  virtual kraken::Vector4 getAtlasDirtyRect() const;
+  bool getAtlasIsDirty() const;
+  void setAtlasDirtyScissor(kraken::Vector2i aScale);
 
   void attachMeshes(std::vector<std::shared_ptr<PathfinderPackedMeshes>>& meshes);
+  void detachMeshes();
 
   virtual std::shared_ptr<std::vector<float>> pathBoundingRects(int objectIndex) = 0;
-  virtual void setHintsUniform(PathfinderShaderProgram& aProgram) = 0;
+  // Vertical snapping positions, as (x-height, hinted x-height, stem height,
+  // hinted stem height).
+  virtual kraken::Vector4 getHints() const = 0;
   virtual void draw(kraken::Matrix4 aTransform) = 0;
 
   void setFramebufferSizeUniform(PathfinderShaderProgram& aProgram);
   void setTransformAndTexScaleUniformsForDest(PathfinderShaderProgram& aProgram, TileInfo* tileInfo);
   void setTransformSTAndTexScaleUniformsForDest(PathfinderShaderProgram& aProgram);
-  void setTransformUniform(PathfinderShaderProgram& aProgram, int pass, int objectIndex);
-  void setTransformSTUniform(PathfinderShaderProgram& aProgram, int objectIndex);
-  void setTransformAffineUniforms(PathfinderShaderProgram& aProgram, int objectIndex);
   void uploadPathColors(int objectCount);
   void uploadPathTransforms(int objectCount);
+  // Re-uploads only the entries of the paths in aPathRange, which must have
+  // been uploaded in full for this object before.
+  void uploadPathTransforms(int objectIndex,
+                            const PathTransformBuffers<std::vector<float>>& aPathTransforms,
+                            Range aPathRange);
   void setPathColorsUniform(int objectIndex, PathfinderShaderProgram& aProgram, GLuint textureUnit);
-  void setEmboldenAmountUniform(int objectIndex, PathfinderShaderProgram& aProgram);
   int meshIndexForObject(int objectIndex);
-  Range pathRangeForObject(int objectIndex);
+  virtual Range pathRangeForObject(int objectIndex);
   std::vector<std::shared_ptr<PathTransformBuffers<PathfinderBufferTexture>>>& getPathTransformBufferTextures() { return mPathTransformBufferTextures; }
+  // What was last uploaded to the path uniform block and the path transform
+  // textures, for strategies that transform paths on the CPU.
+  const PathUniforms& getPathUniforms() const {
+    return mPathUniforms;
+  }
+  const std::vector<std::shared_ptr<PathTransformBuffers<std::vector<float>>>>& getPathTransforms() const {
+    return mPathTransformData;
+  }
   void bindGammaLUT(kraken::Vector3 bgColor, GLuint textureUnit, PathfinderShaderProgram& aProgram);
   void bindAreaLUT(GLuint textureUnit, PathfinderShaderProgram& aProgram);
 
@@ -143,17 +174,23 @@ protected:
   std::vector<std::shared_ptr<PathfinderPackedMeshes>> mMeshes;
 private:
 
+  void uploadPathUniforms(int pass, int objectIndex);
   void directlyRenderObject(int pass, int objectIndex);
+  void initImplicitCoverVAOs();
+  void deleteImplicitCoverVAOs();
   void initImplicitCoverCurveVAO(int objectIndex, Range instanceRange);
   void initImplicitCoverInteriorVAO(int objectIndex, Range instanceRange, DirectRenderingMode renderingMode);
   kraken::Matrix4 computeTransform(int pass, int objectIndex);
 
 
   std::vector<std::shared_ptr<PathTransformBuffers<PathfinderBufferTexture>>> mPathTransformBufferTextures;
+  std::vector<std::shared_ptr<PathTransformBuffers<std::vector<float>>>> mPathTransformData;
   std::vector<std::shared_ptr<PathfinderPackedMeshBuffers>> mMeshBuffers;
+  PathUniforms mPathUniforms;
 
-  GLuint mImplicitCoverInteriorVAO;
-  GLuint mImplicitCoverCurveVAO;
+  // One of each per object, built when meshes are attached.
+  std::vector<GLuint> mImplicitCoverInteriorVAOs;
+  std::vector<GLuint> mImplicitCoverCurveVAOs;
 };
 
 Range getMeshIndexRange(const std::vector<Range>& indexRanges, Range pathRange);
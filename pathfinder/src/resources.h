@@ -22,14 +22,26 @@ const char* const shader_blit_gamma_fs =
 #include "resources/shaders/gl410/blit-gamma.fs.glsl"
 ;
 
+const char* const shader_blit_gamma_mono_fs =
+#include "resources/shaders/gl410/blit-gamma-mono.fs.glsl"
+;
+
 const char* const shader_blit_linear_fs =
 #include "resources/shaders/gl410/blit-linear.fs.glsl"
 ;
 
+const char* const shader_blit_linear_mono_fs =
+#include "resources/shaders/gl410/blit-linear-mono.fs.glsl"
+;
+
 const char* const shader_blit_vs =
 #include "resources/shaders/gl410/blit.vs.glsl"
 ;
 
+const char* const shader_blit_glyph_vs =
+#include "resources/shaders/gl410/blit-glyph.vs.glsl"
+;
+
 const char* const shader_conservative_interior_vs =
 #include "resources/shaders/gl410/conservative-interior.vs.glsl"
 ;
@@ -58,6 +70,14 @@ const char* const shader_direct_interior_vs =
 #include "resources/shaders/gl410/direct-interior.vs.glsl"
 ;
 
+const char* const shader_fill_accumulate_cs =
+#include "resources/shaders/gl430/fill-accumulate.cs.glsl"
+;
+
+const char* const shader_fill_resolve_cs =
+#include "resources/shaders/gl430/fill-resolve.cs.glsl"
+;
+
 const char* const shader_mcaa_fs =
 #include "resources/shaders/gl410/mcaa.fs.glsl"
 ;
@@ -78,6 +98,14 @@ const char* const shader_stencil_aaa_vs =
 #include "resources/shaders/gl410/stencil-aaa.vs.glsl"
 ;
 
+const char* const shader_stencil_aaa_tile_fs =
+#include "resources/shaders/gl410/stencil-aaa-tile.fs.glsl"
+;
+
+const char* const shader_stencil_aaa_tile_vs =
+#include "resources/shaders/gl410/stencil-aaa-tile.vs.glsl"
+;
+
 const char* const shader_xcaa_mono_resolve_fs =
 #include "resources/shaders/gl410/xcaa-mono-resolve.fs.glsl"
 ;
@@ -0,0 +1,33 @@
+R"(
+// pathfinder/shaders/gl410/blit-gamma-mono.fs.glsl
+//
+// Copyright (c) 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+//! Blits a single-channel coverage texture, applying gamma correction.
+//!
+//! The coverage in the red channel is splatted across all three color channels, so only one
+//! gamma LUT lookup is needed per fragment.
+
+/// The source texture to blit. Only the red channel is used.
+uniform sampler2D uSource;
+/// The approximate background color, in linear RGB.
+uniform vec3 uBGColor;
+/// The gamma LUT.
+uniform sampler2D uGammaLUT;
+
+/// The incoming texture coordinate.
+in vec2 vTexCoord;
+
+out vec4 fragmentColor;
+
+void main() {
+    float coverage = texture(uSource, vTexCoord).r;
+    fragmentColor = vec4(vec3(gammaCorrectChannel(coverage, uBGColor.r, uGammaLUT)), 1.0);
+}
+)"
@@ -0,0 +1,35 @@
+R"(
+// pathfinder/shaders/gl410/blit-glyph.vs.glsl
+//
+// Copyright (c) 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+//! Blits glyphs out of the atlas, one instance per glyph. Each instance
+//! stretches the unit quad over the glyph's rect.
+
+/// A 3D transform to apply to the scene.
+uniform mat4 uTransform;
+/// Scales atlas pixels to texture coordinates.
+uniform vec2 uTexScale;
+
+/// The corner of the unit quad.
+in vec2 aQuadPosition;
+/// The rect of the glyph in the text, as (left, bottom, right, top) in pixels.
+in vec4 aGlyphRect;
+/// The rect of the glyph in the atlas, as (left, bottom, right, top) in pixels.
+in vec4 aGlyphTexRect;
+
+/// The outgoing texture coordinate.
+out vec2 vTexCoord;
+
+void main() {
+    vec2 position = mix(aGlyphRect.xy, aGlyphRect.zw, aQuadPosition);
+    gl_Position = uTransform * vec4(position, 0.0, 1.0);
+    vTexCoord = mix(aGlyphTexRect.xy, aGlyphTexRect.zw, aQuadPosition) * uTexScale;
+}
+)"
@@ -0,0 +1,26 @@
+R"(
+// pathfinder/shaders/gl410/blit-linear-mono.fs.glsl
+//
+// Copyright (c) 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+//! Blits a single-channel coverage texture, splatting the red channel across all three color
+//! channels.
+
+/// The source texture to blit. Only the red channel is used.
+uniform sampler2D uSource;
+
+/// The incoming texture coordinate.
+in vec2 vTexCoord;
+
+out vec4 fragmentColor;
+
+void main() {
+    fragmentColor = vec4(vec3(texture(uSource, vTexCoord).r), 1.0);
+}
+)"
@@ -276,27 +276,22 @@ vec3 gammaCorrect(vec3 fgColor, vec3 bgColor, sampler2D gammaLUT) {
                 gammaCorrectChannel(fgColor.b, bgColor.b, gammaLUT));
 }
 
-vec4 fetchFloat4Data(sampler2D dataTexture, int index, ivec2 dimensions) {
-    ivec2 pixelCoord = ivec2(imod(index, dimensions.x), index / dimensions.x);
-    return texture2D(dataTexture, (vec2(pixelCoord) + 0.5) / vec2(dimensions));
+vec4 fetchFloat4Data(samplerBuffer dataBuffer, int index) {
+    return texelFetch(dataBuffer, index);
 }
 
-vec2 fetchFloat2Data(sampler2D dataTexture, int index, ivec2 dimensions) {
+vec2 fetchFloat2Data(samplerBuffer dataBuffer, int index) {
     int texelIndex = index / 2;
-    vec4 texel = fetchFloat4Data(dataTexture, texelIndex, dimensions);
+    vec4 texel = texelFetch(dataBuffer, texelIndex);
     return texelIndex * 2 == index ? texel.xy : texel.zw;
 }
 
 vec4 fetchPathAffineTransform(out vec2 outPathTransformExt,
-                              sampler2D pathTransformSTTexture,
-                              ivec2 pathTransformSTDimensions,
-                              sampler2D pathTransformExtTexture,
-                              ivec2 pathTransformExtDimensions,
+                              samplerBuffer pathTransformSTBuffer,
+                              samplerBuffer pathTransformExtBuffer,
                               int pathID) {
-    outPathTransformExt = fetchFloat2Data(pathTransformExtTexture,
-                                          pathID,
-                                          pathTransformExtDimensions);
-    return fetchFloat4Data(pathTransformSTTexture, pathID, pathTransformSTDimensions);
+    outPathTransformExt = fetchFloat2Data(pathTransformExtBuffer, pathID);
+    return fetchFloat4Data(pathTransformSTBuffer, pathID);
 }
 
 // Are we inside the convex hull of the curve? (This will always be false if this is a line.)
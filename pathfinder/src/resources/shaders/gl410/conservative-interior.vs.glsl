@@ -18,27 +18,27 @@ R"(
 
 precision highp float;
 
-/// An affine transform to be applied to all points.
-uniform vec4 uTransformST;
-uniform vec2 uTransformExt;
-/// Vertical snapping positions.
-uniform vec4 uHints;
+/// Per-object state shared by all of the path programs. Must match the
+/// `PathUniforms` struct in renderer.h.
+layout(std140) uniform PathUniforms {
+    /// A 3D transform to be applied to all points.
+    mat4 uTransform;
+    /// The same transform in affine form, for the 2D programs.
+    vec4 uTransformST;
+    /// Vertical snapping positions.
+    vec4 uHints;
+    vec2 uTransformExt;
+    /// The amount of faux-bold to apply, in local path units.
+    vec2 uEmboldenAmount;
+};
 /// The framebuffer size in pixels.
 uniform ivec2 uFramebufferSize;
-/// The size of the path colors texture in texels.
-uniform ivec2 uPathColorsDimensions;
 /// The fill color for each path.
-uniform sampler2D uPathColors;
-/// The size of the path transform buffer texture in texels.
-uniform ivec2 uPathTransformSTDimensions;
+uniform samplerBuffer uPathColors;
 /// The path transform buffer texture, one path dilation per texel.
-uniform sampler2D uPathTransformST;
-/// The size of the extra path transform factors buffer texture in texels.
-uniform ivec2 uPathTransformExtDimensions;
+uniform samplerBuffer uPathTransformST;
 /// The extra path transform factors buffer texture, packed two path transforms per texel.
-uniform sampler2D uPathTransformExt;
-/// The amount of faux-bold to apply, in local path units.
-uniform vec2 uEmboldenAmount;
+uniform samplerBuffer uPathTransformExt;
 
 /// The 2D position of this point.
 in vec2 aPosition;
@@ -54,7 +54,7 @@ void main() {
     int pathID = int(aPathID);
     int vertexID = int(aVertexID);
 
-    vec4 transformST = fetchFloat4Data(uPathTransformST, pathID, uPathTransformSTDimensions);
+    vec4 transformST = fetchFloat4Data(uPathTransformST, pathID);
 
     mat2 globalTransformLinear = mat2(uTransformST.x, uTransformExt, uTransformST.y);
     mat2 localTransformLinear = mat2(transformST.x, 0.0, 0.0, transformST.y);
@@ -71,6 +71,6 @@ void main() {
     float depth = convertPathIndexToViewportDepthValue(pathID);
 
     gl_Position = vec4(position, depth, 1.0);
-    vColor = fetchFloat4Data(uPathColors, pathID, uPathColorsDimensions);
+    vColor = fetchFloat4Data(uPathColors, pathID);
 }
 )"
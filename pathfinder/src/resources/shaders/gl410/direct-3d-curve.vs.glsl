@@ -17,22 +17,25 @@ R"(
 
 precision highp float;
 
-/// A 3D transform to be applied to all points.
-uniform mat4 uTransform;
-/// The size of the path transform buffer texture in texels.
-uniform ivec2 uPathTransformSTDimensions;
+/// Per-object state shared by all of the path programs. Must match the
+/// `PathUniforms` struct in renderer.h.
+layout(std140) uniform PathUniforms {
+    /// A 3D transform to be applied to all points.
+    mat4 uTransform;
+    /// The same transform in affine form, for the 2D programs.
+    vec4 uTransformST;
+    /// Vertical snapping positions.
+    vec4 uHints;
+    vec2 uTransformExt;
+    /// The amount of faux-bold to apply, in local path units.
+    vec2 uEmboldenAmount;
+};
 /// The path transform buffer texture, one dilation per path ID.
-uniform sampler2D uPathTransformST;
-/// The size of the extra path transform factors buffer texture in texels.
-uniform ivec2 uPathTransformExtDimensions;
+uniform samplerBuffer uPathTransformST;
 /// The extra path transform factors buffer texture, packed two path transforms per texel.
-uniform sampler2D uPathTransformExt;
-/// The size of the path colors buffer texture in texels.
-uniform ivec2 uPathColorsDimensions;
+uniform samplerBuffer uPathTransformExt;
 /// The path colors buffer texture, one color per path ID.
-uniform sampler2D uPathColors;
-/// The amount of faux-bold to apply, in local path units.
-uniform vec2 uEmboldenAmount;
+uniform samplerBuffer uPathColors;
 
 /// The 2D position of this point.
 in vec2 aPosition;
@@ -55,9 +58,7 @@ void main() {
     vec2 pathTransformExt;
     vec4 pathTransformST = fetchPathAffineTransform(pathTransformExt,
                                                     uPathTransformST,
-                                                    uPathTransformSTDimensions,
                                                     uPathTransformExt,
-                                                    uPathTransformExtDimensions,
                                                     pathID);
 
     vec2 position = dilatePosition(aPosition, aNormalAngle, uEmboldenAmount);
@@ -68,7 +69,7 @@ void main() {
     int vertexIndex = imod(vertexID, 3);
     vec2 texCoord = vec2(float(vertexIndex) * 0.5, float(vertexIndex == 2));
 
-    vColor = fetchFloat4Data(uPathColors, pathID, uPathColorsDimensions);
+    vColor = fetchFloat4Data(uPathColors, pathID);
     vTexCoord = texCoord;
 }
 )"
@@ -17,14 +17,22 @@ R"(
 
 precision highp float;
 
-uniform mat4 uTransform;
-uniform vec2 uEmboldenAmount;
-uniform ivec2 uPathColorsDimensions;
-uniform sampler2D uPathColors;
-uniform ivec2 uPathTransformSTDimensions;
-uniform sampler2D uPathTransformST;
-uniform ivec2 uPathTransformExtDimensions;
-uniform sampler2D uPathTransformExt;
+/// Per-object state shared by all of the path programs. Must match the
+/// `PathUniforms` struct in renderer.h.
+layout(std140) uniform PathUniforms {
+    /// A 3D transform to be applied to all points.
+    mat4 uTransform;
+    /// The same transform in affine form, for the 2D programs.
+    vec4 uTransformST;
+    /// Vertical snapping positions.
+    vec4 uHints;
+    vec2 uTransformExt;
+    /// The amount of faux-bold to apply, in local path units.
+    vec2 uEmboldenAmount;
+};
+uniform samplerBuffer uPathColors;
+uniform samplerBuffer uPathTransformST;
+uniform samplerBuffer uPathTransformExt;
 
 in vec2 aPosition;
 in float aPathID;
@@ -38,9 +46,7 @@ void main() {
     vec2 pathTransformExt;
     vec4 pathTransformST = fetchPathAffineTransform(pathTransformExt,
                                                     uPathTransformST,
-                                                    uPathTransformSTDimensions,
                                                     uPathTransformExt,
-                                                    uPathTransformExtDimensions,
                                                     pathID);
 
     vec2 position = dilatePosition(aPosition, aNormalAngle, uEmboldenAmount);
@@ -48,6 +54,6 @@ void main() {
 
     gl_Position = uTransform * vec4(position, 0.0, 1.0);
 
-    vColor = fetchFloat4Data(uPathColors, pathID, uPathColorsDimensions);
+    vColor = fetchFloat4Data(uPathColors, pathID);
 }
 )"
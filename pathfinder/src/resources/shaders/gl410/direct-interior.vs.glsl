@@ -17,22 +17,25 @@ R"(
 
 precision highp float;
 
-/// A 3D transform to be applied to all points.
-uniform mat4 uTransform;
-/// Vertical snapping positions.
-uniform vec4 uHints;
-/// The size of the path colors texture in texels.
-uniform ivec2 uPathColorsDimensions;
+/// Per-object state shared by all of the path programs. Must match the
+/// `PathUniforms` struct in renderer.h.
+layout(std140) uniform PathUniforms {
+    /// A 3D transform to be applied to all points.
+    mat4 uTransform;
+    /// The same transform in affine form, for the 2D programs.
+    vec4 uTransformST;
+    /// Vertical snapping positions.
+    vec4 uHints;
+    vec2 uTransformExt;
+    /// The amount of faux-bold to apply, in local path units.
+    vec2 uEmboldenAmount;
+};
 /// The fill color for each path.
-uniform sampler2D uPathColors;
-/// The size of the path transform buffer texture in texels.
-uniform ivec2 uPathTransformSTDimensions;
+uniform samplerBuffer uPathColors;
 /// The path transform buffer texture, one path dilation per texel.
-uniform sampler2D uPathTransformST;
-/// The size of the extra path transform factors buffer texture in texels.
-uniform ivec2 uPathTransformExtDimensions;
+uniform samplerBuffer uPathTransformST;
 /// The extra path transform factors buffer texture, packed two path transforms per texel.
-uniform sampler2D uPathTransformExt;
+uniform samplerBuffer uPathTransformExt;
 
 /// The 2D position of this point.
 in vec2 aPosition;
@@ -48,9 +51,7 @@ void main() {
     vec2 pathTransformExt;
     vec4 pathTransformST = fetchPathAffineTransform(pathTransformExt,
                                                     uPathTransformST,
-                                                    uPathTransformSTDimensions,
                                                     uPathTransformExt,
-                                                    uPathTransformExtDimensions,
                                                     pathID);
 
     vec2 position = hintPosition(aPosition, uHints);
@@ -60,6 +61,6 @@ void main() {
     float depth = convertPathIndexToViewportDepthValue(pathID);
     gl_Position = vec4(position, depth, 1.0);
 
-    vColor = fetchFloat4Data(uPathColors, pathID, uPathColorsDimensions);
+    vColor = fetchFloat4Data(uPathColors, pathID);
 }
 )"
@@ -35,21 +35,26 @@ R"(
 
 precision highp float;
 
-/// A scale and transform to be applied to the object.
-uniform vec4 uTransformST;
-uniform vec2 uTransformExt;
+/// Per-object state shared by all of the path programs. Must match the
+/// `PathUniforms` struct in renderer.h.
+layout(std140) uniform PathUniforms {
+    /// A 3D transform to be applied to all points.
+    mat4 uTransform;
+    /// The same transform in affine form, for the 2D programs.
+    vec4 uTransformST;
+    /// Vertical snapping positions.
+    vec4 uHints;
+    vec2 uTransformExt;
+    /// The amount of faux-bold to apply, in local path units.
+    vec2 uEmboldenAmount;
+};
 /// The framebuffer size in pixels.
 uniform ivec2 uFramebufferSize;
-/// The size of the path transform buffer texture in texels.
-uniform ivec2 uPathTransformSTDimensions;
 /// The path transform buffer texture, one dilation per path ID.
-uniform sampler2D uPathTransformST;
-uniform ivec2 uPathTransformExtDimensions;
-uniform sampler2D uPathTransformExt;
-/// The size of the path colors buffer texture in texels.
-uniform ivec2 uPathColorsDimensions;
+uniform samplerBuffer uPathTransformST;
+uniform samplerBuffer uPathTransformExt;
 /// The path colors buffer texture, one color per path ID.
-uniform sampler2D uPathColors;
+uniform samplerBuffer uPathColors;
 /// True if multiple colors are being rendered; false otherwise.
 ///
 /// If this is true, then points will be snapped to the nearest pixel.
@@ -74,16 +79,14 @@ void main() {
 
     vec4 color;
     if (uMulticolor)
-        color = fetchFloat4Data(uPathColors, pathID, uPathColorsDimensions);
+        color = fetchFloat4Data(uPathColors, pathID);
     else
         color = vec4(1.0);
 
     vec2 transformExt;
     vec4 transformST = fetchPathAffineTransform(transformExt,
                                                 uPathTransformST,
-                                                uPathTransformSTDimensions,
                                                 uPathTransformExt,
-                                                uPathTransformExtDimensions,
                                                 pathID);
 
     mat2 globalTransformLinear = mat2(uTransformST.x, uTransformExt, uTransformST.y);
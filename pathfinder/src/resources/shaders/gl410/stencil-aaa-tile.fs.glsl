@@ -0,0 +1,43 @@
+R"(
+// pathfinder/shaders/gl410/stencil-aaa-tile.fs.glsl
+//
+// Copyright (c) 2018 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+//! Computes the exact area of the pixel that lies above the line, as
+//! `fill-accumulate.cs.glsl` does, scaled by its winding.
+
+flat in vec2 vFrom;
+flat in vec2 vTo;
+flat in float vWinding;
+
+out vec4 fragmentColor;
+
+/// The antiderivative of `clamp(u, 0.0, 1.0)`.
+float integrateClampedLinear(float u) {
+    float c = clamp(u, 0.0, 1.0);
+    return c * c * 0.5 + max(u - 1.0, 0.0);
+}
+
+void main() {
+    vec2 pixel = floor(gl_FragCoord.xy);
+    float x0 = max(pixel.x, vFrom.x), x1 = min(pixel.x + 1.0, vTo.x);
+    float width = max(x1 - x0, 0.0);
+
+    float slope = (vTo.y - vFrom.y) / (vTo.x - vFrom.x);
+    float u0 = pixel.y + 1.0 - (vFrom.y + (x0 - vFrom.x) * slope);
+    float u1 = pixel.y + 1.0 - (vFrom.y + (x1 - vFrom.x) * slope);
+    float area;
+    if (abs(u1 - u0) < 0.00001)
+        area = width * clamp(u0, 0.0, 1.0);
+    else
+        area = width * (integrateClampedLinear(u1) - integrateClampedLinear(u0)) / (u1 - u0);
+
+    fragmentColor = vec4(area * vWinding);
+}
+)"
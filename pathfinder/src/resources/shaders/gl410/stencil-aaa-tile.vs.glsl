@@ -0,0 +1,45 @@
+R"(
+// pathfinder/shaders/gl410/stencil-aaa-tile.vs.glsl
+//
+// Copyright (c) 2018 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+//! Covers the area above one line binned by the CPU tiler, up to the top of
+//! the tile it lies in. The line is already transformed and flattened, so
+//! unlike `stencil-aaa.vs.glsl` there is no curve to split.
+
+uniform ivec2 uFramebufferSize;
+/// The tiled region, in supersampled pixels: (x, y, width, height).
+uniform ivec4 uCoverageRect;
+
+in vec2 aTessCoord;
+/// The ends of the line, left first, in pixels of the region.
+in vec2 aFromPosition;
+in vec2 aToPosition;
+in float aTileTop;
+in float aWinding;
+
+flat out vec2 vFrom;
+flat out vec2 vTo;
+flat out float vWinding;
+
+void main() {
+    vec2 origin = vec2(uCoverageRect.xy);
+    vec2 from = aFromPosition + origin, to = aToPosition + origin;
+
+    // Cover every pixel the line touches, and all of those above it.
+    vec2 position;
+    position.x = aTessCoord.x < 0.5 ? floor(from.x) : ceil(to.x);
+    position.y = aTessCoord.y < 0.5 ? floor(min(from.y, to.y)) : aTileTop + origin.y;
+
+    gl_Position = vec4(position / vec2(uFramebufferSize) * 2.0 - 1.0, 0.0, 1.0);
+    vFrom = from;
+    vTo = to;
+    vWinding = aWinding;
+}
+)"
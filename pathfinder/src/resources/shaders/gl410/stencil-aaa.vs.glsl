@@ -9,19 +9,23 @@ R"(
 // option. This file may not be copied, modified, or distributed
 // except according to those terms.
 
-uniform vec4 uTransformST;
-uniform vec2 uTransformExt;
+/// Per-object state shared by all of the path programs. Must match the
+/// `PathUniforms` struct in renderer.h.
+layout(std140) uniform PathUniforms {
+    /// A 3D transform to be applied to all points.
+    mat4 uTransform;
+    /// The same transform in affine form, for the 2D programs.
+    vec4 uTransformST;
+    /// Vertical snapping positions.
+    vec4 uHints;
+    vec2 uTransformExt;
+    /// The amount of faux-bold to apply, in local path units.
+    vec2 uEmboldenAmount;
+};
 uniform ivec2 uFramebufferSize;
-/// Vertical snapping positions.
-uniform vec4 uHints;
-uniform vec2 uEmboldenAmount;
-uniform ivec2 uPathBoundsDimensions;
-uniform sampler2D uPathBounds;
-uniform ivec2 uPathTransformSTDimensions;
-uniform sampler2D uPathTransformST;
-uniform ivec2 uPathTransformExtDimensions;
-uniform sampler2D uPathTransformExt;
-uniform int uSide;
+uniform samplerBuffer uPathBounds;
+uniform samplerBuffer uPathTransformST;
+uniform samplerBuffer uPathTransformExt;
 
 in vec2 aTessCoord;
 in vec2 aFromPosition;
@@ -55,9 +59,7 @@ void main() {
     vec2 transformExt;
     vec4 transformST = fetchPathAffineTransform(transformExt,
                                                 uPathTransformST,
-                                                uPathTransformSTDimensions,
                                                 uPathTransformExt,
-                                                uPathTransformExtDimensions,
                                                 pathID);
 
     // Concatenate transforms.
@@ -71,7 +73,7 @@ void main() {
     to = transformLinear * to;
 
     // Choose correct quadrant for rotation.
-    vec4 bounds = fetchFloat4Data(uPathBounds, pathID, uPathBoundsDimensions);
+    vec4 bounds = fetchFloat4Data(uPathBounds, pathID);
     vec2 fillVector = transformLinear * vec2(0.0, 1.0);
     vec2 corner = transformLinear * vec2(fillVector.x < 0.0 ? bounds.z : bounds.x,
                                          fillVector.y < 0.0 ? bounds.y : bounds.w);
@@ -81,7 +83,8 @@ void main() {
     float t = clamp(v01.x / (v01.x - v12.x), 0.0, 1.0);
     vec2 ctrl0 = mix(from, ctrl, t), ctrl1 = mix(ctrl, to, t);
     vec2 mid = mix(ctrl0, ctrl1, t);
-    if (uSide == 0) {
+    // Each segment is drawn twice, once for either half.
+    if ((gl_InstanceID & 1) == 0) {
         from = mid;
         ctrl = ctrl1;
     } else {
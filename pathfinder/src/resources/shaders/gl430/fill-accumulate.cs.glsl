@@ -0,0 +1,192 @@
+R"(
+// pathfinder/shaders/gl430/fill-accumulate.cs.glsl
+//
+// Copyright (c) 2018 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+//! Accumulates the coverage of one stencil segment per invocation.
+//!
+//! Each segment adds the exact area that lies above it in every pixel it
+//! crosses, stored as the difference from the pixel below, so that a running
+//! sum up each column (see `fill-resolve.cs.glsl`) yields the signed
+//! coverage. Only the pixels a segment crosses are written, plus one above
+//! each column it spans.
+
+#version 430
+
+#define TILE_SIZE           16
+/// Coverage is stored in 16.16 fixed point, as only integer atomics are core.
+#define COVERAGE_ONE        65536.0
+/// How far the lines a curve is flattened into may stray from it, in pixels.
+#define FLATTEN_TOLERANCE   0.1
+#define MAX_CURVE_LINES     32
+
+layout(local_size_x = 64) in;
+
+/// Per-object state shared by all of the path programs. Must match the
+/// `PathUniforms` struct in renderer.h.
+layout(std140) uniform PathUniforms {
+    /// A 3D transform to be applied to all points.
+    mat4 uTransform;
+    /// The same transform in affine form, for the 2D programs.
+    vec4 uTransformST;
+    /// Vertical snapping positions.
+    vec4 uHints;
+    vec2 uTransformExt;
+    /// The amount of faux-bold to apply, in local path units.
+    vec2 uEmboldenAmount;
+};
+
+/// The coverage of the region being rendered, in 16x16 pixel tiles.
+layout(std430, binding = 0) buffer Coverage {
+    int coverage[];
+};
+
+/// The size of the supersampled framebuffer the transforms map to.
+uniform ivec2 uFramebufferSize;
+/// The region being rendered, in supersampled pixels: (x, y, width, height).
+uniform ivec4 uCoverageRect;
+uniform int uFirstSegment;
+uniform int uSegmentCount;
+/// The from, control and to points of each segment, one per texel.
+uniform samplerBuffer uSegments;
+/// The normals at the same points, for emboldening.
+uniform samplerBuffer uSegmentNormals;
+uniform usamplerBuffer uSegmentPathIDs;
+uniform samplerBuffer uPathTransformST;
+uniform samplerBuffer uPathTransformExt;
+
+vec2 hintPosition(vec2 position, vec4 pathHints) {
+    float y;
+    if (position.y >= pathHints.z) {
+        y = position.y - pathHints.z + pathHints.w;
+    } else if (position.y >= pathHints.x) {
+        float t = (position.y - pathHints.x) / (pathHints.z - pathHints.x);
+        y = mix(pathHints.y, pathHints.w, t);
+    } else if (position.y >= 0.0) {
+        y = mix(0.0, pathHints.y, position.y / pathHints.x);
+    } else {
+        y = position.y;
+    }
+
+    return vec2(position.x, y);
+}
+
+vec2 fetchFloat2Data(samplerBuffer dataBuffer, int index) {
+    int texelIndex = index / 2;
+    vec4 texel = texelFetch(dataBuffer, texelIndex);
+    return texelIndex * 2 == index ? texel.xy : texel.zw;
+}
+
+int coverageIndex(ivec2 pixel) {
+    int tilesAcross = (uCoverageRect.z + TILE_SIZE - 1) / TILE_SIZE;
+    ivec2 tile = pixel / TILE_SIZE, pixelInTile = pixel % TILE_SIZE;
+    return ((tile.y * tilesAcross + tile.x) * TILE_SIZE + pixelInTile.y) * TILE_SIZE +
+        pixelInTile.x;
+}
+
+void addCoverage(int x, int row, float delta) {
+    if (row >= uCoverageRect.w || delta == 0.0)
+        return;
+    // Whatever lies below the region still counts towards its first row.
+    row = max(row, 0);
+    atomicAdd(coverage[coverageIndex(ivec2(x, row))], int(round(delta * COVERAGE_ONE)));
+}
+
+/// The antiderivative of `clamp(u, 0.0, 1.0)`.
+float integrateClampedLinear(float u) {
+    float c = clamp(u, 0.0, 1.0);
+    return c * c * 0.5 + max(u - 1.0, 0.0);
+}
+
+/// The area of the pixel in `row`, `width` wide, that lies above the line
+/// running from height `y0` on its left to `y1` on its right.
+float areaAbove(float row, float width, float y0, float y1) {
+    float u0 = row + 1.0 - y0, u1 = row + 1.0 - y1;
+    if (abs(u1 - u0) < 0.00001)
+        return width * clamp(u0, 0.0, 1.0);
+    return width * (integrateClampedLinear(u1) - integrateClampedLinear(u0)) / (u1 - u0);
+}
+
+void accumulateLine(vec2 from, vec2 to) {
+    // Same winding as stencil-aaa.fs.glsl: lines running right subtract.
+    float winding = from.x < to.x ? -1.0 : 1.0;
+    vec2 left = from.x < to.x ? from : to, right = from.x < to.x ? to : from;
+    if (right.x - left.x < 0.00001)
+        return;
+    float slope = (right.y - left.y) / (right.x - left.x);
+
+    int firstColumn = max(int(floor(left.x)), 0);
+    int lastColumn = min(int(ceil(right.x)) - 1, uCoverageRect.z - 1);
+    for (int x = firstColumn; x <= lastColumn; x++) {
+        float x0 = max(float(x), left.x), x1 = min(float(x + 1), right.x);
+        float width = x1 - x0;
+        if (width <= 0.0)
+            continue;
+        float y0 = left.y + (x0 - left.x) * slope, y1 = left.y + (x1 - left.x) * slope;
+
+        // Rows below the region fold into its first, so start there.
+        int firstRow = max(int(floor(min(y0, y1))), 0);
+        int lastRow = int(floor(max(y0, y1)));
+        float lastArea = 0.0;
+        for (int row = firstRow; row <= lastRow && row < uCoverageRect.w; row++) {
+            float area = areaAbove(float(row), width, y0, y1) * winding;
+            addCoverage(x, row, area - lastArea);
+            lastArea = area;
+        }
+        // Every pixel above the line is covered across the whole width.
+        addCoverage(x, lastRow + 1, width * winding - lastArea);
+    }
+}
+
+void main() {
+    int index = int(gl_GlobalInvocationID.x);
+    if (index >= uSegmentCount)
+        return;
+    int segment = uFirstSegment + index;
+
+    // Unpack.
+    vec2 emboldenAmount = uEmboldenAmount * 0.5;
+    int pathID = int(texelFetch(uSegmentPathIDs, segment).r);
+
+    // Hint positions and embolden as necessary.
+    vec2 from = hintPosition(texelFetch(uSegments, segment * 3 + 0).xy, uHints);
+    vec2 ctrl = hintPosition(texelFetch(uSegments, segment * 3 + 1).xy, uHints);
+    vec2 to = hintPosition(texelFetch(uSegments, segment * 3 + 2).xy, uHints);
+    from -= texelFetch(uSegmentNormals, segment * 3 + 0).xy * emboldenAmount;
+    ctrl -= texelFetch(uSegmentNormals, segment * 3 + 1).xy * emboldenAmount;
+    to -= texelFetch(uSegmentNormals, segment * 3 + 2).xy * emboldenAmount;
+
+    // Fetch and concatenate transforms.
+    vec2 transformExt = fetchFloat2Data(uPathTransformExt, pathID);
+    vec4 transformST = texelFetch(uPathTransformST, pathID);
+    mat2 globalTransformLinear = mat2(uTransformST.x, uTransformExt, uTransformST.y);
+    mat2 localTransformLinear = mat2(transformST.x, -transformExt, transformST.y);
+    mat2 transformLinear = globalTransformLinear * localTransformLinear;
+    vec2 translation = uTransformST.zw + globalTransformLinear * transformST.zw;
+
+    // Transform to clip space, then to pixels of the region.
+    vec2 framebufferSizeVector = 0.5 * vec2(uFramebufferSize);
+    vec2 origin = vec2(uCoverageRect.xy);
+    from = (transformLinear * from + translation + 1.0) * framebufferSizeVector - origin;
+    ctrl = (transformLinear * ctrl + translation + 1.0) * framebufferSizeVector - origin;
+    to = (transformLinear * to + translation + 1.0) * framebufferSizeVector - origin;
+
+    // Flatten the curve. Lines have their control point halfway along, so
+    // they come out as one.
+    float deviation = length(from - 2.0 * ctrl + to) * 0.25;
+    int lineCount = clamp(int(ceil(sqrt(deviation / FLATTEN_TOLERANCE))), 1, MAX_CURVE_LINES);
+    vec2 lineFrom = from;
+    for (int line = 1; line <= lineCount; line++) {
+        float t = float(line) / float(lineCount);
+        vec2 lineTo = mix(mix(from, ctrl, t), mix(ctrl, to, t), t);
+        accumulateLine(lineFrom, lineTo);
+        lineFrom = lineTo;
+    }
+}
+)"
@@ -0,0 +1,98 @@
+R"(
+// pathfinder/shaders/gl430/fill-resolve.cs.glsl
+//
+// Copyright (c) 2018 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+//! Sums the coverage left by `fill-accumulate.cs.glsl` up each column of the
+//! region and writes the shaded pixels straight into the atlas.
+//!
+//! Each invocation owns one atlas column. With subpixel AA it keeps running
+//! sums for the nine supersampled columns the LCD filter reads, as
+//! `xcaa-mono-subpixel-resolve.fs.glsl` does with its texture taps.
+
+#version 430
+
+#define TILE_SIZE           16
+#define COVERAGE_ONE        65536.0
+
+layout(local_size_x = TILE_SIZE) in;
+
+layout(std430, binding = 0) readonly buffer Coverage {
+    int coverage[];
+};
+
+/// The region being rendered, in supersampled pixels: (x, y, width, height).
+uniform ivec4 uCoverageRect;
+/// How many supersampled columns make up an atlas pixel.
+uniform int uSupersampleScale;
+/// The background color of the monochrome path.
+uniform vec4 uBGColor;
+/// The foreground color of the monochrome path.
+uniform vec4 uFGColor;
+uniform vec4 uKernel;
+writeonly uniform image2D uAtlas;
+
+int coverageIndex(ivec2 pixel) {
+    int tilesAcross = (uCoverageRect.z + TILE_SIZE - 1) / TILE_SIZE;
+    ivec2 tile = pixel / TILE_SIZE, pixelInTile = pixel % TILE_SIZE;
+    return ((tile.y * tilesAcross + tile.x) * TILE_SIZE + pixelInTile.y) * TILE_SIZE +
+        pixelInTile.x;
+}
+
+float convolve7Tap(vec4 shades0, vec3 shades1, vec4 kernel) {
+    return dot(shades0, kernel) + dot(shades1, kernel.zyx);
+}
+
+void main() {
+    int column = int(gl_GlobalInvocationID.x);
+    if (column * uSupersampleScale >= uCoverageRect.z)
+        return;
+
+    // The supersampled column at the center of this pixel, and the taps
+    // around it. Outside the region nothing has been drawn.
+    int center = column * uSupersampleScale + uSupersampleScale / 2;
+    int firstTap = uSupersampleScale > 1 ? 0 : 4, lastTap = uSupersampleScale > 1 ? 8 : 4;
+    float sums[9];
+    for (int tap = 0; tap < 9; tap++)
+        sums[tap] = 0.0;
+
+    ivec2 atlasOrigin = ivec2(uCoverageRect.x / uSupersampleScale, uCoverageRect.y);
+    for (int row = 0; row < uCoverageRect.w; row++) {
+        for (int tap = firstTap; tap <= lastTap; tap++) {
+            int x = center + tap - 4;
+            if (x >= 0 && x < uCoverageRect.z)
+                sums[tap] += float(coverage[coverageIndex(ivec2(x, row))]) / COVERAGE_ONE;
+        }
+
+        vec4 color;
+        if (uSupersampleScale == 1) {
+            color = mix(uBGColor, uFGColor, min(abs(sums[4]), 1.0));
+        } else {
+            vec4 shadesL = vec4(uKernel.x > 0.0 ? min(abs(sums[0]), 1.0) : 0.0,
+                                min(abs(sums[1]), 1.0),
+                                min(abs(sums[2]), 1.0),
+                                min(abs(sums[3]), 1.0));
+            float shadeC = min(abs(sums[4]), 1.0);
+            vec4 shadesR = vec4(min(abs(sums[5]), 1.0),
+                                min(abs(sums[6]), 1.0),
+                                min(abs(sums[7]), 1.0),
+                                uKernel.x > 0.0 ? min(abs(sums[8]), 1.0) : 0.0);
+
+            vec3 shades = vec3(convolve7Tap(shadesL, vec3(shadeC, shadesR.xy), uKernel),
+                               convolve7Tap(vec4(shadesL.yzw, shadeC), shadesR.xyz, uKernel),
+                               convolve7Tap(vec4(shadesL.zw, shadeC, shadesR.x), shadesR.yzw, uKernel));
+
+            vec3 rgb = mix(uBGColor.rgb, uFGColor.rgb, shades);
+            float alpha = any(greaterThan(shades, vec3(0.0))) ? uFGColor.a : uBGColor.a;
+            color = alpha * vec4(rgb, 1.0);
+        }
+        imageStore(uAtlas, atlasOrigin + ivec2(column, row), color);
+    }
+}
+)"
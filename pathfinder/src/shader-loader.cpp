@@ -25,16 +25,19 @@ ShaderManager::~ShaderManager()
 }
 
 GLuint
-ShaderManager::loadShader(const char* aName, const char* aSource, GLenum aType)
+ShaderManager::loadShader(const char* aName, const char* aSource, GLenum aType, bool aIncludeCommon)
 {
   const char* shader_source[2];
-  shader_source[0] = shader_common;
-  shader_source[1] = aSource;
+  GLsizei sourceCount = 0;
+  if (aIncludeCommon) {
+    shader_source[sourceCount++] = shader_common;
+  }
+  shader_source[sourceCount++] = aSource;
 
   GLuint shader = 0;
 
   GLDEBUG(shader = glCreateShader(aType));
-  GLDEBUG(glShaderSource(shader, 2, shader_source, NULL));
+  GLDEBUG(glShaderSource(shader, sourceCount, shader_source, NULL));
   GLDEBUG(glCompileShader(shader));
 
   // Report any compile issues to stderr
@@ -44,7 +47,8 @@ ShaderManager::loadShader(const char* aName, const char* aSource, GLenum aType)
   if (!compile_success) {
     // Report any compile issues to stderr
     fprintf(stderr, "Failed to compile %s shader: %s\n",
-            aType == GL_VERTEX_SHADER ? "vertex": "fragment",
+            aType == GL_VERTEX_SHADER ? "vertex" :
+              aType == GL_FRAGMENT_SHADER ? "fragment" : "compute",
             aName);
     GLsizei logLength = 0; // In case glGetShaderiv fails
     GLDEBUG(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength));
@@ -66,7 +70,7 @@ ShaderManager::loadShader(const char* aName, const char* aSource, GLenum aType)
 }
 
 bool
-ShaderManager::init()
+ShaderManager::init(bool aLoadComputePrograms)
 {
   bool succeeded = true;
   GLuint vertexShaders[vs_count];
@@ -77,7 +81,8 @@ ShaderManager::init()
   for (int i = 0; i < vs_count && succeeded; i++) {
     vertexShaders[i] = loadShader(VertexShaderNames[i],
                                   VertexShaderSource[i],
-                                  GL_VERTEX_SHADER);
+                                  GL_VERTEX_SHADER,
+                                  true);
     if (vertexShaders[i] == 0) {
       succeeded = false;
     }
@@ -85,13 +90,15 @@ ShaderManager::init()
   for (int i = 0; i < fs_count && succeeded; i++) {
     fragmentShaders[i] = loadShader(FragmentShaderNames[i],
                                   FragmentShaderSource[i],
-                                  GL_FRAGMENT_SHADER);
+                                  GL_FRAGMENT_SHADER,
+                                  true);
     if (fragmentShaders[i] == 0) {
       succeeded = false;
     }
   }
 
-  for (int i = 0; i < program_count && succeeded; i++) {
+  int graphicsProgramCount = sizeof(PROGRAM_INFO) / sizeof(PROGRAM_INFO[0]);
+  for (int i = 0; i < graphicsProgramCount && succeeded; i++) {
     shared_ptr<PathfinderShaderProgram> program = make_shared<PathfinderShaderProgram>();
     if(program->load(PROGRAM_INFO[i].name,
                      vertexShaders[PROGRAM_INFO[i].vertex],
@@ -108,9 +115,53 @@ ShaderManager::init()
   for(int i = 0; i < fs_count; i++) {
     GLDEBUG(glDeleteShader(fragmentShaders[i]));
   }
+
+  if (succeeded && aLoadComputePrograms) {
+    succeeded = loadComputePrograms();
+  }
   return succeeded;
 }
 
+bool
+ShaderManager::loadComputePrograms()
+{
+#ifdef GL_VERSION_4_3
+  bool succeeded = true;
+  GLuint computeShaders[cs_count];
+  memset(computeShaders, 0, sizeof(computeShaders));
+
+  // The compute shaders declare a newer GLSL version than the common
+  // prelude, so they carry their own copies of the helpers they need.
+  for (int i = 0; i < cs_count && succeeded; i++) {
+    computeShaders[i] = loadShader(ComputeShaderNames[i],
+                                   ComputeShaderSource[i],
+                                   GL_COMPUTE_SHADER,
+                                   false);
+    if (computeShaders[i] == 0) {
+      succeeded = false;
+    }
+  }
+
+  int computeProgramCount = sizeof(COMPUTE_PROGRAM_INFO) / sizeof(COMPUTE_PROGRAM_INFO[0]);
+  for (int i = 0; i < computeProgramCount && succeeded; i++) {
+    shared_ptr<PathfinderShaderProgram> program = make_shared<PathfinderShaderProgram>();
+    if (program->load(COMPUTE_PROGRAM_INFO[i].name,
+                      computeShaders[COMPUTE_PROGRAM_INFO[i].compute])) {
+      mPrograms[COMPUTE_PROGRAM_INFO[i].id] = program;
+    } else {
+      succeeded = false;
+    }
+  }
+
+  for (int i = 0; i < cs_count; i++) {
+    GLDEBUG(glDeleteShader(computeShaders[i]));
+  }
+  return succeeded;
+#else
+  return false;
+#endif
+}
+
 std::shared_ptr<PathfinderShaderProgram>
 ShaderManager::getProgram(ProgramID aProgramID)
 {
@@ -140,11 +191,26 @@ PathfinderShaderProgram::load(const char* aProgramName,
                               GLuint aVertexShader,
                               GLuint aFragmentShader)
 {
-  // TODO(kearwood) replace stderr output with logging function
   mProgramName = aProgramName;
   GLDEBUG(mProgram = glCreateProgram());
   GLDEBUG(glAttachShader(mProgram, aVertexShader));
   GLDEBUG(glAttachShader(mProgram, aFragmentShader));
+  return link();
+}
+
+bool
+PathfinderShaderProgram::load(const char* aProgramName, GLuint aComputeShader)
+{
+  mProgramName = aProgramName;
+  GLDEBUG(mProgram = glCreateProgram());
+  GLDEBUG(glAttachShader(mProgram, aComputeShader));
+  return link();
+}
+
+bool
+PathfinderShaderProgram::link()
+{
+  // TODO(kearwood) replace stderr output with logging function
   GLDEBUG(glLinkProgram(mProgram));
 
   // Report any link issues to stderr
@@ -153,7 +219,7 @@ PathfinderShaderProgram::load(const char* aProgramName,
   
   if (!link_success) {
     // Report any linking issues to stderr
-    fprintf(stderr, "Failed to link shader program: %s\n", aProgramName);
+    fprintf(stderr, "Failed to link shader program: %s\n", mProgramName.c_str());
     GLsizei logLength = 0; // In case glGetProgramiv fails
     GLDEBUG(glGetProgramiv(mProgram, GL_INFO_LOG_LENGTH, &logLength));
     if (logLength > 0) {
@@ -176,6 +242,13 @@ PathfinderShaderProgram::load(const char* aProgramName,
   for (int i = 0; i < attribute_count; i++) {
     GLDEBUG(mAttributes[i] = glGetAttribLocation(mProgram, ATTRIBUTE_NAMES[i]));
   }
+  for (int i = 0; i < uniform_block_count; i++) {
+    GLuint blockIndex = GL_INVALID_INDEX;
+    GLDEBUG(blockIndex = glGetUniformBlockIndex(mProgram, UNIFORM_BLOCK_NAMES[i]));
+    if (blockIndex != GL_INVALID_INDEX) {
+      GLDEBUG(glUniformBlockBinding(mProgram, blockIndex, i));
+    }
+  }
 
   return true;
 }
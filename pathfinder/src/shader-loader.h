@@ -22,6 +22,7 @@ namespace pathfinder {
 
 #define VERTEX_SHADER_LIST \
 SHADER_ITEM(blit) \
+SHADER_ITEM(blit_glyph) \
 SHADER_ITEM(conservative_interior) \
 SHADER_ITEM(direct_curve) \
 SHADER_ITEM(direct_interior) \
@@ -29,23 +30,30 @@ SHADER_ITEM(direct_3d_curve) \
 SHADER_ITEM(direct_3d_interior) \
 SHADER_ITEM(mcaa) \
 SHADER_ITEM(stencil_aaa) \
+SHADER_ITEM(stencil_aaa_tile) \
 SHADER_ITEM(xcaa_mono_resolve) \
 SHADER_ITEM(xcaa_mono_subpixel_resolve)
 
 #define FRAGMENT_SHADER_LIST \
 SHADER_ITEM(blit_gamma) \
+SHADER_ITEM(blit_gamma_mono) \
 SHADER_ITEM(blit_linear) \
+SHADER_ITEM(blit_linear_mono) \
 SHADER_ITEM(direct_curve) \
 SHADER_ITEM(direct_interior) \
 SHADER_ITEM(mcaa) \
 SHADER_ITEM(ssaa_subpixel_resolve) \
 SHADER_ITEM(stencil_aaa) \
+SHADER_ITEM(stencil_aaa_tile) \
 SHADER_ITEM(xcaa_mono_resolve) \
 SHADER_ITEM(xcaa_mono_subpixel_resolve)
 
 #define PROGRAM_LIST \
 PROGRAM_ITEM(blitLinear,              blit_linear,                blit) \
-PROGRAM_ITEM(blitGamma,               blit_gamma,                 blit) \
+PROGRAM_ITEM(blitGlyphLinear,         blit_linear,                blit_glyph) \
+PROGRAM_ITEM(blitGlyphGamma,          blit_gamma,                 blit_glyph) \
+PROGRAM_ITEM(blitGlyphLinearMono,     blit_linear_mono,           blit_glyph) \
+PROGRAM_ITEM(blitGlyphGammaMono,      blit_gamma_mono,            blit_glyph) \
 PROGRAM_ITEM(conservativeInterior,    direct_interior,            conservative_interior) \
 PROGRAM_ITEM(directCurve,             direct_curve,               direct_curve) \
 PROGRAM_ITEM(directInterior,          direct_interior,            direct_interior) \
@@ -54,32 +62,45 @@ PROGRAM_ITEM(direct3DInterior,        direct_interior,            direct_3d_inte
 PROGRAM_ITEM(mcaa,                    mcaa,                       mcaa) \
 PROGRAM_ITEM(ssaaSubpixelResolve,     ssaa_subpixel_resolve,      blit) \
 PROGRAM_ITEM(stencilAAA,              stencil_aaa,                stencil_aaa) \
+PROGRAM_ITEM(stencilAAATile,          stencil_aaa_tile,           stencil_aaa_tile) \
 PROGRAM_ITEM(xcaaMonoResolve,         xcaa_mono_resolve,          xcaa_mono_resolve) \
 PROGRAM_ITEM(xcaaMonoSubpixelResolve, xcaa_mono_subpixel_resolve, xcaa_mono_subpixel_resolve)
 
+// Compute shaders need GL 4.3, so they are only loaded where it is supported.
+#define COMPUTE_SHADER_LIST \
+SHADER_ITEM(fill_accumulate) \
+SHADER_ITEM(fill_resolve)
+
+#define COMPUTE_PROGRAM_LIST \
+COMPUTE_PROGRAM_ITEM(fillAccumulate, fill_accumulate) \
+COMPUTE_PROGRAM_ITEM(fillResolve,    fill_resolve)
+
 #define UNIFORM_LIST \
 UNIFORM_ITEM(uAAAlpha) \
 UNIFORM_ITEM(uAAAlphaDimensions) \
 UNIFORM_ITEM(uAreaLUT) \
+UNIFORM_ITEM(uAtlas) \
 UNIFORM_ITEM(uBGColor) \
+UNIFORM_ITEM(uCoverageRect) \
 UNIFORM_ITEM(uEmboldenAmount) \
 UNIFORM_ITEM(uFGColor) \
+UNIFORM_ITEM(uFirstSegment) \
 UNIFORM_ITEM(uFramebufferSize) \
 UNIFORM_ITEM(uGammaLUT) \
 UNIFORM_ITEM(uHints) \
 UNIFORM_ITEM(uKernel) \
 UNIFORM_ITEM(uMulticolor) \
 UNIFORM_ITEM(uPathBounds) \
-UNIFORM_ITEM(uPathBoundsDimensions) \
 UNIFORM_ITEM(uPathColors) \
-UNIFORM_ITEM(uPathColorsDimensions) \
 UNIFORM_ITEM(uPathTransformExt) \
-UNIFORM_ITEM(uPathTransformExtDimensions) \
 UNIFORM_ITEM(uPathTransformST) \
-UNIFORM_ITEM(uPathTransformSTDimensions) \
-UNIFORM_ITEM(uSide) \
+UNIFORM_ITEM(uSegmentCount) \
+UNIFORM_ITEM(uSegmentNormals) \
+UNIFORM_ITEM(uSegmentPathIDs) \
+UNIFORM_ITEM(uSegments) \
 UNIFORM_ITEM(uSource) \
 UNIFORM_ITEM(uSourceDimensions) \
+UNIFORM_ITEM(uSupersampleScale) \
 UNIFORM_ITEM(uTexScale) \
 UNIFORM_ITEM(uTransform) \
 UNIFORM_ITEM(uTransformExt) \
@@ -92,19 +113,27 @@ ATTRIBUTE_ITEM(aDUVDX) \
 ATTRIBUTE_ITEM(aDUVDY) \
 ATTRIBUTE_ITEM(aFromNormal) \
 ATTRIBUTE_ITEM(aFromPosition) \
+ATTRIBUTE_ITEM(aGlyphRect) \
+ATTRIBUTE_ITEM(aGlyphTexRect) \
 ATTRIBUTE_ITEM(aNormalAngle) \
 ATTRIBUTE_ITEM(aPathID) \
 ATTRIBUTE_ITEM(aPosition) \
+ATTRIBUTE_ITEM(aQuadPosition) \
 ATTRIBUTE_ITEM(aRect) \
 ATTRIBUTE_ITEM(aSignMode) \
 ATTRIBUTE_ITEM(aTessCoord) \
 ATTRIBUTE_ITEM(aTexCoord) \
+ATTRIBUTE_ITEM(aTileTop) \
 ATTRIBUTE_ITEM(aToNormal) \
 ATTRIBUTE_ITEM(aToPosition) \
 ATTRIBUTE_ITEM(aUV) \
-ATTRIBUTE_ITEM(aVertexID)
+ATTRIBUTE_ITEM(aVertexID) \
+ATTRIBUTE_ITEM(aWinding)
 
 
+#define UNIFORM_BLOCK_LIST \
+UNIFORM_BLOCK_ITEM(PathUniforms)
+
 typedef enum {
 #define UNIFORM_ITEM(name) \
   uniform_ ## name ,
@@ -120,6 +149,22 @@ UNIFORM_LIST
 #undef UNIFORM_ITEM
 };
 
+// Each uniform block is bound to the binding point numbered by its ID.
+typedef enum {
+#define UNIFORM_BLOCK_ITEM(name) \
+  uniform_block_ ## name ,
+UNIFORM_BLOCK_LIST
+#undef UNIFORM_BLOCK_ITEM
+  uniform_block_count
+} UniformBlockID;
+
+static const char* UNIFORM_BLOCK_NAMES[] {
+#define UNIFORM_BLOCK_ITEM(name) \
+  #name ,
+UNIFORM_BLOCK_LIST
+#undef UNIFORM_BLOCK_ITEM
+};
+
 typedef enum {
 #define ATTRIBUTE_ITEM(name) \
   attribute_ ## name ,
@@ -151,11 +196,23 @@ FRAGMENT_SHADER_LIST
   fs_count
 } FragmentShaderID;
 
+typedef enum {
+#define SHADER_ITEM(name) \
+  cs_ ## name ,
+COMPUTE_SHADER_LIST
+#undef SHADER_ITEM
+  cs_count
+} ComputeShaderID;
+
 typedef enum {
 #define PROGRAM_ITEM(name, frag_src, vert_src) \
   program_ ## name ,
 PROGRAM_LIST
 #undef PROGRAM_ITEM
+#define COMPUTE_PROGRAM_ITEM(name, comp_src) \
+  program_ ## name ,
+COMPUTE_PROGRAM_LIST
+#undef COMPUTE_PROGRAM_ITEM
   program_count
 } ProgramID;
 
@@ -173,6 +230,13 @@ FRAGMENT_SHADER_LIST
 #undef SHADER_ITEM
 };
 
+static const char* ComputeShaderSource[] {
+#define SHADER_ITEM(name) \
+  shader_ ## name ## _cs,
+COMPUTE_SHADER_LIST
+#undef SHADER_ITEM
+};
+
 
 static const char* VertexShaderNames[] {
 #define SHADER_ITEM(name) \
@@ -188,6 +252,13 @@ FRAGMENT_SHADER_LIST
 #undef SHADER_ITEM
 };
 
+static const char* ComputeShaderNames[] {
+#define SHADER_ITEM(name) \
+  #name ,
+COMPUTE_SHADER_LIST
+#undef SHADER_ITEM
+};
+
 struct ProgramInfo {
   const char* name;
   GLuint vertex;
@@ -205,6 +276,25 @@ PROGRAM_LIST
 #undef PROGRAM_ITEM
 };
 
+struct ComputeProgramInfo {
+  const char* name;
+  ProgramID id;
+  GLuint compute;
+};
+
+static const ComputeProgramInfo COMPUTE_PROGRAM_INFO[] = {
+#define COMPUTE_PROGRAM_ITEM(name, comp_src) \
+{ \
+    #name, \
+    program_ ## name , \
+    cs_ ## comp_src \
+},
+COMPUTE_PROGRAM_LIST
+#undef COMPUTE_PROGRAM_ITEM
+};
+
+#undef COMPUTE_PROGRAM_LIST
+#undef COMPUTE_SHADER_LIST
 #undef PROGRAM_LIST
 #undef FRAGMENT_SHADER_LIST
 #undef VERTEX_SHADER_LIST
@@ -219,13 +309,15 @@ public:
   ShaderManager(const ShaderManager&) = delete;
   ShaderManager& operator=(const ShaderManager&) = delete;
 
-  bool init();
+  // The compute programs are left null unless aLoadComputePrograms is set.
+  bool init(bool aLoadComputePrograms);
 
   std::shared_ptr<PathfinderShaderProgram> getProgram(ProgramID aProgramID);
 
 private:
   std::vector<std::shared_ptr<PathfinderShaderProgram>> mPrograms;
-  GLuint loadShader(const char* aName, const char* aSource, GLenum aType);
+  GLuint loadShader(const char* aName, const char* aSource, GLenum aType, bool aIncludeCommon);
+  bool loadComputePrograms();
 }; // class ShaderManager
 
 class PathfinderShaderProgram
@@ -238,6 +330,7 @@ public:
   bool load(const char* aProgramName,
             GLuint aVertexShader,
             GLuint aFragmentShader);
+  bool load(const char* aProgramName, GLuint aComputeShader);
   GLuint getProgram() {
     return mProgram;
   }
@@ -251,6 +344,7 @@ public:
 private:
   GLuint mProgram;
   std::string mProgramName;
+  bool link();
   GLint mAttributes[attribute_count];
   GLint mUniforms[uniform_count];
 };
@@ -32,15 +32,15 @@ SSAAStrategy::SSAAStrategy(int aLevel, SubpixelAAType aSubpixelAA)
 SSAAStrategy::~SSAAStrategy()
 {
   if (supersampledFramebuffer) {
-    GLDEBUG(glDeleteFramebuffers(1, &supersampledFramebuffer));
+    GLDEBUG(GLState::deleteFramebuffers(1, &supersampledFramebuffer));
     supersampledFramebuffer = 0;
   }
   if (supersampledColorTexture) {
-    GLDEBUG(glDeleteTextures(1, &supersampledColorTexture));
+    GLDEBUG(GLState::deleteTextures(1, &supersampledColorTexture));
     supersampledColorTexture = 0;
   }
   if (supersampledDepthTexture) {
-    GLDEBUG(glDeleteTextures(1, &supersampledDepthTexture));
+    GLDEBUG(GLState::deleteTextures(1, &supersampledDepthTexture));
     supersampledDepthTexture = 0;
   }
 }
@@ -81,7 +81,7 @@ SSAAStrategy::init(Renderer& renderer)
 
   supersampledFramebuffer = createFramebuffer(supersampledColorTexture, supersampledDepthTexture);
 
-  GLDEBUG(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+  GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, 0));
   return true;
 }
 
@@ -99,47 +99,62 @@ SSAAStrategy::getTransform() const
 void
 SSAAStrategy::prepareForRendering(Renderer& renderer)
 {
-  Vector2i usedSize = usedSupersampledFramebufferSize(renderer);
-  GLDEBUG(glBindFramebuffer(GL_FRAMEBUFFER, supersampledFramebuffer));
-  GLDEBUG(glViewport(0, 0, mSupersampledFramebufferSize[0], mSupersampledFramebufferSize[1]));
-  GLDEBUG(glScissor(0, 0, usedSize[0], usedSize[1]));
-  GLDEBUG(glEnable(GL_SCISSOR_TEST));
+  GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, supersampledFramebuffer));
+  GLDEBUG(GLState::viewport(0, 0, mSupersampledFramebufferSize[0], mSupersampledFramebufferSize[1]));
+  setSupersampledScissor(renderer);
 
   Vector4 clearColor = renderer.getBGColor();
-  GLDEBUG(glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
-  GLDEBUG(glClearDepth(0.0));
+  GLDEBUG(GLState::clearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
+  GLDEBUG(GLState::clearDepth(0.0));
   GLDEBUG(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 }
 
 void
 SSAAStrategy::prepareToRenderObject(Renderer& renderer, int objectIndex)
 {
-  GLDEBUG(glBindFramebuffer(GL_FRAMEBUFFER, supersampledFramebuffer));
-  GLDEBUG(glViewport(0,
+  GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, supersampledFramebuffer));
+  GLDEBUG(GLState::viewport(0,
     0,
     mSupersampledFramebufferSize[0],
     mSupersampledFramebufferSize[1]));
-  GLDEBUG(glDisable(GL_SCISSOR_TEST));
+  setSupersampledScissor(renderer);
+}
+
+void
+SSAAStrategy::setSupersampledScissor(Renderer& renderer)
+{
+  // When the atlas is rendered in a single tile, the supersampled framebuffer
+  // maps directly onto the atlas, so only the dirty region needs to be drawn.
+  Vector2i tileSize = getTileSize();
+  if (tileSize[0] == 1 && tileSize[1] == 1) {
+    renderer.setAtlasDirtyScissor(supersampleScale());
+    return;
+  }
+
+  Vector2i usedSize = usedSupersampledFramebufferSize(renderer);
+  GLDEBUG(GLState::scissor(0, 0, usedSize[0], usedSize[1]));
+  GLDEBUG(GLState::enable(GL_SCISSOR_TEST));
 }
 
 void
 SSAAStrategy::resolve(int pass, Renderer& renderer)
 {
   RenderContext& renderContext = *renderer.getRenderContext();
-  GLDEBUG(glBindFramebuffer(GL_FRAMEBUFFER, renderer.getAtlasFramebuffer()));
-  GLDEBUG(glViewport(0, 0, renderer.getAtlasAllocatedSize()[0], renderer.getAtlasAllocatedSize()[1]));
-  GLDEBUG(glDisable(GL_DEPTH_TEST));
-  GLDEBUG(glDisable(GL_BLEND));
+  GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, renderer.getAtlasFramebuffer()));
+  GLDEBUG(GLState::viewport(0, 0, renderer.getAtlasAllocatedSize()[0], renderer.getAtlasAllocatedSize()[1]));
+  renderer.setAtlasDirtyScissor(Vector2i::One());
+  GLDEBUG(GLState::disable(GL_DEPTH_TEST));
+  GLDEBUG(GLState::disable(GL_BLEND));
 
   // Set up the blit program VAO.
   PathfinderShaderProgram& resolveProgram = *renderContext.getShaderManager().getProgram(mSubpixelAA == saat_none ? program_blitLinear : program_ssaaSubpixelResolve);
 
-  GLDEBUG(glUseProgram(resolveProgram.getProgram()));
+  GLDEBUG(GLState::useProgram(resolveProgram.getProgram()));
   renderContext.initQuadVAO(resolveProgram);
 
   // Resolve framebuffer.
-  GLDEBUG(glActiveTexture(GL_TEXTURE0));
-  GLDEBUG(glBindTexture(GL_TEXTURE_2D, supersampledColorTexture));
+  GLDEBUG(GLState::activeTexture(GL_TEXTURE0));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_2D, supersampledColorTexture));
   GLDEBUG(glUniform1i(resolveProgram.getUniform(uniform_uSource), 0));
   if (resolveProgram.hasUniform(uniform_uSourceDimensions)) {
     GLDEBUG(glUniform2i(resolveProgram.getUniform(uniform_uSourceDimensions),
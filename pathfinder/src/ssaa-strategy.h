@@ -52,6 +52,7 @@ private:
   kraken::Vector2i supersampleScale() const;
   kraken::Vector2i getTileSize() const;
   kraken::Vector2i usedSupersampledFramebufferSize(Renderer& renderer) const;
+  void setSupersampledScissor(Renderer& renderer);
 
 }; // class SSAAStrategy
 
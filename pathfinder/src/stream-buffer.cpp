@@ -0,0 +1,162 @@
+// pathfinder/src/stream-buffer.cpp
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#include "stream-buffer.h"
+#include "gl-utils.h"
+
+#include <assert.h>
+#include <string.h>
+
+using namespace std;
+
+namespace pathfinder {
+
+const GLsizeiptr STREAM_BUFFER_SIZE = STREAM_BUFFER_REGION_SIZE * STREAM_BUFFER_REGION_COUNT;
+
+StreamBuffer::StreamBuffer()
+  : mBuffer(0)
+  , mMapping(nullptr)
+  , mRegion(0)
+  , mOffset(0)
+  , mUniformAlignment(256)
+{
+  for (int region = 0; region < STREAM_BUFFER_REGION_COUNT; region++) {
+    mFences[region] = 0;
+  }
+}
+
+StreamBuffer::~StreamBuffer()
+{
+  for (int region = 0; region < STREAM_BUFFER_REGION_COUNT; region++) {
+    if (mFences[region]) {
+      GLDEBUG(glDeleteSync(mFences[region]));
+      mFences[region] = 0;
+    }
+  }
+  // Deleting the buffer also unmaps it.
+  if (mBuffer) {
+    GLDEBUG(glDeleteBuffers(1, &mBuffer));
+    mBuffer = 0;
+    mMapping = nullptr;
+  }
+}
+
+bool
+StreamBuffer::init(bool aPersistent)
+{
+  GLDEBUG(glCreateBuffers(1, &mBuffer));
+  GLDEBUG(glBindBuffer(GL_COPY_READ_BUFFER, mBuffer));
+#ifdef GL_VERSION_4_4
+  if (aPersistent) {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLDEBUG(glBufferStorage(GL_COPY_READ_BUFFER, STREAM_BUFFER_SIZE, NULL, flags));
+    mMapping = (__uint8_t*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, STREAM_BUFFER_SIZE, flags);
+    if (mMapping == nullptr) {
+      return false;
+    }
+  }
+#endif
+  if (mMapping == nullptr) {
+    GLDEBUG(glBufferData(GL_COPY_READ_BUFFER, STREAM_BUFFER_SIZE, NULL, GL_STREAM_DRAW));
+  }
+  GLDEBUG(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &mUniformAlignment));
+  return true;
+}
+
+void
+StreamBuffer::upload(GLuint aBuffer, GLintptr aOffset, const void* aData, GLsizeiptr aSize)
+{
+  if (aSize <= 0) {
+    return;
+  }
+  GLDEBUG(glBindBuffer(GL_COPY_WRITE_BUFFER, aBuffer));
+  if (aSize > STREAM_BUFFER_REGION_SIZE) {
+    GLDEBUG(glBufferSubData(GL_COPY_WRITE_BUFFER, aOffset, aSize, aData));
+    return;
+  }
+  GLintptr source = write(aData, aSize, 4);
+  GLDEBUG(glBindBuffer(GL_COPY_READ_BUFFER, mBuffer));
+  GLDEBUG(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, source, aOffset, aSize));
+}
+
+void
+StreamBuffer::bindUniformBlock(GLuint aIndex, const void* aData, GLsizeiptr aSize)
+{
+  GLintptr offset = write(aData, aSize, mUniformAlignment);
+  GLDEBUG(glBindBufferRange(GL_UNIFORM_BUFFER, aIndex, mBuffer, offset, aSize));
+}
+
+GLintptr
+StreamBuffer::write(const void* aData, GLsizeiptr aSize, GLsizeiptr aAlignment)
+{
+  assert(aSize <= STREAM_BUFFER_REGION_SIZE);
+
+  // Without fences the whole ring is one region.
+  GLintptr regionEnd = mMapping ? (mRegion + 1) * STREAM_BUFFER_REGION_SIZE : STREAM_BUFFER_SIZE;
+  GLintptr offset = (mOffset + aAlignment - 1) / aAlignment * aAlignment;
+  if (offset + aSize > regionEnd) {
+    nextRegion();
+    offset = mOffset;
+  }
+
+  if (mMapping) {
+    memcpy(mMapping + offset, aData, aSize);
+  } else {
+    // Nothing queued reads past mOffset, so there is no need to wait.
+    GLDEBUG(glBindBuffer(GL_COPY_READ_BUFFER, mBuffer));
+    void* mapping = glMapBufferRange(GL_COPY_READ_BUFFER,
+                                     offset,
+                                     aSize,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapping) {
+      memcpy(mapping, aData, aSize);
+      GLDEBUG(glUnmapBuffer(GL_COPY_READ_BUFFER));
+    } else {
+      // Some drivers refuse unsynchronized maps. Take the error they raised
+      // and copy the data in instead.
+      glGetError();
+      GLDEBUG(glBufferSubData(GL_COPY_READ_BUFFER, offset, aSize, aData));
+    }
+  }
+  mOffset = offset + aSize;
+  return offset;
+}
+
+void
+StreamBuffer::nextRegion()
+{
+  if (mMapping == nullptr) {
+    // Orphan the ring. Commands still reading the old storage keep it alive.
+    GLDEBUG(glBindBuffer(GL_COPY_READ_BUFFER, mBuffer));
+    GLDEBUG(glBufferData(GL_COPY_READ_BUFFER, STREAM_BUFFER_SIZE, NULL, GL_STREAM_DRAW));
+    mOffset = 0;
+    return;
+  }
+
+  // Every command that reads the region just filled has been issued by now.
+  if (mFences[mRegion]) {
+    GLDEBUG(glDeleteSync(mFences[mRegion]));
+  }
+  mFences[mRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  // This only blocks if the GPU is a whole ring behind.
+  mRegion = (mRegion + 1) % STREAM_BUFFER_REGION_COUNT;
+  if (mFences[mRegion]) {
+    GLenum status;
+    do {
+      status = glClientWaitSync(mFences[mRegion], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    } while (status == GL_TIMEOUT_EXPIRED);
+    GLDEBUG(glDeleteSync(mFences[mRegion]));
+    mFences[mRegion] = 0;
+  }
+  mOffset = mRegion * STREAM_BUFFER_REGION_SIZE;
+}
+
+} // namespace pathfinder
@@ -0,0 +1,59 @@
+// pathfinder/src/stream-buffer.h
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#ifndef PATHFINDER_STREAM_BUFFER_H
+#define PATHFINDER_STREAM_BUFFER_H
+
+#include "platform.h"
+
+namespace pathfinder {
+
+// The ring is split into this many regions. A region is only written again
+// once the GPU has finished with the commands that read it the last time.
+const int STREAM_BUFFER_REGION_COUNT = 3;
+const GLsizeiptr STREAM_BUFFER_REGION_SIZE = 1024 * 1024;
+
+// A ring buffer that data changing from frame to frame is written through,
+// so that updating a buffer the GPU may still be reading never waits for it.
+// With buffer storage the ring stays mapped, and fences keep the CPU from
+// overwriting a region before the GPU is done with it. Without it, writes go
+// through unsynchronized maps, and the whole ring is orphaned when it wraps.
+class StreamBuffer
+{
+public:
+  StreamBuffer();
+  ~StreamBuffer();
+  StreamBuffer(const StreamBuffer&) = delete;
+  StreamBuffer& operator=(const StreamBuffer&) = delete;
+  bool init(bool aPersistent);
+
+  // Writes aData to aBuffer at aOffset through the ring, with a copy on the
+  // GPU. Data larger than a region is uploaded directly.
+  void upload(GLuint aBuffer, GLintptr aOffset, const void* aData, GLsizeiptr aSize);
+  // Writes aData into the ring and binds it to uniform block binding aIndex.
+  void bindUniformBlock(GLuint aIndex, const void* aData, GLsizeiptr aSize);
+
+private:
+  GLuint mBuffer;
+  __uint8_t* mMapping; // null unless the ring is persistently mapped
+  GLsync mFences[STREAM_BUFFER_REGION_COUNT];
+  int mRegion;
+  GLintptr mOffset;
+  GLint mUniformAlignment;
+
+  // Copies aData into the ring, aligned to aAlignment, and returns where it
+  // went. aSize must fit in a region.
+  GLintptr write(const void* aData, GLsizeiptr aSize, GLsizeiptr aAlignment);
+  void nextRegion();
+};
+
+} // namespace pathfinder
+
+#endif // PATHFINDER_STREAM_BUFFER_H
@@ -12,11 +12,20 @@
 #include "text.h"
 #include "platform.h"
 #include "aa-strategy.h"
+#include "compute-strategy.h"
+#include "cpu-strategy.h"
 #include "ssaa-strategy.h"
 #include "xcaa-strategy.h"
+#include "stream-buffer.h"
+#include "command-list.h"
+#include "gpu-timer.h"
+#include "trace.h"
 
 #include <algorithm>
 #include <math.h>
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
 
 using namespace std;
 
@@ -24,19 +33,49 @@ namespace pathfinder {
 
 const float SQRT_1_2 = 1.0f / sqrtf(2.0f);
 
+// While the font size keeps changing, glyphs are rasterized at the nearest of
+// a few sizes per octave so that a zoom reuses them instead of rasterizing
+// every frame. The exact size is rasterized once it has been stable for
+// FONT_SIZE_SETTLE_FRAMES calls to prepare().
+const float FONT_SIZE_BUCKETS_PER_OCTAVE = 4.0f;
+const int FONT_SIZE_SETTLE_FRAMES = 10;
+
+// The inputs that each stage of prepare() depends on.
+const unsigned int ATLAS_CONFIG_DIRTY_MASK =
+  tdf_font | tdf_rotation | tdf_embolden | tdf_hinting | tdf_aaOptions;
+const unsigned int GLYPH_STORE_DIRTY_MASK = tdf_text | tdf_font;
+const unsigned int TEXT_LAYOUT_DIRTY_MASK =
+  GLYPH_STORE_DIRTY_MASK | ATLAS_CONFIG_DIRTY_MASK | tdf_size;
+const unsigned int ATLAS_GLYPHS_DIRTY_MASK = TEXT_LAYOUT_DIRTY_MASK | tdf_atlas;
+
+// How long each prepare() may spend copying glyphs while compacting the atlas.
+const std::chrono::microseconds ATLAS_COMPACTION_BUDGET(1000);
+
+float
+quantizeFontSize(float aFontSize)
+{
+  float bucket = roundf(log2f(aFontSize) * FONT_SIZE_BUCKETS_PER_OCTAVE);
+  return exp2f(bucket / FONT_SIZE_BUCKETS_PER_OCTAVE);
+}
+
 TextRenderer::TextRenderer(std::shared_ptr<RenderContext> aRenderContext, bool aSubpixelPositioning)
   : Renderer(aRenderContext)
   , mSubpixelPositioning(aSubpixelPositioning)
   , mAtlasFramebuffer(0)
   , mAtlasDepthTexture(0)
-  , mGlyphPositionsBuffer(0)
-  , mGlyphTexCoordsBuffer(0)
-  , mGlyphElementsBuffer(0)
+  , mNextTextID(0)
   , mFontSize(72.0f)
+  , mRasterizedFontSize(72.0f)
+  , mFramesSinceFontSizeChange(FONT_SIZE_SETTLE_FRAMES)
   , mExtraEmboldenAmount(0.0f)
   , mUseHinting(false)
   , mRotationAngle(0.0f)
-  , mDirtyConfig(true)
+  , mHints(Vector4::Zero())
+  , mDirtyFlags(tdf_all)
+  , mAAType(asn_none)
+  , mAALevel(0)
+  , mAtlasConfigHash(0)
+  , mDirtyPathRange(0, 0)
 {
   mAtlas = make_shared<Atlas>();
 }
@@ -44,24 +83,35 @@ TextRenderer::TextRenderer(std::shared_ptr<RenderContext> aRenderContext, bool a
 TextRenderer::~TextRenderer()
 {
   if (mAtlasFramebuffer) {
-    GLDEBUG(glDeleteFramebuffers(1, &mAtlasFramebuffer));
+    GLDEBUG(GLState::deleteFramebuffers(1, &mAtlasFramebuffer));
     mAtlasFramebuffer = 0;
   }
   if (mAtlasDepthTexture) {
-    GLDEBUG(glDeleteTextures(1, &mAtlasDepthTexture));
+    GLDEBUG(GLState::deleteTextures(1, &mAtlasDepthTexture));
     mAtlasDepthTexture = 0;
   }
-  if (mGlyphPositionsBuffer) {
-    GLDEBUG(glDeleteBuffers(1, &mGlyphPositionsBuffer));
-    mGlyphPositionsBuffer = 0;
-  }
-  if (mGlyphTexCoordsBuffer) {
-    GLDEBUG(glDeleteBuffers(1, &mGlyphTexCoordsBuffer));
-    mGlyphTexCoordsBuffer = 0;
+}
+
+TextRenderer::TextBlock::TextBlock()
+  : glyphInstancesBuffer(0)
+  , glyphInstancesCapacity(0)
+  , blitVAO(0)
+  , blitProgram(0)
+  , dirty(true)
+{
+  GLDEBUG(glCreateBuffers(1, &glyphInstancesBuffer));
+  GLDEBUG(glCreateVertexArrays(1, &blitVAO));
+}
+
+TextRenderer::TextBlock::~TextBlock()
+{
+  if (glyphInstancesBuffer) {
+    GLDEBUG(glDeleteBuffers(1, &glyphInstancesBuffer));
+    glyphInstancesBuffer = 0;
   }
-  if (mGlyphElementsBuffer) {
-    GLDEBUG(glDeleteBuffers(1, &mGlyphElementsBuffer));
-    mGlyphElementsBuffer = 0;
+  if (blitVAO) {
+    GLDEBUG(GLState::deleteVertexArrays(1, &blitVAO));
+    blitVAO = 0;
   }
 }
 
@@ -76,24 +126,49 @@ TextRenderer::init(AntialiasingStrategyName aaType,
   if (!initAtlasFramebuffer()) {
     return false;
   }
-  GLDEBUG(glCreateBuffers(1, &mGlyphPositionsBuffer));
-  GLDEBUG(glCreateBuffers(1, &mGlyphTexCoordsBuffer));
-  GLDEBUG(glCreateBuffers(1, &mGlyphElementsBuffer));
 
   return true;
 }
 
+int
+TextRenderer::addText()
+{
+  int textID = mNextTextID++;
+  mTexts[textID] = make_unique<TextBlock>();
+  mDirtyFlags |= tdf_text;
+  return textID;
+}
+
 void
-TextRenderer::setText(const std::string& aText)
+TextRenderer::removeText(int aTextID)
+{
+  if (mTexts.erase(aTextID)) {
+    mDirtyFlags |= tdf_text;
+  }
+}
+
+int
+TextRenderer::getTextCount() const
 {
-  mText = aText;
-  mDirtyConfig = true;
+  return mTexts.size();
+}
+
+void
+TextRenderer::setText(int aTextID, const std::string& aText)
+{
+  TextBlock& text = *mTexts.at(aTextID);
+  if (aText == text.text) {
+    return;
+  }
+  text.text = aText;
+  text.dirty = true;
+  mDirtyFlags |= tdf_text;
 }
 
 std::string
-TextRenderer::getText() const
+TextRenderer::getText(int aTextID) const
 {
-  return mText;
+  return mTexts.at(aTextID)->text;
 }
 
 bool
@@ -105,7 +180,7 @@ TextRenderer::getIsMulticolor() const
 bool
 TextRenderer::getNeedsStencil() const
 {
-  return mFontSize <= MAX_STEM_DARKENING_PIXELS_PER_EM;
+  return mRasterizedFontSize <= MAX_STEM_DARKENING_PIXELS_PER_EM;
 }
 
 GLuint
@@ -113,6 +188,11 @@ TextRenderer::getAtlasFramebuffer() const {
   return mAtlasFramebuffer;
 }
 
+GLuint
+TextRenderer::getAtlasTexture() const {
+  return mAtlas->getTexture();
+}
+
 kraken::Vector2i
 TextRenderer::getAtlasAllocatedSize() const {
   return ATLAS_SIZE;
@@ -123,6 +203,21 @@ TextRenderer::getAtlasUsedSize() const {
   return mAtlas->getUsedSize();
 }
 
+kraken::Vector4
+TextRenderer::getAtlasDirtyRect() const
+{
+  return mAtlas->getDirtyRect();
+}
+
+Range
+TextRenderer::pathRangeForObject(int objectIndex)
+{
+  // Only the paths whose atlas slots overlap the dirty rect need to be drawn.
+  Range pathRange = Renderer::pathRangeForObject(objectIndex);
+  return Range(max(pathRange.start, mDirtyPathRange.start),
+               max(min(pathRange.end, mDirtyPathRange.end), pathRange.start));
+}
+
 kraken::Vector2
 TextRenderer::getTotalEmboldenAmount() const {
   return getExtraEmboldenAmount() + getStemDarkeningAmount();
@@ -146,14 +241,23 @@ TextRenderer::getRotationAngle() const {
 void
 TextRenderer::setRotationAngle(float aRotationAngle)
 {
+  if (aRotationAngle == mRotationAngle) {
+    return;
+  }
   mRotationAngle = aRotationAngle;
-  mDirtyConfig = true;
+  mDirtyFlags |= tdf_rotation;
 }
 
 float
 TextRenderer::getPixelsPerUnit() const
 {
-  return mFontSize / mFont->getFreeTypeFont()->units_per_EM;
+  return mRasterizedFontSize / mFont->getFreeTypeFont()->units_per_EM;
+}
+
+float
+TextRenderer::getAscent() const
+{
+  return mFont->getFreeTypeFont()->ascender * getPixelsPerUnit();
 }
 
 kraken::Matrix4
@@ -169,7 +273,7 @@ kraken::Vector2
 TextRenderer::getStemDarkeningAmount() const
 {
   if (mStemDarkening == sdm_dark) {
-    return computeStemDarkeningAmount(mFontSize, getPixelsPerUnit());
+    return computeStemDarkeningAmount(mRasterizedFontSize, getPixelsPerUnit());
   }
   return Vector2::Zero();
 }
@@ -193,18 +297,10 @@ TextRenderer::getObjectCount() const
   return getMeshBuffers().size();
 }
 
-void
-TextRenderer::setHintsUniform(PathfinderShaderProgram& aProgram)
+kraken::Vector4
+TextRenderer::getHints() const
 {
-  if (!aProgram.hasUniform(uniform_uHints)) {
-    return;
-  }
-  shared_ptr<Hint> hint = createHint();
-  GLDEBUG(glUniform4f(aProgram.getUniform(uniform_uHints),
-                      hint->getXHeight(),
-                      hint->getHintedXHeight(),
-                      hint->getStemHeight(),
-                      hint->getHintedStemHeight()));
+  return mHints;
 }
 
 shared_ptr<vector<float>>
@@ -228,10 +324,21 @@ TextRenderer::pathBoundingRects(int objectIndex)
   return boundingRects;
 }
 
+ColorAlphaFormat
+TextRenderer::getAtlasColorAlphaFormat() const
+{
+  // Without subpixel AA every channel of a grayscale glyph holds the same
+  // coverage, so only one channel needs to be stored.
+  if (mSubpixelAA == saat_none && !getIsMulticolor()) {
+    return caf_R8;
+  }
+  return caf_RGBA8;
+}
+
 bool
 TextRenderer::initAtlasFramebuffer()
 {
-  if (!mAtlas->init(*mRenderContext)) {
+  if (!mAtlas->init(*mRenderContext, getAtlasColorAlphaFormat())) {
     return false;
   }
   GLuint atlasColorTexture = mAtlas->getTexture();
@@ -246,6 +353,9 @@ TextRenderer::createAAStrategy(AntialiasingStrategyName aaType,
                                SubpixelAAType subpixelAA,
                                StemDarkeningMode stemDarkening)
 {
+  mAAType = aaType;
+  mAALevel = aaLevel;
+  mDirtyFlags |= tdf_aaOptions;
   mSubpixelAA = subpixelAA;
   mStemDarkening = stemDarkening;
   switch (aaType) {
@@ -254,8 +364,18 @@ TextRenderer::createAAStrategy(AntialiasingStrategyName aaType,
   case asn_ssaa:
     return make_shared<SSAAStrategy>(aaLevel, subpixelAA);
   case asn_xcaa:
-    return make_shared<AdaptiveStencilMeshAAAStrategy>(aaLevel, subpixelAA);
+    return make_shared<AdaptiveStencilMeshAAAStrategy>(aaLevel, subpixelAA, false);
     break;
+  case asn_tiled:
+    return make_shared<AdaptiveStencilMeshAAAStrategy>(aaLevel, subpixelAA, true);
+  case asn_compute:
+    if (mRenderContext->getSupportsCompute()) {
+      return make_shared<ComputeAAStrategy>(aaLevel, subpixelAA);
+    }
+    // Rasterize as asn_xcaa does without compute shaders.
+    return make_shared<AdaptiveStencilMeshAAAStrategy>(aaLevel, subpixelAA, false);
+  case asn_cpu:
+    return make_shared<CPUAAStrategy>(aaLevel, subpixelAA);
   }
   assert(false);
   return nullptr;
@@ -283,15 +403,37 @@ void TextRenderer::buildAtlasGlyphs(unique_ptr<std::vector<AtlasGlyph>> aAtlasGl
   }
 
   mAtlasGlyphs = move(aAtlasGlyphs);
-  mAtlas->layoutGlyphs(*mAtlasGlyphs,
-                           *mFont,
-                           getPixelsPerUnit(),
-                           mRotationAngle,
-                           *createHint(),
-                           getTotalEmboldenAmount());
+  {
+    PATHFINDER_TRACE_SCOPE("atlas layout");
+    mAtlas->layoutGlyphs(*mAtlasGlyphs,
+                         *mFont,
+                         getPixelsPerUnit(),
+                         mRotationAngle,
+                         *createHint(),
+                         getTotalEmboldenAmount());
+  }
+
+  // Find the span of path IDs that have to be redrawn to refill the dirty rect.
+  int firstDirtyPathID = INT_MAX;
+  int lastDirtyPathID = 0;
+  for (const AtlasGlyph& glyph: *mAtlasGlyphs) {
+    if (mAtlas->isGlyphDirty(glyph.getGlyphKey())) {
+      firstDirtyPathID = min(firstDirtyPathID, glyph.getPathID());
+      lastDirtyPathID = max(lastDirtyPathID, glyph.getPathID());
+    }
+  }
+  if (lastDirtyPathID == 0) {
+    mDirtyPathRange = Range(0, 0);
+  } else {
+    mDirtyPathRange = Range(firstDirtyPathID, lastDirtyPathID + 1);
+  }
 
-  uploadPathTransforms(1);
-  uploadPathColors(1);
+  // Only the transforms of glyphs that moved in the atlas have to be sent.
+  if (mPathTransforms) {
+    uploadPathTransforms(0, *mPathTransforms, updatePathTransforms());
+  } else {
+    uploadPathTransforms(1);
+  }
 }
 
 
@@ -316,7 +458,16 @@ TextRenderer::pathColorsForObject(int objectIndex)
 std::shared_ptr<PathTransformBuffers<std::vector<float>>>
 TextRenderer::pathTransformsForObject(int objectIndex)
 {
-  int pathCount = getPathCount();
+  mPathTransforms = createPathTransformBuffers(getPathCount());
+  mTransformedPathIDs.clear();
+  updatePathTransforms();
+  return mPathTransforms;
+}
+
+Range
+TextRenderer::updatePathTransforms()
+{
+  PATHFINDER_TRACE_SCOPE("path transforms");
   float pixelsPerUnit = getPixelsPerUnit();
 
   // FIXME(pcwalton): This is a hack that tries to preserve the vertical extents of the glyph
@@ -335,10 +486,16 @@ TextRenderer::pathTransformsForObject(int objectIndex)
   stemDarkeningOffset *= SQRT_1_2;
   stemDarkeningOffset.y *= stemDarkeningYScale;
 
-  Matrix2x3 transform = Matrix2x3::Identity();
-  std::shared_ptr<PathTransformBuffers<std::vector<float>>> transforms
-    = createPathTransformBuffers(pathCount);
+  std::vector<float>& st = *mPathTransforms->st;
+  std::vector<float>& ext = *mPathTransforms->ext;
+  int firstChangedPathID = INT_MAX;
+  int lastChangedPathID = 0;
 
+  // Paths that are no longer laid out get a zero transform again, so that
+  // drawing them can't touch the atlas.
+  std::vector<bool> laidOut(mTransformedPathIDs.size(), false);
+
+  Matrix2x3 transform = Matrix2x3::Identity();
   for (const AtlasGlyph& glyph: *mAtlasGlyphs) {
     int pathID = glyph.getPathID();
     Vector2 atlasOrigin = glyph.calculateSubpixelOrigin(pixelsPerUnit);
@@ -350,16 +507,45 @@ TextRenderer::pathTransformsForObject(int objectIndex)
     transform.translate(stemDarkeningOffset);
     transform.translate(atlasOrigin);
 
-    (*transforms->st)[pathID * 4 + 0] = transform[0];
-    (*transforms->st)[pathID * 4 + 1] = transform[3];
-    (*transforms->st)[pathID * 4 + 2] = transform[4];
-    (*transforms->st)[pathID * 4 + 3] = transform[5];
+    float newST[4] = { transform[0], transform[3], transform[4], transform[5] };
+    float newExt[2] = { transform[1], transform[2] };
+    if (memcmp(&st[pathID * 4], newST, sizeof(newST)) != 0 ||
+        memcmp(&ext[pathID * 2], newExt, sizeof(newExt)) != 0) {
+      memcpy(&st[pathID * 4], newST, sizeof(newST));
+      memcpy(&ext[pathID * 2], newExt, sizeof(newExt));
+      firstChangedPathID = min(firstChangedPathID, pathID);
+      lastChangedPathID = max(lastChangedPathID, pathID);
+    }
 
-    (*transforms->ext)[pathID * 2 + 0] = transform[1];
-    (*transforms->ext)[pathID * 2 + 1] = transform[2];
+    std::vector<int>::iterator previous = lower_bound(mTransformedPathIDs.begin(),
+                                                      mTransformedPathIDs.end(),
+                                                      pathID);
+    if (previous != mTransformedPathIDs.end() && *previous == pathID) {
+      laidOut[previous - mTransformedPathIDs.begin()] = true;
+    }
   }
 
-  return transforms;
+  for (size_t i = 0; i < mTransformedPathIDs.size(); i++) {
+    if (laidOut[i]) {
+      continue;
+    }
+    int pathID = mTransformedPathIDs[i];
+    fill(st.begin() + pathID * 4, st.begin() + pathID * 4 + 4, 0.0f);
+    fill(ext.begin() + pathID * 2, ext.begin() + pathID * 2 + 2, 0.0f);
+    firstChangedPathID = min(firstChangedPathID, pathID);
+    lastChangedPathID = max(lastChangedPathID, pathID);
+  }
+
+  mTransformedPathIDs.clear();
+  for (const AtlasGlyph& glyph: *mAtlasGlyphs) {
+    mTransformedPathIDs.push_back(glyph.getPathID());
+  }
+  std::sort(mTransformedPathIDs.begin(), mTransformedPathIDs.end());
+
+  if (lastChangedPathID == 0) {
+    return Range(0, 0);
+  }
+  return Range(firstChangedPathID, lastChangedPathID + 1);
 }
 
 std::shared_ptr<Hint>
@@ -385,8 +571,14 @@ TextRenderer::getDirectInteriorProgramName(DirectRenderingMode renderingMode)
 void
 TextRenderer::setFont(std::shared_ptr<PathfinderFont> aFont)
 {
+  if (aFont == mFont) {
+    return;
+  }
   mFont = aFont;
-  mDirtyConfig = true;
+  for (pair<const int, unique_ptr<TextBlock>>& text: mTexts) {
+    text.second->dirty = true;
+  }
+  mDirtyFlags |= tdf_font;
 }
 
 std::shared_ptr<PathfinderFont>
@@ -404,8 +596,26 @@ TextRenderer::getFontSize() const
 void
 TextRenderer::setFontSize(float aFontSize)
 {
+  if (aFontSize == mFontSize) {
+    return;
+  }
   mFontSize = aFontSize;
-  mDirtyConfig = true;
+  // Before the first layout there is nothing to animate from.
+  mFramesSinceFontSizeChange = mGlyphStore ? 0 : FONT_SIZE_SETTLE_FRAMES;
+}
+
+void
+TextRenderer::updateRasterizedFontSize()
+{
+  float rasterizedFontSize = mFontSize;
+  if (mFramesSinceFontSizeChange < FONT_SIZE_SETTLE_FRAMES) {
+    mFramesSinceFontSizeChange++;
+    rasterizedFontSize = quantizeFontSize(mFontSize);
+  }
+  if (rasterizedFontSize != mRasterizedFontSize) {
+    mRasterizedFontSize = rasterizedFontSize;
+    mDirtyFlags |= tdf_size;
+  }
 }
 
 bool
@@ -417,54 +627,196 @@ TextRenderer::getUseHinting() const
 void
 TextRenderer::setUseHinting(bool aUseHinting)
 {
+  if (aUseHinting == mUseHinting) {
+    return;
+  }
   mUseHinting = aUseHinting;
-  mDirtyConfig = true;
+  mDirtyFlags |= tdf_hinting;
+}
+
+bool
+TextRenderer::saveAtlas(const std::string& aPath)
+{
+  // Only an atlas that is fully rendered with the current options is worth
+  // keeping.
+  if (!mFont || mAtlas->hasDirtyRect() || getAtlasConfigHash() != mAtlasConfigHash) {
+    return false;
+  }
+  return mAtlas->save(aPath, mAtlasFramebuffer, mAtlasConfigHash);
+}
+
+bool
+TextRenderer::restoreAtlas(const std::string& aPath)
+{
+  if (!mFont) {
+    return false;
+  }
+  __uint64_t configHash = getAtlasConfigHash();
+  if (!mAtlas->restore(aPath, configHash)) {
+    return false;
+  }
+  mAtlasConfigHash = configHash;
+  mDirtyFlags |= tdf_atlas;
+  return true;
+}
+
+__uint64_t
+TextRenderer::getAtlasConfigHash() const
+{
+  // Everything that changes the pixels rendered into the atlas. Gamma
+  // correction is applied when blitting, so it isn't included.
+  // The font size isn't included either, as slots are cached per size.
+  __uint64_t hash = mFont->getDataHash();
+  hash = fnv1a(&mExtraEmboldenAmount, sizeof(mExtraEmboldenAmount), hash);
+  hash = fnv1a(&mRotationAngle, sizeof(mRotationAngle), hash);
+  hash = fnv1a(&mUseHinting, sizeof(mUseHinting), hash);
+  hash = fnv1a(&mSubpixelPositioning, sizeof(mSubpixelPositioning), hash);
+  hash = fnv1a(&mAAType, sizeof(mAAType), hash);
+  hash = fnv1a(&mAALevel, sizeof(mAALevel), hash);
+  hash = fnv1a(&mSubpixelAA, sizeof(mSubpixelAA), hash);
+  hash = fnv1a(&mStemDarkening, sizeof(mStemDarkening), hash);
+  ColorAlphaFormat colorAlphaFormat = getAtlasColorAlphaFormat();
+  hash = fnv1a(&colorAlphaFormat, sizeof(colorAlphaFormat), hash);
+  return hash;
 }
 
 void
 TextRenderer::prepare()
 {
+  PATHFINDER_TRACE_SCOPE("TextRenderer::prepare");
+  updateRasterizedFontSize();
+  continueAtlasCompaction();
+  initBlitVAOs();
+
+  // A renderer whose inputs haven't changed has nothing to prepare; draw()
+  // just blits the atlas.
+  if (!mDirtyFlags || !mFont) {
+    return;
+  }
   layout();
+  if (mGlyphStore && (mDirtyFlags & ATLAS_GLYPHS_DIRTY_MASK)) {
+    buildGlyphs();
+  }
+  mDirtyFlags = 0;
+
+  if (mAtlas->hasDirtyRect()) {
+    // Partitioning the glyph outlines is the most expensive part of a layout,
+    // so it waits until a glyph actually has to be rasterized. An atlas
+    // restored from a snapshot may never need it.
+    if (!getMeshesAttached()) {
+      attachGlyphMeshes();
+    }
+    renderAtlas();
+    mAtlas->clearDirtyRect();
+  }
 
-  if (!getMeshesAttached()) {
-    return;
+  // Which slots are live only changes when the glyphs are built.
+  if (!mAtlas->isCompacting() && mAtlas->getNeedsCompaction()) {
+    mAtlas->beginCompaction();
   }
-  buildGlyphs();
-  renderAtlas();
 }
 
 void
-TextRenderer::layout()
+TextRenderer::continueAtlasCompaction()
 {
-  if (!mDirtyConfig) {
+  // Runs before the glyphs are built so that they pick up the new slots on the
+  // frame the compacted texture is swapped in.
+  if (!mAtlas->isCompacting()) {
     return;
   }
-  if (!mFont || mText.empty()) {
+  if (!mAtlas->continueCompaction(ATLAS_COMPACTION_BUDGET)) {
     return;
   }
+  GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, mAtlasFramebuffer));
+  GLDEBUG(glFramebufferTexture2D(GL_FRAMEBUFFER,
+                                 GL_COLOR_ATTACHMENT0,
+                                 GL_TEXTURE_2D,
+                                 mAtlas->getTexture(),
+                                 0));
+  mDirtyFlags |= tdf_atlas;
+}
 
-  mDirtyConfig = false;
+void
+TextRenderer::layout()
+{
+  PATHFINDER_TRACE_SCOPE("layout");
+  // Glyph slots survive text and size changes, but not other changes to how
+  // glyphs are rasterized.
+  if (mDirtyFlags & ATLAS_CONFIG_DIRTY_MASK) {
+    __uint64_t atlasConfigHash = getAtlasConfigHash();
+    if (atlasConfigHash != mAtlasConfigHash) {
+      mAtlas->reset();
+      mAtlasConfigHash = atlasConfigHash;
+    }
+  }
 
-  recreateLayout();
-  layoutText();
+  // The glyph store, meshes and run advances are in font units. Rotation goes
+  // into the path transforms and embolden into the uEmboldenAmount uniform,
+  // so a new size, rotation or embolden amount only has to recompute glyph
+  // rects and transforms before the atlas is redrawn.
+  if (mDirtyFlags & GLYPH_STORE_DIRTY_MASK) {
+    recreateLayout();
+  }
+  // Texts that didn't change only have to be laid out again when one of the
+  // shared inputs did.
+  bool layoutAllTexts = mDirtyFlags & TEXT_LAYOUT_DIRTY_MASK & ~tdf_text;
+  for (pair<const int, unique_ptr<TextBlock>>& text: mTexts) {
+    if (layoutAllTexts || text.second->dirty) {
+      layoutText(*text.second);
+      text.second->dirty = false;
+    }
+  }
 }
 
 void
 TextRenderer::recreateLayout()
 {
-  mLayout = make_unique<SimpleTextLayout>(mFont, mText);
-
   std::vector<int> uniqueGlyphIDs;
-  uniqueGlyphIDs = mLayout->getTextFrame().allGlyphIDs();
+  for (pair<const int, unique_ptr<TextBlock>>& text: mTexts) {
+    if (text.second->dirty) {
+      text.second->layout = make_unique<SimpleTextLayout>(mFont, text.second->text);
+      // Advances are in font units, so runs only need laying out once per text.
+      text.second->layout->layoutRuns();
+    }
+    vector<int> glyphIDs = text.second->layout->getTextFrame().allGlyphIDs();
+    uniqueGlyphIDs.insert(uniqueGlyphIDs.end(), glyphIDs.begin(), glyphIDs.end());
+  }
 
   std::sort(uniqueGlyphIDs.begin(), uniqueGlyphIDs.end());
   uniqueGlyphIDs.erase(unique(uniqueGlyphIDs.begin(), uniqueGlyphIDs.end()), uniqueGlyphIDs.end());
 
-  mGlyphStore = make_unique<GlyphStore>(mFont, uniqueGlyphIDs);
+  // Path IDs index into the glyph store, so as long as the texts use the same
+  // set of glyphs the meshes stay valid.
+  if (mGlyphStore && !(mDirtyFlags & tdf_font) &&
+      mGlyphStore->getGlyphIDs() == uniqueGlyphIDs) {
+    return;
+  }
+  if (uniqueGlyphIDs.empty()) {
+    mGlyphStore.reset();
+  } else {
+    mGlyphStore = make_unique<GlyphStore>(mFont, uniqueGlyphIDs);
+  }
+
+  // The path IDs of the old meshes refer to the previous glyph store.
+  detachMeshes();
+  mPathTransforms.reset();
+  mTransformedPathIDs.clear();
+
+  if (mGlyphStore) {
+    uploadPathColors(1);
+  }
+}
+
+void
+TextRenderer::attachGlyphMeshes()
+{
   std::shared_ptr<PathfinderMeshPack> meshPack;
-  meshPack = mGlyphStore->partition();
+  {
+    PATHFINDER_TRACE_SCOPE("partition");
+    meshPack = mGlyphStore->partition();
+  }
 
-  int glyphCount = uniqueGlyphIDs.size();
+  int glyphCount = mGlyphStore->getGlyphIDs().size();
   std::vector<int> pathIDs;
   for (int glyphIndex = 0; glyphIndex < glyphCount; glyphIndex++) {
     for (int subpixel = 0; subpixel < SUBPIXEL_GRANULARITY; subpixel++) {
@@ -472,26 +824,29 @@ TextRenderer::recreateLayout()
     }
   }
   vector<shared_ptr<PathfinderPackedMeshes>> meshes;
-  meshes.push_back(make_shared<PathfinderPackedMeshes>(*meshPack, pathIDs));
+  {
+    PATHFINDER_TRACE_SCOPE("pack");
+    meshes.push_back(make_shared<PathfinderPackedMeshes>(*meshPack, pathIDs));
+  }
   attachMeshes(meshes);
 }
 
 void
-TextRenderer::layoutText()
+TextRenderer::layoutText(TextBlock& aText)
 {
-  mLayout->layoutRuns();
+  Vector4 textBounds = aText.layout->getTextFrame().bounds();
 
-  Vector4 textBounds = mLayout->getTextFrame().bounds();
-
-  int totalGlyphCount = mLayout->getTextFrame().totalGlyphCount();
-  vector<float> glyphPositions(totalGlyphCount * 8);
-  vector<__uint32_t> glyphIndices(totalGlyphCount * 6);
+  int totalGlyphCount = aText.layout->getTextFrame().totalGlyphCount();
+  aText.glyphInstances.resize(totalGlyphCount);
+  if (totalGlyphCount == 0) {
+    return;
+  }
 
   std::shared_ptr<Hint> hint = createHint();
   float pixelsPerUnit = getPixelsPerUnit();
 
   int globalGlyphIndex = 0;
-  for (const unique_ptr<TextRun>& run: mLayout->getTextFrame().getRuns()) {
+  for (const unique_ptr<TextRun>& run: aText.layout->getTextFrame().getRuns()) {
     run->recalculatePixelRects(pixelsPerUnit,
                               mRotationAngle,
                               *hint,
@@ -502,47 +857,33 @@ TextRenderer::layoutText()
     for (int glyphIndex = 0;
        glyphIndex < run->getGlyphIDs().size();
        glyphIndex++, globalGlyphIndex++) {
+      // Pixel rects are already rounded out to whole pixels.
       const Vector4 rect = run->pixelRectForGlyphAt(glyphIndex);
-      glyphPositions[globalGlyphIndex * 8 + 0] = rect[0];
-      glyphPositions[globalGlyphIndex * 8 + 1] = rect[3];
-      glyphPositions[globalGlyphIndex * 8 + 2] = rect[2];
-      glyphPositions[globalGlyphIndex * 8 + 3] = rect[3];
-      glyphPositions[globalGlyphIndex * 8 + 4] = rect[0];
-      glyphPositions[globalGlyphIndex * 8 + 5] = rect[1];
-      glyphPositions[globalGlyphIndex * 8 + 6] = rect[2];
-      glyphPositions[globalGlyphIndex * 8 + 7] = rect[1];
-
-      for (int glyphIndexIndex = 0;
-        glyphIndexIndex < QUAD_ELEMENTS_LENGTH;
-        glyphIndexIndex++) {
-        glyphIndices[glyphIndexIndex + globalGlyphIndex * 6] =
-            QUAD_ELEMENTS[glyphIndexIndex] + 4 * globalGlyphIndex;
+      for (int i = 0; i < 4; i++) {
+        aText.glyphInstances[globalGlyphIndex].rect[i] = rect[i];
       }
     }
   }
 
-  GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, mGlyphPositionsBuffer));
-  GLDEBUG(glBufferData(GL_ARRAY_BUFFER, glyphPositions.size() * sizeof(glyphPositions[0]), &glyphPositions[0], GL_STATIC_DRAW));
-
-  GLDEBUG(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mGlyphElementsBuffer));
-  GLDEBUG(glBufferData(GL_ELEMENT_ARRAY_BUFFER, glyphIndices.size() * sizeof(glyphIndices[0]), &glyphIndices[0], GL_STATIC_DRAW));
-}
-
-/// The separating axis theorem.
-bool rectsIntersect(Vector4 a, Vector4 b)
-{
-    return a[2] > b[0] && a[3] > b[1] && a[0] < b[2] && a[1] < b[3];
+  // The atlas rects are filled in, and the instances uploaded, once the
+  // glyphs are built.
 }
 
 void
 TextRenderer::buildGlyphs()
 {
   float pixelsPerUnit = getPixelsPerUnit();
-  Vector4 textBounds = mLayout->getTextFrame().bounds();
   std::shared_ptr<Hint> hint = createHint();
+  mHints = Vector4::Create(hint->getXHeight(),
+                           hint->getHintedXHeight(),
+                           hint->getStemHeight(),
+                           hint->getHintedStemHeight());
 
+  // The glyphs of every text go into the same atlas pass.
   unique_ptr<vector<AtlasGlyph>> atlasGlyphs = make_unique<vector<AtlasGlyph>>();
-  for (const unique_ptr<TextRun>& run: mLayout->getTextFrame().getRuns()) {
+  for (pair<const int, unique_ptr<TextBlock>>& text: mTexts) {
+    Vector4 textBounds = text.second->layout->getTextFrame().bounds();
+    for (const unique_ptr<TextRun>& run: text.second->layout->getTextFrame().getRuns()) {
       for (int glyphIndex = 0; glyphIndex < run->getGlyphIDs().size(); glyphIndex++) {
 
           int glyphID = run->getGlyphIDs()[glyphIndex];
@@ -560,30 +901,36 @@ TextRenderer::buildGlyphs()
                                               SUBPIXEL_GRANULARITY,
                                               textBounds);
           }
-          GlyphKey glyphKey(glyphID, subpixel);
+          GlyphKey glyphKey(glyphID, subpixel, mRasterizedFontSize);
           atlasGlyphs->push_back(AtlasGlyph(glyphStoreIndex, glyphKey));
       }
+    }
   }
 
   buildAtlasGlyphs(move(atlasGlyphs));
 
   // TODO(pcwalton): Regenerate the IBOs to include only the glyphs we care about.
-  setGlyphTexCoords();
+  for (pair<const int, unique_ptr<TextBlock>>& text: mTexts) {
+    setGlyphTexCoords(*text.second);
+  }
 }
 
 void
-TextRenderer::setGlyphTexCoords()
+TextRenderer::setGlyphTexCoords(TextBlock& aText)
 {
   float pixelsPerUnit = getPixelsPerUnit();
 
-  Vector4 textBounds = mLayout->getTextFrame().bounds();
+  Vector4 textBounds = aText.layout->getTextFrame().bounds();
 
   shared_ptr<Hint> hint = createHint();
 
-  mGlyphBounds.resize(mLayout->getTextFrame().totalGlyphCount() * 8);
+  vector<GlyphInstance>& glyphInstances = aText.glyphInstances;
+  if (glyphInstances.empty()) {
+    return;
+  }
 
   int globalGlyphIndex = 0;
-  for (const unique_ptr<TextRun>& run: mLayout->getTextFrame().getRuns()) {
+  for (const unique_ptr<TextRun>& run: aText.layout->getTextFrame().getRuns()) {
     for (int glyphIndex = 0;
        glyphIndex < run->getGlyphIDs().size();
        glyphIndex++, globalGlyphIndex++) {
@@ -598,7 +945,7 @@ TextRenderer::setGlyphTexCoords()
                                           SUBPIXEL_GRANULARITY,
                                           textBounds);
       }
-      GlyphKey glyphKey(textGlyphID, subpixel);
+      GlyphKey glyphKey(textGlyphID, subpixel, mRasterizedFontSize);
       int sortKey = glyphKey.getSortKey();
 
       // Find index of glyphKey in mAtlasGlyphs, assuming mAtlasGlyphs is sorted by sortkey
@@ -627,69 +974,166 @@ TextRenderer::setGlyphTexCoords()
                                      atlasGlyphPixelOrigin,
                                      pixelsPerUnit,
                                      *hint);
-      Vector2 atlasGlyphBL = Vector2::Create(atlasGlyphRect[0], atlasGlyphRect[1]);
-      Vector2 atlasGlyphTR = Vector2::Create(atlasGlyphRect[2], atlasGlyphRect[3]);
-      atlasGlyphBL.x /= (float)ATLAS_SIZE.x;
-      atlasGlyphBL.y /= (float)ATLAS_SIZE.y;
-      atlasGlyphTR.x /= (float)ATLAS_SIZE.x;
-      atlasGlyphTR.y /= (float)ATLAS_SIZE.y;
-
-      mGlyphBounds[globalGlyphIndex * 8 + 0] = atlasGlyphBL[0];
-      mGlyphBounds[globalGlyphIndex * 8 + 1] = atlasGlyphTR[1];
-      mGlyphBounds[globalGlyphIndex * 8 + 2] = atlasGlyphTR[0];
-      mGlyphBounds[globalGlyphIndex * 8 + 3] = atlasGlyphTR[1];
-      mGlyphBounds[globalGlyphIndex * 8 + 4] = atlasGlyphBL[0];
-      mGlyphBounds[globalGlyphIndex * 8 + 5] = atlasGlyphBL[1];
-      mGlyphBounds[globalGlyphIndex * 8 + 6] = atlasGlyphTR[0];
-      mGlyphBounds[globalGlyphIndex * 8 + 7] = atlasGlyphBL[1];
+      for (int i = 0; i < 4; i++) {
+        glyphInstances[globalGlyphIndex].texRect[i] = (__uint16_t)atlasGlyphRect[i];
+      }
     }
   }
 
-  GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, mGlyphTexCoordsBuffer));
-  GLDEBUG(glBufferData(GL_ARRAY_BUFFER, mGlyphBounds.size() * sizeof(mGlyphBounds[0]), &mGlyphBounds[0], GL_STATIC_DRAW));
+  // The buffer is only reallocated when it has to grow; otherwise the
+  // instances are streamed in without waiting for the last composite.
+  if (glyphInstances.size() > aText.glyphInstancesCapacity) {
+    aText.glyphInstancesCapacity = glyphInstances.size();
+    GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, aText.glyphInstancesBuffer));
+    GLDEBUG(glBufferData(GL_ARRAY_BUFFER,
+                         aText.glyphInstancesCapacity * sizeof(GlyphInstance),
+                         NULL,
+                         GL_DYNAMIC_DRAW));
+  }
+  mRenderContext->getStreamBuffer().upload(aText.glyphInstancesBuffer,
+                                           0,
+                                           &glyphInstances[0],
+                                           glyphInstances.size() * sizeof(GlyphInstance));
 }
 
 
 void
 TextRenderer::draw(Matrix4 aTransform)
 {
-  GLDEBUG(glDisable(GL_DEPTH_TEST));
-  GLDEBUG(glDisable(GL_SCISSOR_TEST));
-  // GLDEBUG(glBlendEquation(GL_FUNC_REVERSE_SUBTRACT));
-  GLDEBUG(glBlendEquation(GL_FUNC_ADD));
-  GLDEBUG(glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE));
-  GLDEBUG(glEnable(GL_BLEND));
+  for (pair<const int, unique_ptr<TextBlock>>& text: mTexts) {
+    draw(text.first, aTransform);
+  }
+}
+
+void
+TextRenderer::draw(int aTextID, Matrix4 aTransform)
+{
+  TextBlock& text = *mTexts.at(aTextID);
+  shared_ptr<PathfinderShaderProgram> blitProgram = getBlitProgram();
+  if (text.blitProgram != blitProgram->getProgram()) {
+    initBlitVAO(text, *blitProgram);
+  }
+  mDrawCommands.reset();
+  recordDraw(aTextID, aTransform, mDrawCommands);
+  PATHFINDER_TRACE_SCOPE("blit");
+  GPUTimerScope timerScope(mRenderContext->getGPUTimer(), gp_blit);
+  mDrawCommands.replay();
+}
+
+void
+TextRenderer::recordDraw(int aTextID, Matrix4 aTransform, CommandList& aCommands)
+{
+  const TextBlock& text = *mTexts.at(aTextID);
+  if (!text.layout || !mGlyphStore) {
+    return;
+  }
+  int totalGlyphCount = text.layout->getTextFrame().totalGlyphCount();
+  if (totalGlyphCount == 0) {
+    return;
+  }
+
+  // The composite VAO is set up by prepare(), since that takes GL calls.
+  shared_ptr<PathfinderShaderProgram> blitProgram = getBlitProgram();
+  if (text.blitProgram != blitProgram->getProgram()) {
+    return;
+  }
+
+  aCommands.disable(GL_DEPTH_TEST);
+  aCommands.disable(GL_SCISSOR_TEST);
+  aCommands.blendEquation(GL_FUNC_ADD);
+  aCommands.blendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE);
+  aCommands.enable(GL_BLEND);
 
-  // Set the appropriate program.
-  shared_ptr<PathfinderShaderProgram> blitProgram;
+  aCommands.useProgram(blitProgram->getProgram());
+  aCommands.bindVertexArray(text.blitVAO);
+
+  // Glyphs rasterized at a different size than requested are stretched to
+  // fit, filtering the atlas so that they don't look blocky.
+  float rasterizedScale = mFontSize / mRasterizedFontSize;
+  Matrix4 transform = Matrix4::Identity();
+  transform.scale(rasterizedScale, rasterizedScale, 1.0f);
+  transform *= aTransform;
+
+  // Blit.
+  aCommands.uniformMatrix4fv(blitProgram->getUniform(uniform_uTransform), transform);
+  aCommands.bindTexture(0, GL_TEXTURE_2D, mAtlas->getTexture());
+  aCommands.setTextureFilter(rasterizedScale == 1.0f ? GL_NEAREST : GL_LINEAR);
+  aCommands.uniform1i(blitProgram->getUniform(uniform_uSource), 0);
+  aCommands.uniform2f(blitProgram->getUniform(uniform_uTexScale),
+                      1.0f / (float)ATLAS_SIZE.x,
+                      1.0f / (float)ATLAS_SIZE.y);
+  if (blitProgram->hasUniform(uniform_uGammaLUT)) {
+    aCommands.bindTexture(1, GL_TEXTURE_2D, mRenderContext->getGammaLUTTexture());
+    aCommands.uniform1i(blitProgram->getUniform(uniform_uGammaLUT), 1);
+  }
+  if (blitProgram->hasUniform(uniform_uBGColor)) {
+    aCommands.uniform3f(blitProgram->getUniform(uniform_uBGColor), 1.0f, 1.0f, 1.0f);
+  }
+  // Each glyph is an instance of the unit quad, drawn as a strip.
+  aCommands.drawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, totalGlyphCount);
+  aCommands.bindVertexArray(0);
+}
+
+shared_ptr<PathfinderShaderProgram>
+TextRenderer::getBlitProgram()
+{
+  // Single-channel atlases splat their coverage across RGB.
+  bool monoAtlas = mAtlas->getColorAlphaFormat() == caf_R8;
   switch (mGammaCorrectionMode) {
   case gcm_off:
-    blitProgram = mRenderContext->getShaderManager().getProgram(program_blitLinear);
-    break;
+    return mRenderContext->getShaderManager().getProgram(
+      monoAtlas ? program_blitGlyphLinearMono : program_blitGlyphLinear);
   case gcm_on:
-    blitProgram = mRenderContext->getShaderManager().getProgram(program_blitGamma);
-    break;
+    return mRenderContext->getShaderManager().getProgram(
+      monoAtlas ? program_blitGlyphGammaMono : program_blitGlyphGamma);
   }
+  assert(false);
+  return nullptr;
+}
 
-  // Set up the composite VAO.
-  GLDEBUG(glUseProgram(blitProgram->getProgram()));
-  GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, mGlyphPositionsBuffer));
-  GLDEBUG(glVertexAttribPointer(blitProgram->getAttribute(attribute_aPosition), 2, GL_FLOAT, GL_FALSE, 0, 0));
-  GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, mGlyphTexCoordsBuffer));
-  GLDEBUG(glVertexAttribPointer(blitProgram->getAttribute(attribute_aTexCoord), 2, GL_FLOAT, GL_FALSE, 0, 0));
-  GLDEBUG(glEnableVertexAttribArray(blitProgram->getAttribute(attribute_aPosition)));
-  GLDEBUG(glEnableVertexAttribArray(blitProgram->getAttribute(attribute_aTexCoord)));
-  GLDEBUG(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mGlyphElementsBuffer));
+void
+TextRenderer::initBlitVAOs()
+{
+  // The composite VAOs only need setting up again if the atlas format or
+  // gamma correction picked another program.
+  shared_ptr<PathfinderShaderProgram> blitProgram = getBlitProgram();
+  for (pair<const int, unique_ptr<TextBlock>>& text: mTexts) {
+    if (text.second->blitProgram != blitProgram->getProgram()) {
+      initBlitVAO(*text.second, *blitProgram);
+    }
+  }
+}
 
-  // Blit.
-  GLDEBUG(glUniformMatrix4fv(blitProgram->getUniform(uniform_uTransform), 1, GL_FALSE, aTransform.c));
-  GLDEBUG(glActiveTexture(GL_TEXTURE0));
-  GLDEBUG(glBindTexture(GL_TEXTURE_2D, mAtlas->getTexture()));
-  GLDEBUG(glUniform1i(blitProgram->getUniform(uniform_uSource), 0));
-  GLDEBUG(glUniform2f(blitProgram->getUniform(uniform_uTexScale), 1.0, 1.0));
-  bindGammaLUT(Vector3::Create(1.0f, 1.0f, 1.0f), 1, *blitProgram);
-  int totalGlyphCount = mLayout->getTextFrame().totalGlyphCount();
-  GLDEBUG(glDrawElements(GL_TRIANGLES, totalGlyphCount * 6, GL_UNSIGNED_INT, 0));
+void
+TextRenderer::initBlitVAO(TextBlock& aText, PathfinderShaderProgram& aProgram)
+{
+  GLuint quadPositionAttribute = aProgram.getAttribute(attribute_aQuadPosition);
+  GLuint glyphRectAttribute = aProgram.getAttribute(attribute_aGlyphRect);
+  GLuint glyphTexRectAttribute = aProgram.getAttribute(attribute_aGlyphTexRect);
+
+  GLDEBUG(GLState::bindVertexArray(aText.blitVAO));
+  GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, mRenderContext->quadPositionsBuffer()));
+  GLDEBUG(glVertexAttribPointer(quadPositionAttribute, 2, GL_FLOAT, GL_FALSE, 0, 0));
+  GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, aText.glyphInstancesBuffer));
+  GLDEBUG(glVertexAttribPointer(glyphRectAttribute,
+                                4,
+                                GL_FLOAT,
+                                GL_FALSE,
+                                sizeof(GlyphInstance),
+                                (const void*)offsetof(GlyphInstance, rect)));
+  GLDEBUG(glVertexAttribPointer(glyphTexRectAttribute,
+                                4,
+                                GL_UNSIGNED_SHORT,
+                                GL_FALSE,
+                                sizeof(GlyphInstance),
+                                (const void*)offsetof(GlyphInstance, texRect)));
+  GLDEBUG(glVertexAttribDivisor(glyphRectAttribute, 1));
+  GLDEBUG(glVertexAttribDivisor(glyphTexRectAttribute, 1));
+  GLDEBUG(glEnableVertexAttribArray(quadPositionAttribute));
+  GLDEBUG(glEnableVertexAttribArray(glyphRectAttribute));
+  GLDEBUG(glEnableVertexAttribArray(glyphTexRectAttribute));
+  GLDEBUG(GLState::bindVertexArray(0));
+  aText.blitProgram = aProgram.getProgram();
 }
 
 kraken::Vector2
@@ -703,8 +1147,11 @@ TextRenderer::getExtraEmboldenAmount() const
 void
 TextRenderer::setEmboldenAmount(float aEmboldenAmount)
 {
+  if (aEmboldenAmount == mExtraEmboldenAmount) {
+    return;
+  }
   mExtraEmboldenAmount = aEmboldenAmount;
-  mDirtyConfig = true;
+  mDirtyFlags |= tdf_embolden;
 }
 float
 TextRenderer::getEmboldenAmount() const
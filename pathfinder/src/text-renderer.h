@@ -16,8 +16,10 @@
 #include "text.h"
 #include "renderer.h"
 #include "context.h"
+#include "command-list.h"
 
 #include <vector>
+#include <map>
 #include <hydra.h>
 
 using namespace std;
@@ -25,6 +27,20 @@ using namespace kraken;
 
 namespace pathfinder {
 
+// Inputs of TextRenderer::prepare(). Each stage of the pipeline only runs
+// when one of the inputs it depends on is dirty.
+typedef enum {
+  tdf_text      = 1 << 0,
+  tdf_font      = 1 << 1,
+  tdf_size      = 1 << 2,
+  tdf_rotation  = 1 << 3,
+  tdf_embolden  = 1 << 4,
+  tdf_hinting   = 1 << 5,
+  tdf_aaOptions = 1 << 6,
+  tdf_atlas     = 1 << 7, // slots were moved by compaction or a snapshot
+  tdf_all       = 0xff
+} TextDirtyFlag;
+
 class Font;
 class GlyphStore;
 class PathfinderShaderProgram;
@@ -40,15 +56,30 @@ public:
   bool init(AntialiasingStrategyName aaType,
               int aaLevel,
               AAOptions aaOptions);
-  void setText(const std::string& aText);
-  std::string getText() const;
+  // A renderer lays out any number of texts that share its font and
+  // options. Their glyphs share one atlas, rendered in a single pass.
+  int addText();
+  void removeText(int aTextID);
+  int getTextCount() const;
+  void setText(int aTextID, const std::string& aText);
+  std::string getText(int aTextID) const;
+  void draw(int aTextID, kraken::Matrix4 aTransform);
+  // Records what draw() would do without making GL calls, so that it can be
+  // done on another thread. The texts must not change until the commands
+  // are replayed, and prepare() must have run since they last did.
+  void recordDraw(int aTextID, kraken::Matrix4 aTransform, CommandList& aCommands);
+  // Draws every text with the same transform.
   void draw(kraken::Matrix4 aTransform) override;
 
   bool getIsMulticolor() const override;
   bool getNeedsStencil() const override;
   GLuint getAtlasFramebuffer() const override;
+  GLuint getAtlasTexture() const override;
+  ColorAlphaFormat getAtlasColorAlphaFormat() const override;
   kraken::Vector2i getAtlasAllocatedSize() const override;
   kraken::Vector2i getAtlasUsedSize() const override;
+  kraken::Vector4 getAtlasDirtyRect() const override;
+  Range pathRangeForObject(int objectIndex) override;
   kraken::Vector2 getTotalEmboldenAmount() const override;
   void setEmboldenAmount(float aEmboldenAmount);
   float getEmboldenAmount() const;
@@ -57,10 +88,12 @@ public:
   float getRotationAngle() const;
   void setRotationAngle(float aRotationAngle);
   float getPixelsPerUnit() const;
+  // How far the font rises above the baseline, in pixels.
+  float getAscent() const;
   kraken::Matrix4 getWorldTransform() const override;
   kraken::Vector2 getStemDarkeningAmount() const;
   kraken::Vector2 getUsedSizeFactor() const override;
-  void setHintsUniform(PathfinderShaderProgram& aProgram) override;
+  kraken::Vector4 getHints() const override;
   std::shared_ptr<std::vector<float>> pathBoundingRects(int objectIndex) override;
 
   std::shared_ptr<PathfinderFont> getFont() const;
@@ -70,13 +103,53 @@ public:
   bool getUseHinting() const;
   void setUseHinting(bool aUseHinting);
 
+  // Atlas snapshots let an application skip rasterizing glyphs that an
+  // earlier run already rendered. Save after prepare(); restore after the
+  // font, size and other options are set, before the first prepare(). A
+  // snapshot rendered with different options is rejected.
+  bool saveAtlas(const std::string& aPath);
+  bool restoreAtlas(const std::string& aPath);
+
   void prepare();
 private:
+  // The instance record the composite draws for each glyph of a text. Both
+  // rects are (left, bottom, right, top) in whole pixels. Long or scaled
+  // texts reach past the range of 16 bits, so text rects are floats; atlas
+  // rects always fit.
+  struct GlyphInstance {
+    float rect[4];          // in the text
+    __uint16_t texRect[4];  // in the atlas
+  };
+  struct TextBlock {
+    TextBlock();
+    ~TextBlock();
+    std::string text;
+    std::shared_ptr<SimpleTextLayout> layout;
+    GLuint glyphInstancesBuffer;
+    size_t glyphInstancesCapacity; // in instances
+    // Binds the unit quad and glyphInstancesBuffer to the attributes of
+    // blitProgram.
+    GLuint blitVAO;
+    GLuint blitProgram;
+    std::vector<GlyphInstance> glyphInstances;
+    bool dirty; // the text changed since it was last laid out
+  };
+
   void layout();
   void buildGlyphs();
-  void layoutText();
+  void layoutText(TextBlock& aText);
   void recreateLayout();
-  void setGlyphTexCoords();
+  void updateRasterizedFontSize();
+  void continueAtlasCompaction();
+  void attachGlyphMeshes();
+  // Writes the transforms of the laid out glyphs into mPathTransforms and
+  // returns the range of path IDs whose entries changed.
+  Range updatePathTransforms();
+  void setGlyphTexCoords(TextBlock& aText);
+  void initBlitVAO(TextBlock& aText, PathfinderShaderProgram& aProgram);
+  void initBlitVAOs();
+  std::shared_ptr<PathfinderShaderProgram> getBlitProgram();
+  __uint64_t getAtlasConfigHash() const;
 
   kraken::Vector2 getExtraEmboldenAmount() const;
   bool initAtlasFramebuffer();
@@ -95,24 +168,36 @@ private:
   bool mSubpixelPositioning;
   GLuint mAtlasFramebuffer;
   GLuint mAtlasDepthTexture;
-  GLuint mGlyphPositionsBuffer;
-  GLuint mGlyphTexCoordsBuffer;
-  GLuint mGlyphElementsBuffer;
   StemDarkeningMode mStemDarkening;
   SubpixelAAType mSubpixelAA;
   unique_ptr<std::vector<AtlasGlyph>> mAtlasGlyphs;
   std::shared_ptr<PathfinderFont> mFont;
   std::shared_ptr<GlyphStore> mGlyphStore;
-  std::shared_ptr<SimpleTextLayout> mLayout;
   std::shared_ptr<Atlas> mAtlas;
   std::shared_ptr<PathfinderPackedMeshes> mMeshes;
-  std::vector<float> mGlyphBounds;
-  std::string mText;
+  std::map<int, std::unique_ptr<TextBlock>> mTexts;
+  int mNextTextID;
   float mFontSize;
+  // The size glyphs are laid out and rasterized at. While the font size is
+  // animating this lags behind mFontSize, and draw() scales the difference.
+  float mRasterizedFontSize;
+  int mFramesSinceFontSizeChange;
   float mExtraEmboldenAmount;
   bool mUseHinting;
   float mRotationAngle;
-  bool mDirtyConfig;
+  // The hint metrics of the glyphs in the atlas, updated by buildGlyphs().
+  kraken::Vector4 mHints;
+  unsigned int mDirtyFlags; // TextDirtyFlag bits
+  AntialiasingStrategyName mAAType;
+  int mAALevel;
+  __uint64_t mAtlasConfigHash;
+  Range mDirtyPathRange;
+  // The path transforms last uploaded, and the sorted IDs of the paths that
+  // have a transform in them.
+  std::shared_ptr<PathTransformBuffers<std::vector<float>>> mPathTransforms;
+  std::vector<int> mTransformedPathIDs;
+  // Reused by draw() so that its storage is only grown once.
+  CommandList mDrawCommands;
 
   int getPathCount();
   int getObjectCount() const override;
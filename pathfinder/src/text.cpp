@@ -1,5 +1,6 @@
 #include "text.h"
 #include "resources.h"
+#include "trace.h"
 
 #include <hydra.h>
 #include <freetype/ftglyph.h>
@@ -18,6 +19,7 @@ namespace pathfinder {
 
 PathfinderFont::PathfinderFont()
  : mFace(nullptr)
+ , mDataHash(0)
 {
 
 }
@@ -29,9 +31,16 @@ PathfinderFont::load(FT_Library aLibrary, const __uint8_t* aData, size_t aDataLe
   if (err) {
     return false;
   }
+  mDataHash = fnv1a(aData, aDataLength);
   return true;
 }
 
+__uint64_t
+PathfinderFont::getDataHash() const
+{
+  return mDataHash;
+}
+
 FT_Face
 PathfinderFont::getFreeTypeFont()
 {
@@ -108,6 +117,7 @@ TextRun::TextRun(const string& aText, Vector2 aOrigin, shared_ptr<PathfinderFont
   size_t length = str16.length();
   mGlyphIDs.resize(length, 0);
 
+  PATHFINDER_TRACE_SCOPE("cmap lookup");
   FT_Face face = aFont->getFreeTypeFont();
   for(int i=0; i < length; i++) {
     mGlyphIDs[i] = FT_Get_Char_Index(face, str16[i]);
@@ -523,4 +533,11 @@ computeStemDarkeningAmount(float pixelsPerEm, float pixelsPerUnit)
   return Vector2::Min(STEM_DARKENING_FACTORS * pixelsPerEm, MAX_STEM_DARKENING_AMOUNT) / pixelsPerUnit;
 }
 
+/// The separating axis theorem.
+bool
+rectsIntersect(kraken::Vector4 a, kraken::Vector4 b)
+{
+  return a[2] > b[0] && a[3] > b[1] && a[0] < b[2] && a[1] < b[3];
+}
+
 } // namespace pathfinder
@@ -68,8 +68,11 @@ public:
 
   FT_BBox& metricsForGlyph(int glyphID);
   FT_Face getFreeTypeFont();
+  // Hash of the font file contents, used to recognize cached atlases.
+  __uint64_t getDataHash() const;
 private:
   FT_Face mFace;
+  __uint64_t mDataHash;
   std::map<int, FT_BBox> mMetricsCache;
 }; // class PathfinderFont
 
@@ -196,6 +199,7 @@ kraken::Vector4 calculatePixelRectForGlyph(const UnitMetrics& metrics,
                                            float pixelsPerUnit,
                                            const Hint& hint);
 kraken::Vector2 computeStemDarkeningAmount(float pixelsPerEm, float pixelsPerUnit);
+bool rectsIntersect(kraken::Vector4 a, kraken::Vector4 b);
 
 float getFontLineHeight(PathfinderFont& aFont);
 
@@ -0,0 +1,116 @@
+// pathfinder/src/thread-pool.cpp
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#include "thread-pool.h"
+
+using namespace std;
+
+namespace pathfinder {
+
+ThreadPool::ThreadPool(int aThreadCount)
+  : mTask(nullptr)
+  , mTaskCount(0)
+  , mNextTask(0)
+  , mPendingTasks(0)
+  , mActiveWorkers(0)
+  , mJob(0)
+  , mStopping(false)
+{
+  for (int i = 1; i < aThreadCount; i++) {
+    mWorkers.push_back(thread(&ThreadPool::workerMain, this));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    lock_guard<mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mJobReady.notify_all();
+  for (thread& worker : mWorkers) {
+    worker.join();
+  }
+}
+
+void
+ThreadPool::run(int aTaskCount, const function<void(int)>& aTask)
+{
+  if (aTaskCount <= 0) {
+    return;
+  }
+  if (mWorkers.empty() || aTaskCount == 1) {
+    for (int i = 0; i < aTaskCount; i++) {
+      aTask(i);
+    }
+    return;
+  }
+
+  // A worker that woke up late for the last job may still be looking for
+  // tasks in it.
+  unique_lock<mutex> lock(mMutex);
+  mJobDone.wait(lock, [this] { return mActiveWorkers == 0; });
+  mTask = &aTask;
+  mTaskCount = aTaskCount;
+  mNextTask = 0;
+  mPendingTasks = aTaskCount;
+  mJob++;
+  lock.unlock();
+  mJobReady.notify_all();
+
+  int completed = runTasks();
+
+  lock.lock();
+  mPendingTasks -= completed;
+  mJobDone.wait(lock, [this] { return mPendingTasks == 0 && mActiveWorkers == 0; });
+  mTask = nullptr;
+}
+
+void
+ThreadPool::workerMain()
+{
+  __uint64_t job = 0;
+  unique_lock<mutex> lock(mMutex);
+  while (true) {
+    mJobReady.wait(lock, [this, job] { return mStopping || mJob != job; });
+    if (mStopping) {
+      return;
+    }
+    job = mJob;
+    mActiveWorkers++;
+    lock.unlock();
+
+    int completed = runTasks();
+
+    lock.lock();
+    mActiveWorkers--;
+    mPendingTasks -= completed;
+    if (mPendingTasks == 0 && mActiveWorkers == 0) {
+      mJobDone.notify_all();
+    }
+  }
+}
+
+int
+ThreadPool::runTasks()
+{
+  int completed = 0;
+  while (true) {
+    int task = mNextTask.fetch_add(1);
+    if (task >= mTaskCount) {
+      break;
+    }
+    (*mTask)(task);
+    completed++;
+  }
+  return completed;
+}
+
+} // namespace pathfinder
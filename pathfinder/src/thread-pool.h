@@ -0,0 +1,67 @@
+// pathfinder/src/thread-pool.h
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#ifndef PATHFINDER_THREAD_POOL_H
+#define PATHFINDER_THREAD_POOL_H
+
+#include "platform.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pathfinder {
+
+// A fixed set of worker threads for the CPU-side rasterization work. One job
+// runs at a time, and the thread that starts it works on it too.
+class ThreadPool
+{
+public:
+  // aThreadCount counts the calling thread, so one spawns no workers.
+  explicit ThreadPool(int aThreadCount);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  int getThreadCount() const {
+    return (int)mWorkers.size() + 1;
+  }
+
+  // Calls aTask with every index in [0, aTaskCount), spread across the
+  // threads, and returns once all of the calls have.
+  void run(int aTaskCount, const std::function<void(int)>& aTask);
+
+private:
+  void workerMain();
+  // Takes tasks of the current job until there are none left, and returns
+  // how many this thread ran.
+  int runTasks();
+
+  std::vector<std::thread> mWorkers;
+  std::mutex mMutex;
+  std::condition_variable mJobReady;
+  std::condition_variable mJobDone;
+  // The current job. Only changed under mMutex while no worker is active.
+  const std::function<void(int)>* mTask;
+  int mTaskCount;
+  std::atomic<int> mNextTask;
+  // Guarded by mMutex.
+  int mPendingTasks;
+  int mActiveWorkers;
+  __uint64_t mJob;
+  bool mStopping;
+};
+
+} // namespace pathfinder
+
+#endif // PATHFINDER_THREAD_POOL_H
@@ -0,0 +1,434 @@
+// pathfinder/src/tiler.cpp
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#include "tiler.h"
+
+#include "renderer.h"
+#include "meshes.h"
+#include "thread-pool.h"
+
+#include <algorithm>
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace kraken;
+
+namespace pathfinder {
+
+namespace {
+
+// How far the lines a curve is flattened into may stray from it, in pixels.
+// The same as in fill-accumulate.cs.glsl.
+const float FLATTEN_TOLERANCE = 0.1f;
+const int MAX_CURVE_LINES = 32;
+// Fewer segments than this aren't worth handing to another thread.
+const int MIN_SEGMENTS_PER_TASK = 256;
+
+// hintPosition() from the shaders, for y.
+float
+hintY(float aY, const float* aHints)
+{
+  if (aY >= aHints[2]) {
+    return aY - aHints[2] + aHints[3];
+  }
+  if (aY >= aHints[0]) {
+    float t = (aY - aHints[0]) / (aHints[2] - aHints[0]);
+    return aHints[1] + (aHints[3] - aHints[1]) * t;
+  }
+  if (aY >= 0.0f) {
+    return aHints[1] * (aY / aHints[0]);
+  }
+  return aY;
+}
+
+// Transforms the three points of a segment, padded to eight floats, by
+// aMatrix, laid out as in Tiler::mPathMatrices.
+void
+transformSegment(const float* aMatrix, float* aPoints)
+{
+#ifdef __SSE2__
+  // Two points to a register: (x' y') = (x x) * (xx yx) + (y y) * (xy yy) + t.
+  __m128 columnX = _mm_setr_ps(aMatrix[0], aMatrix[1], aMatrix[0], aMatrix[1]);
+  __m128 columnY = _mm_setr_ps(aMatrix[2], aMatrix[3], aMatrix[2], aMatrix[3]);
+  __m128 translation = _mm_setr_ps(aMatrix[4], aMatrix[5], aMatrix[4], aMatrix[5]);
+  for (int i = 0; i < 8; i += 4) {
+    __m128 points = _mm_loadu_ps(aPoints + i);
+    __m128 xs = _mm_shuffle_ps(points, points, _MM_SHUFFLE(2, 2, 0, 0));
+    __m128 ys = _mm_shuffle_ps(points, points, _MM_SHUFFLE(3, 3, 1, 1));
+    __m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, columnX), _mm_mul_ps(ys, columnY)),
+                               translation);
+    _mm_storeu_ps(aPoints + i, result);
+  }
+#else
+  for (int i = 0; i < 6; i += 2) {
+    float x = aPoints[i], y = aPoints[i + 1];
+    aPoints[i] = aMatrix[0] * x + aMatrix[2] * y + aMatrix[4];
+    aPoints[i + 1] = aMatrix[1] * x + aMatrix[3] * y + aMatrix[5];
+  }
+#endif
+}
+
+} // anonymous namespace
+
+Tiler::Tiler()
+  : mTilesAcross(0)
+  , mTilesDown(0)
+  , mEdgeTileCount(0)
+  , mSolidTileCount(0)
+{
+  for (int i = 0; i < 4; i++) {
+    mHints[i] = 0.0f;
+  }
+  mEmboldenAmount[0] = mEmboldenAmount[1] = 0.0f;
+}
+
+void
+Tiler::tile(Renderer& renderer,
+            int aFirstSegment,
+            int aSegmentCount,
+            Vector2i aFramebufferSize,
+            const int aRect[4],
+            ThreadPool& aThreadPool)
+{
+  mFills.clear();
+  mEdgeTileCount = 0;
+  mSolidTileCount = 0;
+  mTilesAcross = (aRect[2] + TILER_TILE_SIZE - 1) / TILER_TILE_SIZE;
+  mTilesDown = (aRect[3] + TILER_TILE_SIZE - 1) / TILER_TILE_SIZE;
+  if (aSegmentCount <= 0 || mTilesAcross <= 0 || mTilesDown <= 0 ||
+      renderer.getMeshes().size() == 0 || renderer.getPathTransforms().size() == 0) {
+    return;
+  }
+
+  const PathUniforms& uniforms = renderer.getPathUniforms();
+  for (int i = 0; i < 4; i++) {
+    mHints[i] = uniforms.hints[i];
+  }
+  mEmboldenAmount[0] = uniforms.emboldenAmount[0] * 0.5f;
+  mEmboldenAmount[1] = uniforms.emboldenAmount[1] * 0.5f;
+  initPathMatrices(renderer, aFramebufferSize, aRect);
+
+  int threadCount = aThreadPool.getThreadCount();
+  int segmentsPerTask = max(MIN_SEGMENTS_PER_TASK, (aSegmentCount + threadCount - 1) / threadCount);
+  int taskCount = (aSegmentCount + segmentsPerTask - 1) / segmentsPerTask;
+  if ((int)mBins.size() < taskCount) {
+    mBins.resize(taskCount);
+  }
+  aThreadPool.run(taskCount, [&](int aTask) {
+    int firstSegment = aFirstSegment + aTask * segmentsPerTask;
+    int segmentCount = min(segmentsPerTask, aFirstSegment + aSegmentCount - firstSegment);
+    tileSegments(renderer, firstSegment, segmentCount, mBins[aTask]);
+  });
+
+  mergeBins(taskCount);
+}
+
+void
+Tiler::initPathMatrices(Renderer& renderer, Vector2i aFramebufferSize, const int aRect[4])
+{
+  // The same concatenation as stencil-aaa.vs.glsl, followed by the viewport
+  // transform and the move to the region's origin.
+  const PathUniforms& uniforms = renderer.getPathUniforms();
+  const PathTransformBuffers<vector<float>>& transforms = *renderer.getPathTransforms()[0];
+  const vector<float>& st = *transforms.st;
+  const vector<float>& ext = *transforms.ext;
+  int pathCount = (int)min(st.size() / 4, ext.size() / 2);
+
+  float globalX[2] = { uniforms.transformST[0], uniforms.transformExt[0] };
+  float globalY[2] = { uniforms.transformExt[1], uniforms.transformST[1] };
+  float scaleX = 0.5f * aFramebufferSize.x, scaleY = 0.5f * aFramebufferSize.y;
+
+  mPathMatrices.resize(pathCount * 6);
+  for (int pathID = 0; pathID < pathCount; pathID++) {
+    const float* pathST = &st[pathID * 4];
+    const float* pathExt = &ext[pathID * 2];
+    float localX[2] = { pathST[0], -pathExt[0] };
+    float localY[2] = { -pathExt[1], pathST[1] };
+
+    float* matrix = &mPathMatrices[pathID * 6];
+    matrix[0] = (globalX[0] * localX[0] + globalY[0] * localX[1]) * scaleX;
+    matrix[1] = (globalX[1] * localX[0] + globalY[1] * localX[1]) * scaleY;
+    matrix[2] = (globalX[0] * localY[0] + globalY[0] * localY[1]) * scaleX;
+    matrix[3] = (globalX[1] * localY[0] + globalY[1] * localY[1]) * scaleY;
+    float translationX = uniforms.transformST[2] + globalX[0] * pathST[2] + globalY[0] * pathST[3];
+    float translationY = uniforms.transformST[3] + globalX[1] * pathST[2] + globalY[1] * pathST[3];
+    matrix[4] = (translationX + 1.0f) * scaleX - aRect[0];
+    matrix[5] = (translationY + 1.0f) * scaleY - aRect[1];
+  }
+}
+
+void
+Tiler::tileSegments(Renderer& renderer, int aFirstSegment, int aSegmentCount, Bin& aBin)
+{
+  int tileCount = mTilesAcross * mTilesDown;
+  aBin.fills.clear();
+  aBin.steps.clear();
+  aBin.backdropDeltas.assign(tileCount, 0);
+  aBin.edgeTiles.assign(tileCount, 0);
+
+  PathfinderPackedMeshes& meshes = *renderer.getMeshes()[0];
+  const float* segments = (const float*)meshes.stencilSegments;
+  const float* normals = (const float*)meshes.stencilNormals;
+  const __uint16_t* pathIDs = (const __uint16_t*)meshes.stencilSegmentPathIDs;
+  int pathCount = (int)mPathMatrices.size() / 6;
+
+  for (int segment = aFirstSegment; segment < aFirstSegment + aSegmentCount; segment++) {
+    int pathID = pathIDs[segment];
+    if (pathID >= pathCount) {
+      continue;
+    }
+
+    // Hint and embolden, then transform to pixels of the region.
+    float points[8];
+    for (int i = 0; i < 6; i += 2) {
+      points[i] = segments[segment * 6 + i] - normals[segment * 6 + i] * mEmboldenAmount[0];
+      points[i + 1] = hintY(segments[segment * 6 + i + 1], mHints) -
+                      normals[segment * 6 + i + 1] * mEmboldenAmount[1];
+    }
+    points[6] = points[7] = 0.0f;
+    transformSegment(&mPathMatrices[pathID * 6], points);
+
+    // Flatten the curve. Lines have their control point halfway along, so
+    // they come out as one. The last point is taken as is, so that it meets
+    // the next segment exactly.
+    float deviationX = points[0] - 2.0f * points[2] + points[4];
+    float deviationY = points[1] - 2.0f * points[3] + points[5];
+    float deviation = sqrtf(deviationX * deviationX + deviationY * deviationY) * 0.25f;
+    float lineCountF = ceilf(sqrtf(deviation / FLATTEN_TOLERANCE));
+    int lineCount = lineCountF < 1.0f ? 1 : lineCountF > MAX_CURVE_LINES ? MAX_CURVE_LINES : (int)lineCountF;
+    float fromX = points[0], fromY = points[1];
+    for (int line = 1; line < lineCount; line++) {
+      float t = (float)line / (float)lineCount, s = 1.0f - t;
+      float toX = s * s * points[0] + 2.0f * s * t * points[2] + t * t * points[4];
+      float toY = s * s * points[1] + 2.0f * s * t * points[3] + t * t * points[5];
+      addLine(fromX, fromY, toX, toY, aBin);
+      fromX = toX;
+      fromY = toY;
+    }
+    addLine(fromX, fromY, points[4], points[5], aBin);
+  }
+}
+
+void
+Tiler::addLine(float aFromX, float aFromY, float aToX, float aToY, Bin& aBin)
+{
+  // Vertical lines cover no area, and their effect on the tiles to their
+  // right is left to the steps of the lines either side.
+  if (aFromX == aToX) {
+    return;
+  }
+  float right = (float)(mTilesAcross * TILER_TILE_SIZE), top = (float)(mTilesDown * TILER_TILE_SIZE);
+  if (max(aFromX, aToX) <= 0.0f || min(aFromX, aToX) >= right || min(aFromY, aToY) >= top) {
+    return;
+  }
+  if (aFromY == aToY) {
+    addRowSpan(aFromX, aFromY, aToX, aToY, aBin);
+    return;
+  }
+
+  // Split at each row boundary strictly between the ends, including the
+  // bottom of the region, below which everything is folded into the first
+  // row, and its top, above which everything is dropped.
+  float slope = (aToX - aFromX) / (aToY - aFromY);
+  float fromX = aFromX, fromY = aFromY;
+  if (aToY > aFromY) {
+    int first = max((int)floorf(aFromY / TILER_TILE_SIZE) + 1, 0);
+    int last = min((int)ceilf(aToY / TILER_TILE_SIZE) - 1, mTilesDown);
+    for (int boundary = first; boundary <= last; boundary++) {
+      float y = (float)(boundary * TILER_TILE_SIZE), x = aFromX + (y - aFromY) * slope;
+      addRowSpan(fromX, fromY, x, y, aBin);
+      fromX = x;
+      fromY = y;
+    }
+  } else {
+    int first = min((int)ceilf(aFromY / TILER_TILE_SIZE) - 1, mTilesDown);
+    int last = max((int)floorf(aToY / TILER_TILE_SIZE) + 1, 0);
+    for (int boundary = first; boundary >= last; boundary--) {
+      float y = (float)(boundary * TILER_TILE_SIZE), x = aFromX + (y - aFromY) * slope;
+      addRowSpan(fromX, fromY, x, y, aBin);
+      fromX = x;
+      fromY = y;
+    }
+  }
+  addRowSpan(fromX, fromY, aToX, aToY, aBin);
+}
+
+void
+Tiler::addRowSpan(float aFromX, float aFromY, float aToX, float aToY, Bin& aBin)
+{
+  if (aFromX == aToX) {
+    return;
+  }
+  int row = (int)floorf((aFromY + aToY) * 0.5f / TILER_TILE_SIZE);
+  if (row >= mTilesDown) {
+    return;
+  }
+  if (row < 0) {
+    // Below the region, only the horizontal extent matters.
+    row = 0;
+    aFromY = aToY = 0.0f;
+  }
+  float rowBottom = (float)(row * TILER_TILE_SIZE), rowTop = rowBottom + TILER_TILE_SIZE;
+
+  // Split at each column boundary strictly between the ends. Each boundary
+  // point is shared by the pieces either side, exactly.
+  float slope = (aToY - aFromY) / (aToX - aFromX);
+  float fromX = aFromX, fromY = aFromY;
+  if (aToX > aFromX) {
+    int first = max((int)floorf(aFromX / TILER_TILE_SIZE) + 1, 0);
+    int last = min((int)ceilf(aToX / TILER_TILE_SIZE) - 1, mTilesAcross);
+    for (int boundary = first; boundary <= last; boundary++) {
+      float x = (float)(boundary * TILER_TILE_SIZE);
+      float y = min(max(aFromY + (x - aFromX) * slope, rowBottom), rowTop);
+      addPiece(row, fromX, fromY, x, y, aBin);
+      fromX = x;
+      fromY = y;
+    }
+  } else {
+    int first = min((int)ceilf(aFromX / TILER_TILE_SIZE) - 1, mTilesAcross);
+    int last = max((int)floorf(aToX / TILER_TILE_SIZE) + 1, 0);
+    for (int boundary = first; boundary >= last; boundary--) {
+      float x = (float)(boundary * TILER_TILE_SIZE);
+      float y = min(max(aFromY + (x - aFromX) * slope, rowBottom), rowTop);
+      addPiece(row, fromX, fromY, x, y, aBin);
+      fromX = x;
+      fromY = y;
+    }
+  }
+  addPiece(row, fromX, fromY, aToX, aToY, aBin);
+}
+
+void
+Tiler::addPiece(int aRow, float aFromX, float aFromY, float aToX, float aToY, Bin& aBin)
+{
+  int column = (int)floorf((aFromX + aToX) * 0.5f / TILER_TILE_SIZE);
+  if (column < 0 || column >= mTilesAcross || aFromX == aToX) {
+    return;
+  }
+
+  // Same winding as stencil-aaa.fs.glsl: lines running right subtract.
+  bool rightward = aFromX < aToX;
+  float winding = rightward ? -1.0f : 1.0f;
+  TileFill fill;
+  fill.from[0] = rightward ? aFromX : aToX;
+  fill.from[1] = rightward ? aFromY : aToY;
+  fill.to[0] = rightward ? aToX : aFromX;
+  fill.to[1] = rightward ? aToY : aFromY;
+  fill.tileTop = (float)((aRow + 1) * TILER_TILE_SIZE);
+  fill.winding = winding;
+  aBin.fills.push_back(fill);
+
+  int tile = aRow * mTilesAcross + column;
+  aBin.edgeTiles[tile] = 1;
+  if (aRow + 1 >= mTilesDown) {
+    return;
+  }
+
+  // Above its tile, the piece adds its winding between its ends: from its
+  // left end to the right of the tile, less the same from its right end.
+  float tileLeft = (float)(column * TILER_TILE_SIZE), tileRight = tileLeft + TILER_TILE_SIZE;
+  if (fill.from[0] == tileLeft) {
+    aBin.backdropDeltas[tile + mTilesAcross] += rightward ? -1 : 1;
+  } else {
+    WindingStep step = { column, aRow + 1, fill.from[0], winding };
+    aBin.steps.push_back(step);
+  }
+  if (fill.to[0] != tileRight) {
+    WindingStep step = { column, aRow + 1, fill.to[0], -winding };
+    aBin.steps.push_back(step);
+  }
+}
+
+void
+Tiler::mergeBins(int aBinCount)
+{
+  int tileCount = mTilesAcross * mTilesDown;
+  mBackdrops.assign(tileCount, 0);
+  mEdgeTiles.assign(tileCount, 0);
+  mSteps.clear();
+  for (int binIndex = 0; binIndex < aBinCount; binIndex++) {
+    Bin& bin = mBins[binIndex];
+    mFills.insert(mFills.end(), bin.fills.begin(), bin.fills.end());
+    mSteps.insert(mSteps.end(), bin.steps.begin(), bin.steps.end());
+    for (int tile = 0; tile < tileCount; tile++) {
+      mBackdrops[tile] += bin.backdropDeltas[tile];
+      mEdgeTiles[tile] |= bin.edgeTiles[tile];
+    }
+  }
+
+  // The steps at a point cancel out above the higher of the two pieces that
+  // meet there, so what is left is a horizontal fill from the point to the
+  // right of each tile in between.
+  sort(mSteps.begin(), mSteps.end(), [](const WindingStep& a, const WindingStep& b) {
+    if (a.column != b.column) {
+      return a.column < b.column;
+    }
+    if (a.x != b.x) {
+      return a.x < b.x;
+    }
+    return a.row < b.row;
+  });
+  float winding = 0.0f;
+  for (size_t i = 0; i < mSteps.size(); i++) {
+    const WindingStep& step = mSteps[i];
+    winding += step.winding;
+    bool lastAtPoint = i + 1 == mSteps.size() ||
+                       mSteps[i + 1].column != step.column ||
+                       mSteps[i + 1].x != step.x;
+    int endRow = lastAtPoint ? mTilesDown : mSteps[i + 1].row;
+    if (winding != 0.0f) {
+      float tileRight = (float)((step.column + 1) * TILER_TILE_SIZE);
+      for (int row = step.row; row < endRow; row++) {
+        TileFill fill;
+        fill.from[0] = step.x;
+        fill.from[1] = fill.to[1] = (float)(row * TILER_TILE_SIZE);
+        fill.to[0] = tileRight;
+        fill.tileTop = fill.from[1] + TILER_TILE_SIZE;
+        fill.winding = winding;
+        mFills.push_back(fill);
+        mEdgeTiles[row * mTilesAcross + step.column] = 1;
+      }
+    }
+    if (lastAtPoint) {
+      winding = 0.0f;
+    }
+  }
+
+  // Sum the backdrops up each column. A tile with one and no outline is
+  // solid, and its backdrop fill is all it needs.
+  for (int column = 0; column < mTilesAcross; column++) {
+    int backdrop = 0;
+    for (int row = 0; row < mTilesDown; row++) {
+      int tile = row * mTilesAcross + column;
+      backdrop += mBackdrops[tile];
+      if (mEdgeTiles[tile]) {
+        mEdgeTileCount++;
+      } else if (backdrop != 0) {
+        mSolidTileCount++;
+      }
+      if (backdrop == 0) {
+        continue;
+      }
+      TileFill fill;
+      fill.from[0] = (float)(column * TILER_TILE_SIZE);
+      fill.from[1] = fill.to[1] = (float)(row * TILER_TILE_SIZE);
+      fill.to[0] = fill.from[0] + TILER_TILE_SIZE;
+      fill.tileTop = fill.from[1] + TILER_TILE_SIZE;
+      fill.winding = (float)backdrop;
+      mFills.push_back(fill);
+    }
+  }
+}
+
+} // namespace pathfinder
@@ -0,0 +1,124 @@
+// pathfinder/src/tiler.h
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#ifndef PATHFINDER_TILER_H
+#define PATHFINDER_TILER_H
+
+#include "platform.h"
+
+#include <vector>
+#include <hydra.h>
+
+namespace pathfinder {
+
+class Renderer;
+class ThreadPool;
+
+// Must match TILE_SIZE in the tile shaders.
+const int TILER_TILE_SIZE = 16;
+
+// One instance of the stencil tile program: the coverage above a line, up to
+// the top of the tile it lies in. Positions are in supersampled pixels
+// relative to the tiled region, left end first.
+struct TileFill {
+  float from[2];
+  float to[2];
+  float tileTop;
+  // -1 for a line that ran rightward, as in stencil-aaa.fs.glsl, or +1. For a
+  // tile's backdrop, the winding number of everything below the tile.
+  float winding;
+};
+
+// Bins the stencil segments of an object into 16x16 pixel tiles on the CPU.
+//
+// Segments are transformed, flattened and clipped to the tiles they cross,
+// on the renderer's thread pool. Each piece only adds coverage up to the top
+// of its own tile; what it would have added to the tiles above is carried in
+// one backdrop fill per tile instead. Tiles that lie wholly inside a path end
+// up with just their backdrop, a rectangle, so the fill rate spent on a path
+// is about its outline plus its area rather than, as with
+// StencilAAAStrategy, the height of every segment up to the top of the path.
+class Tiler
+{
+public:
+  Tiler();
+
+  // Bins aSegmentCount segments from aFirstSegment into the tiles of aRect,
+  // (x, y, width, height) in pixels of a framebuffer of aFramebufferSize,
+  // which the renderer's transforms map clip space to. Replaces the last
+  // fills.
+  void tile(Renderer& renderer,
+            int aFirstSegment,
+            int aSegmentCount,
+            kraken::Vector2i aFramebufferSize,
+            const int aRect[4],
+            ThreadPool& aThreadPool);
+
+  const std::vector<TileFill>& getFills() const {
+    return mFills;
+  }
+  // Tiles that an outline passes through.
+  int getEdgeTileCount() const {
+    return mEdgeTileCount;
+  }
+  // Tiles wholly inside a path, which only get a backdrop.
+  int getSolidTileCount() const {
+    return mSolidTileCount;
+  }
+
+private:
+  // A piece of outline ending partway across a tile adds its winding to the
+  // tiles above it in the same column, from `x` rightward. The piece that
+  // continues the outline from the same point takes it away again, so only
+  // the rows in between are left with a step.
+  struct WindingStep {
+    int column;
+    // The first row of tiles affected.
+    int row;
+    float x;
+    float winding;
+  };
+
+  // What one task finds in its share of the segments.
+  struct Bin {
+    std::vector<TileFill> fills;
+    std::vector<WindingStep> steps;
+    // Winding added to the tiles from this row up by pieces that start at
+    // the left of the tile below.
+    std::vector<int> backdropDeltas;
+    std::vector<__uint8_t> edgeTiles;
+  };
+
+  void initPathMatrices(Renderer& renderer, kraken::Vector2i aFramebufferSize, const int aRect[4]);
+  void tileSegments(Renderer& renderer, int aFirstSegment, int aSegmentCount, Bin& aBin);
+  void addLine(float aFromX, float aFromY, float aToX, float aToY, Bin& aBin);
+  void addRowSpan(float aFromX, float aFromY, float aToX, float aToY, Bin& aBin);
+  void addPiece(int aRow, float aFromX, float aFromY, float aToX, float aToY, Bin& aBin);
+  void mergeBins(int aBinCount);
+
+  int mTilesAcross;
+  int mTilesDown;
+  float mHints[4];
+  float mEmboldenAmount[2];
+  // Maps a point in the units of each path to pixels of the region, as
+  // (xx, yx, xy, yy, tx, ty).
+  std::vector<float> mPathMatrices;
+  std::vector<Bin> mBins;
+  std::vector<WindingStep> mSteps;
+  std::vector<int> mBackdrops;
+  std::vector<__uint8_t> mEdgeTiles;
+  std::vector<TileFill> mFills;
+  int mEdgeTileCount;
+  int mSolidTileCount;
+}; // class Tiler
+
+} // namespace pathfinder
+
+#endif // PATHFINDER_TILER_H
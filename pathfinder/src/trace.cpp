@@ -0,0 +1,147 @@
+// pathfinder/src/trace.cpp
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#include "trace.h"
+
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+namespace pathfinder {
+
+std::atomic<bool> Trace::sEnabled(false);
+
+namespace {
+
+// Enough for a few seconds of frames. Once full, each new span replaces the
+// oldest, so that a trace left running keeps a bounded amount of memory.
+const size_t TRACE_MAX_SPANS = 1 << 16;
+
+struct Span
+{
+  const char* name;
+  __uint64_t start;
+  __uint64_t end;
+  int thread;
+};
+
+struct TraceState
+{
+  mutex spansMutex;
+  vector<Span> spans;
+  // Where the next span goes once spans is full; also the oldest span.
+  size_t nextSpan;
+  atomic<int> nextThread;
+};
+
+TraceState&
+state()
+{
+  static TraceState sState;
+  return sState;
+}
+
+// Small numbers read better in a trace viewer than std::thread::ids.
+int
+currentThread()
+{
+  static thread_local int sThread = state().nextThread++;
+  return sThread;
+}
+
+void
+appendEscaped(string& aJSON, const char* aString)
+{
+  for (const char* c = aString; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      aJSON += '\\';
+    }
+    aJSON += *c;
+  }
+}
+
+} // anonymous namespace
+
+void
+Trace::setEnabled(bool aEnabled)
+{
+  sEnabled.store(aEnabled, memory_order_relaxed);
+}
+
+__uint64_t
+Trace::now()
+{
+  // Starting the clock at one keeps zero free to mean "not recording".
+  static const chrono::steady_clock::time_point sStart = chrono::steady_clock::now();
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - sStart).count() + 1;
+}
+
+void
+Trace::record(const char* aName, __uint64_t aStart, __uint64_t aEnd)
+{
+  Span span;
+  span.name = aName;
+  span.start = aStart;
+  span.end = aEnd;
+  span.thread = currentThread();
+
+  TraceState& traceState = state();
+  lock_guard<mutex> lock(traceState.spansMutex);
+  if (traceState.spans.size() < TRACE_MAX_SPANS) {
+    traceState.spans.push_back(span);
+  } else {
+    traceState.spans[traceState.nextSpan] = span;
+    traceState.nextSpan = (traceState.nextSpan + 1) % TRACE_MAX_SPANS;
+  }
+}
+
+string
+Trace::toJSON()
+{
+  vector<Span> spans;
+  {
+    TraceState& traceState = state();
+    lock_guard<mutex> lock(traceState.spansMutex);
+    // Oldest first.
+    spans.assign(traceState.spans.begin() + traceState.nextSpan, traceState.spans.end());
+    spans.insert(spans.end(), traceState.spans.begin(), traceState.spans.begin() + traceState.nextSpan);
+  }
+
+  // Complete events, with times in microseconds.
+  string json = "{\"traceEvents\":[";
+  char buffer[128];
+  for (size_t i = 0; i < spans.size(); i++) {
+    const Span& span = spans[i];
+    json += i ? ",\n{\"name\":\"" : "\n{\"name\":\"";
+    appendEscaped(json, span.name);
+    snprintf(buffer, sizeof(buffer),
+             "\",\"cat\":\"pathfinder\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+             span.start / 1000.0,
+             (span.end - span.start) / 1000.0,
+             span.thread);
+    json += buffer;
+  }
+  json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return json;
+}
+
+void
+Trace::reset()
+{
+  TraceState& traceState = state();
+  lock_guard<mutex> lock(traceState.spansMutex);
+  traceState.spans.clear();
+  traceState.nextSpan = 0;
+}
+
+} // namespace pathfinder
@@ -0,0 +1,81 @@
+// pathfinder/src/trace.h
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+#ifndef PATHFINDER_TRACE_H
+#define PATHFINDER_TRACE_H
+
+#include "platform.h"
+
+#include <atomic>
+#include <string>
+
+namespace pathfinder {
+
+// Records spans of CPU time, from any thread, for viewing in a trace viewer
+// such as chrome://tracing. The spans are only compiled in when
+// PATHFINDER_TRACE is defined, and then only recorded while enabled.
+class Trace
+{
+public:
+  static void setEnabled(bool aEnabled);
+  static bool getEnabled() {
+    return sEnabled.load(std::memory_order_relaxed);
+  }
+
+  // In nanoseconds, from an arbitrary start.
+  static __uint64_t now();
+  // aName must outlive the trace, as string literals do.
+  static void record(const char* aName, __uint64_t aStart, __uint64_t aEnd);
+
+  // The spans recorded since the last reset(), as trace_event JSON. Only the
+  // latest spans are kept, so a long trace loses its beginning.
+  static std::string toJSON();
+  static void reset();
+
+private:
+  static std::atomic<bool> sEnabled;
+}; // class Trace
+
+// Records the time from its construction to its destruction as a span named
+// aName, if tracing was enabled when it began.
+class TraceScope
+{
+public:
+  explicit TraceScope(const char* aName)
+    : mName(aName)
+    , mStart(Trace::getEnabled() ? Trace::now() : 0)
+  {
+  }
+  ~TraceScope() {
+    if (mStart) {
+      Trace::record(mName, mStart, Trace::now());
+    }
+  }
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+  const char* mName;
+  __uint64_t mStart;
+}; // class TraceScope
+
+#define PATHFINDER_TRACE_CONCAT_(a, b) a##b
+#define PATHFINDER_TRACE_CONCAT(a, b) PATHFINDER_TRACE_CONCAT_(a, b)
+
+#ifdef PATHFINDER_TRACE
+#define PATHFINDER_TRACE_SCOPE(aName) \
+  TraceScope PATHFINDER_TRACE_CONCAT(traceScope, __LINE__)(aName)
+#else
+#define PATHFINDER_TRACE_SCOPE(aName)
+#endif
+
+} // namespace pathfinder
+
+#endif // PATHFINDER_TRACE_H
@@ -13,6 +13,10 @@
 
 #include "platform.h"
 
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
 namespace pathfinder {
 
 const int FLOAT32_SIZE = 4;
@@ -30,6 +34,64 @@ constexpr __uint32_t fourcc(char const p[5])
   return (p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
 }
 
+const __uint64_t FNV1A_64_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+const __uint64_t FNV1A_64_PRIME = 0x100000001b3ULL;
+
+// 64-bit FNV-1a. Pass the previous result as aHash to hash several values
+// in sequence.
+inline __uint64_t fnv1a(const void* aData, size_t aLength, __uint64_t aHash = FNV1A_64_OFFSET_BASIS)
+{
+  const __uint8_t* bytes = (const __uint8_t*)aData;
+  for (size_t i = 0; i < aLength; i++) {
+    aHash ^= bytes[i];
+    aHash *= FNV1A_64_PRIME;
+  }
+  return aHash;
+}
+
+// Files written by Pathfinder store integers and floats little-endian,
+// whatever the byte order of the machine.
+inline void appendUInt32LE(std::vector<__uint8_t>& aBuffer, __uint32_t aValue)
+{
+  for (int i = 0; i < 4; i++) {
+    aBuffer.push_back((__uint8_t)(aValue >> (i * 8)));
+  }
+}
+
+inline void appendUInt64LE(std::vector<__uint8_t>& aBuffer, __uint64_t aValue)
+{
+  appendUInt32LE(aBuffer, (__uint32_t)aValue);
+  appendUInt32LE(aBuffer, (__uint32_t)(aValue >> 32));
+}
+
+inline void appendFloat32LE(std::vector<__uint8_t>& aBuffer, float aValue)
+{
+  __uint32_t bits;
+  memcpy(&bits, &aValue, sizeof(bits));
+  appendUInt32LE(aBuffer, bits);
+}
+
+inline __uint32_t readUInt32LE(const __uint8_t* aData)
+{
+  return (__uint32_t)aData[0] |
+         ((__uint32_t)aData[1] << 8) |
+         ((__uint32_t)aData[2] << 16) |
+         ((__uint32_t)aData[3] << 24);
+}
+
+inline __uint64_t readUInt64LE(const __uint8_t* aData)
+{
+  return (__uint64_t)readUInt32LE(aData) | ((__uint64_t)readUInt32LE(aData + 4) << 32);
+}
+
+inline float readFloat32LE(const __uint8_t* aData)
+{
+  __uint32_t bits = readUInt32LE(aData);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
 class Range {
 public:
   int start;
@@ -14,9 +14,11 @@
 #include "gl-utils.h"
 #include "shader-loader.h"
 #include "meshes.h"
+#include "stream-buffer.h"
 #include <hydra.h>
 #include <memory>
 #include <assert.h>
+#include <stddef.h>
 
 using namespace std;
 using namespace kraken;
@@ -64,19 +66,19 @@ XCAAStrategy::~XCAAStrategy()
     mPatchIndexBuffer = 0;
   }
   if (mResolveVAO) {
-    GLDEBUG(glDeleteVertexArrays(1, &mResolveVAO));
+    GLDEBUG(GLState::deleteVertexArrays(1, &mResolveVAO));
     mResolveVAO = 0;
   }
   if (mAAAlphaTexture) {
-    GLDEBUG(glDeleteTextures(1, &mAAAlphaTexture));
+    GLDEBUG(GLState::deleteTextures(1, &mAAAlphaTexture));
     mAAAlphaTexture = 0;
   }
   if (mAADepthTexture) {
-    GLDEBUG(glDeleteTextures(1, &mAADepthTexture));
+    GLDEBUG(GLState::deleteTextures(1, &mAADepthTexture));
     mAADepthTexture = 0;
   }
   if (mAAFramebuffer) {
-    GLDEBUG(glDeleteTextures(1, &mAAFramebuffer));
+    GLDEBUG(GLState::deleteTextures(1, &mAAFramebuffer));
     mAAFramebuffer = 0;
   }
 }
@@ -104,7 +106,7 @@ XCAAStrategy::setFramebufferSize(Renderer& renderer)
                                          mDestFramebufferSize.y * getSupersampleScale().y);
 
   initAAAlphaFramebuffer(renderer);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 void
@@ -116,14 +118,13 @@ XCAAStrategy::finishAntialiasingObject(Renderer& renderer, int objectIndex)
     return;
   }
 
-  Vector2i usedSize = supersampledUsedSize(renderer);
-  GLDEBUG(glScissor(0, 0, usedSize[0], usedSize[1]));
-  GLDEBUG(glEnable(GL_SCISSOR_TEST));
+  // The atlas is bound at this point, so scissor in atlas pixels.
+  renderer.setAtlasDirtyScissor(Vector2i::One());
 
   // Clear out the color and depth textures.
-  GLDEBUG(glClearColor(1.0, 1.0, 1.0, 1.0));
-  GLDEBUG(glClearDepth(0.0));
-  GLDEBUG(glDepthMask(GL_TRUE));
+  GLDEBUG(GLState::clearColor(1.0, 1.0, 1.0, 1.0));
+  GLDEBUG(GLState::clearDepth(0.0));
+  GLDEBUG(GLState::depthMask(GL_TRUE));
   GLDEBUG(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 }
 
@@ -156,26 +157,24 @@ XCAAStrategy::resolveAAForObject(Renderer& renderer, int objectIndex)
   PathfinderShaderProgram& resolveProgram = getResolveProgram(renderer);
 
   // Set state for XCAA resolve.
-  Vector2i usedSize = renderer.getAtlasUsedSize();
-  GLDEBUG(glScissor(0, 0, usedSize[0], usedSize[1]));
-  GLDEBUG(glEnable(GL_SCISSOR_TEST));
+  renderer.setAtlasDirtyScissor(Vector2i::One());
   setDepthAndBlendModeForResolve();
 
   // Clear out the resolve buffer, if necessary.
   clearForResolve(renderer);
 
   // Resolve.
-  GLDEBUG(glUseProgram(resolveProgram.getProgram()));
+  GLDEBUG(GLState::useProgram(resolveProgram.getProgram()));
   // was renderContext.vertexArrayObjectExt
-  GLDEBUG(glBindVertexArray(mResolveVAO));
+  GLDEBUG(GLState::bindVertexArray(mResolveVAO));
   if (resolveProgram.hasUniform(uniform_uFramebufferSize)) {
     GLDEBUG(glUniform2i(resolveProgram.getUniform(uniform_uFramebufferSize),
       mDestFramebufferSize[0],
       mDestFramebufferSize[1]));
   }
   if (resolveProgram.hasUniform(uniform_uAAAlpha)) {
-    GLDEBUG(glActiveTexture(GL_TEXTURE0));
-    GLDEBUG(glBindTexture(GL_TEXTURE_2D, mAAAlphaTexture));
+    GLDEBUG(GLState::activeTexture(GL_TEXTURE0));
+    GLDEBUG(GLState::bindTexture(GL_TEXTURE_2D, mAAAlphaTexture));
     GLDEBUG(glUniform1i(resolveProgram.getUniform(uniform_uAAAlpha), 0));
   }
   if (resolveProgram.hasUniform(uniform_uAAAlphaDimensions)) {
@@ -199,7 +198,7 @@ XCAAStrategy::resolveAAForObject(Renderer& renderer, int objectIndex)
   GLDEBUG(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.getRenderContext()->quadElementsBuffer()));
   GLDEBUG(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0));
   // was vertexArrayObjectExt.bindVertexArrayOES
-  GLDEBUG(glBindVertexArray(0));
+  GLDEBUG(GLState::bindVertexArray(0));
 }
 
 Matrix4
@@ -209,79 +208,59 @@ XCAAStrategy::getTransform() const
 }
 
 
-Vector2i
-XCAAStrategy::supersampledUsedSize(Renderer& renderer)
-{
-  return Vector2i::Create(renderer.getAtlasUsedSize().x * getSupersampleScale().x,
-                          renderer.getAtlasUsedSize().y * getSupersampleScale().y);
-}
-
 void
 XCAAStrategy::prepareAA(Renderer& renderer)
 {
   // Set state for antialiasing.
-  Vector2i usedSize = supersampledUsedSize(renderer);
   if (usesAAFramebuffer(renderer)) {
-    GLDEBUG(glBindFramebuffer(GL_FRAMEBUFFER, mAAFramebuffer));
+    GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, mAAFramebuffer));
   }
-  GLDEBUG(glViewport(0,
+  GLDEBUG(GLState::viewport(0,
              0,
              mSupersampledFramebufferSize[0],
              mSupersampledFramebufferSize[1]));
-  GLDEBUG(glScissor(0, 0, usedSize[0], usedSize[1]));
-  GLDEBUG(glEnable(GL_SCISSOR_TEST));
+  renderer.setAtlasDirtyScissor(getSupersampleScale());
 }
 
 void
 XCAAStrategy::setAAState(Renderer& renderer)
 {
-  Vector2i usedSize = supersampledUsedSize(renderer);
   if (usesAAFramebuffer(renderer)) {
-    GLDEBUG(glBindFramebuffer(GL_FRAMEBUFFER, mAAFramebuffer));
+    GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, mAAFramebuffer));
   }
-  GLDEBUG(glViewport(0,
+  GLDEBUG(GLState::viewport(0,
              0,
              mSupersampledFramebufferSize[0],
              mSupersampledFramebufferSize[1]));
-  GLDEBUG(glScissor(0, 0, usedSize[0], usedSize[1]));
-  GLDEBUG(glEnable(GL_SCISSOR_TEST));
+  renderer.setAtlasDirtyScissor(getSupersampleScale());
 
   setAADepthState(renderer);
 }
 
 void
 XCAAStrategy::setAAUniforms(Renderer& renderer, PathfinderShaderProgram& aProgram, int objectIndex) {
-  switch (getTransformType()) {
-  case tt_affine:
-    renderer.setTransformAffineUniforms(aProgram, 0);
-    break;
-  case tt_3d:
-    renderer.setTransformUniform(aProgram, 0, 0);
-    break;
-  }
-
+  // The transform and hints come from the path uniform block.
   GLDEBUG(glUniform2i(aProgram.getUniform(uniform_uFramebufferSize),
               mSupersampledFramebufferSize[0],
               mSupersampledFramebufferSize[1]));
   renderer.getPathTransformBufferTextures()[0]->ext->bind(aProgram, 0);
   renderer.getPathTransformBufferTextures()[0]->st->bind(aProgram, 1);
   mPathBoundsBufferTextures[objectIndex]->bind(aProgram, 2);
-  renderer.setHintsUniform(aProgram);
   renderer.bindAreaLUT(4, aProgram);
 }
 
 void
 XCAAStrategy::setDepthAndBlendModeForResolve()
 {
-  GLDEBUG(glDisable(GL_DEPTH_TEST));
-  GLDEBUG(glDisable(GL_BLEND));
+  GLDEBUG(GLState::disable(GL_DEPTH_TEST));
+  GLDEBUG(GLState::disable(GL_BLEND));
 }
 
 void
 XCAAStrategy::initResolveFramebufferForObject(Renderer& renderer, int objectIndex) {
-  GLDEBUG(glBindFramebuffer(GL_FRAMEBUFFER, renderer.getAtlasFramebuffer()));
-  GLDEBUG(glViewport(0, 0, mDestFramebufferSize[0], mDestFramebufferSize[1]));
-  GLDEBUG(glDisable(GL_SCISSOR_TEST));
+  GLDEBUG(GLState::bindFramebuffer(GL_FRAMEBUFFER, renderer.getAtlasFramebuffer()));
+  GLDEBUG(GLState::viewport(0, 0, mDestFramebufferSize[0], mDestFramebufferSize[1]));
+  GLDEBUG(GLState::disable(GL_SCISSOR_TEST));
 }
 
 void
@@ -289,15 +268,15 @@ XCAAStrategy::initAAAlphaFramebuffer(Renderer& renderer)
 {
   if (!getMightUseAAFramebuffer()) {
     if (mAAAlphaTexture) {
-      GLDEBUG(glDeleteTextures(1, &mAAAlphaTexture));
+      GLDEBUG(GLState::deleteTextures(1, &mAAAlphaTexture));
       mAAAlphaTexture = 0;
     }
     if (mAADepthTexture) {
-      GLDEBUG(glDeleteTextures(1, &mAADepthTexture));
+      GLDEBUG(GLState::deleteTextures(1, &mAADepthTexture));
       mAADepthTexture = 0;
     }
     if (mAAFramebuffer) {
-      GLDEBUG(glDeleteTextures(1, &mAAFramebuffer));
+      GLDEBUG(GLState::deleteTextures(1, &mAAFramebuffer));
       mAAFramebuffer = 0;
     }
     return;
@@ -306,8 +285,8 @@ XCAAStrategy::initAAAlphaFramebuffer(Renderer& renderer)
     GLDEBUG(glCreateTextures(GL_TEXTURE_2D, 1, &mAAAlphaTexture));
   }
 
-  GLDEBUG(glActiveTexture(GL_TEXTURE0));
-  GLDEBUG(glBindTexture(GL_TEXTURE_2D, mAAAlphaTexture));
+  GLDEBUG(GLState::activeTexture(GL_TEXTURE0));
+  GLDEBUG(GLState::bindTexture(GL_TEXTURE_2D, mAAAlphaTexture));
   GLDEBUG(glTexImage2D(GL_TEXTURE_2D,
     0,
     GL_RGB,
@@ -330,7 +309,8 @@ XCAAStrategy::createPathBoundsBufferTextureForObjectIfNecessary(Renderer& render
 
   if (mPathBoundsBufferTextures[objectIndex] == nullptr) {
     mPathBoundsBufferTextures[objectIndex] =
-      make_unique<PathfinderBufferTexture>(uniform_uPathBounds, uniform_uPathBoundsDimensions);
+      make_unique<PathfinderBufferTexture>(renderer.getRenderContext()->getStreamBuffer(),
+                                           uniform_uPathBounds);
   }
 
   mPathBoundsBufferTextures[objectIndex]->upload(*pathBounds);
@@ -346,13 +326,13 @@ XCAAStrategy::createResolveVAO(RenderContext& renderContext, Renderer& renderer)
 
 
   // was vertexArrayObjectExt.bindVertexArrayOES
-  GLDEBUG(glBindVertexArray(mResolveVAO));
+  GLDEBUG(GLState::bindVertexArray(mResolveVAO));
 
-  GLDEBUG(glUseProgram(resolveProgram.getProgram()));
+  GLDEBUG(GLState::useProgram(resolveProgram.getProgram()));
   renderContext.initQuadVAO(resolveProgram);
 
   // was vertexArrayObjectExt.bindVertexArrayOES
-  GLDEBUG(glBindVertexArray(0));
+  GLDEBUG(GLState::bindVertexArray(0));
 }
 
 TransformType
@@ -384,6 +364,9 @@ MCAAStrategy::attachMeshes(RenderContext& renderContext, Renderer& renderer)
   if (mVAO == 0) {
     GLDEBUG(glCreateVertexArrays(1, &mVAO));
   }
+  // The mesh buffers may have been replaced.
+  mVAOMeshIndex = -1;
+  initVAOForObject(renderer, 0);
 }
 
 void
@@ -412,8 +395,8 @@ MCAAStrategy::clearForAA(Renderer& renderer)
     return;
   }
 
-  GLDEBUG(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
-  GLDEBUG(glClearDepth(0.0f));
+  GLDEBUG(GLState::clearColor(0.0f, 0.0f, 0.0f, 0.0f));
+  GLDEBUG(GLState::clearDepth(0.0f));
   GLDEBUG(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 }
 
@@ -422,21 +405,21 @@ MCAAStrategy::setAADepthState(Renderer& renderer)
 {
 
   if (getDirectRenderingMode() != drm_conservative) {
-    GLDEBUG(glDisable(GL_DEPTH_TEST));
+    GLDEBUG(GLState::disable(GL_DEPTH_TEST));
     return;
   }
 
-  GLDEBUG(glDepthFunc(GL_GREATER));
-  GLDEBUG(glDepthMask(GL_FALSE));
-  GLDEBUG(glEnable(GL_DEPTH_TEST));
-  GLDEBUG(glDisable(GL_CULL_FACE));
+  GLDEBUG(GLState::depthFunc(GL_GREATER));
+  GLDEBUG(GLState::depthMask(GL_FALSE));
+  GLDEBUG(GLState::enable(GL_DEPTH_TEST));
+  GLDEBUG(GLState::disable(GL_CULL_FACE));
 }
 
 void
 MCAAStrategy::clearForResolve(Renderer& renderer)
 {
   if (!renderer.getIsMulticolor()) {
-    GLDEBUG(glClearColor(0.0f, 0.0f, 0.0, 1.0f));
+    GLDEBUG(GLState::clearColor(0.0f, 0.0f, 0.0, 1.0f));
     GLDEBUG(glClear(GL_COLOR_BUFFER_BIT));
   }
 }
@@ -446,12 +429,12 @@ void
 MCAAStrategy::setBlendModeForAA(Renderer& renderer)
 {
   if (renderer.getIsMulticolor()) {
-    GLDEBUG(glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE));
+    GLDEBUG(GLState::blendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE));
   } else {
-    GLDEBUG(glBlendFunc(GL_ONE, GL_ONE));
+    GLDEBUG(GLState::blendFunc(GL_ONE, GL_ONE));
   }
-  GLDEBUG(glBlendEquation(GL_FUNC_ADD));
-  GLDEBUG(glEnable(GL_BLEND));
+  GLDEBUG(GLState::blendEquation(GL_FUNC_ADD));
+  GLDEBUG(GLState::enable(GL_BLEND));
 }
 
 void MCAAStrategy::prepareAA(Renderer& renderer)
@@ -474,12 +457,19 @@ MCAAStrategy::initVAOForObject(Renderer& renderer, int objectIndex)
 
   // FIXME(pcwalton): Refactor.
   // was vertexArrayObjectExt.bindVertexArrayOES
-  GLDEBUG(glBindVertexArray(mVAO));
+  GLDEBUG(GLState::bindVertexArray(mVAO));
 
+  // With base instances the attributes can start at the first box of the mesh
+  // and stay put; otherwise they start at the first box to be drawn.
   std::vector<Range>& bBoxRanges = renderer.getMeshes()[meshIndex]->bBoxPathRanges;
-  off_t offset = calculateStartFromIndexRanges(pathRange, bBoxRanges);
+  off_t offset = 0;
+  if (!renderer.getRenderContext()->getSupportsBaseInstance()) {
+    offset = calculateStartFromIndexRanges(pathRange, bBoxRanges);
+  }
+  mVAOMeshIndex = meshIndex;
+  mVAOFirstBox = offset;
 
-  GLDEBUG(glUseProgram(shaderProgram.getProgram()));
+  GLDEBUG(GLState::useProgram(shaderProgram.getProgram()));
   GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, renderer.getRenderContext()->quadPositionsBuffer()));
   GLDEBUG(glVertexAttribPointer(shaderProgram.getAttribute(attribute_aTessCoord), 2, GL_FLOAT, GL_FALSE, FLOAT32_SIZE * 2, 0));
   GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, renderer.getMeshBuffers()[meshIndex]->bBoxes));
@@ -542,7 +532,7 @@ MCAAStrategy::initVAOForObject(Renderer& renderer, int objectIndex)
   GLDEBUG(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.getRenderContext()->quadElementsBuffer()));
 
   // was vertexArrayObjectExt.bindVertexArrayOES
-  GLDEBUG(glBindVertexArray(0));
+  GLDEBUG(GLState::bindVertexArray(0));
 }
 
 PathfinderShaderProgram&
@@ -563,30 +553,32 @@ MCAAStrategy::antialiasEdgesOfObjectWithProgram(Renderer& renderer,
   Range pathRange = renderer.pathRangeForObject(objectIndex);
   int meshIndex = renderer.meshIndexForObject(objectIndex);
 
-  initVAOForObject(renderer, objectIndex);
+  // The VAO only has to be rebuilt when the object's boxes start somewhere
+  // else in the mesh, and not at all if the draw can skip to them.
+  std::vector<Range>& bBoxRanges = renderer.getMeshes()[meshIndex]->bBoxPathRanges;
+  int firstBox = calculateStartFromIndexRanges(pathRange, bBoxRanges);
+  bool supportsBaseInstance = renderer.getRenderContext()->getSupportsBaseInstance();
+  if (meshIndex != mVAOMeshIndex || (!supportsBaseInstance && firstBox != mVAOFirstBox)) {
+    initVAOForObject(renderer, objectIndex);
+  }
 
-  GLDEBUG(glUseProgram(aProgram.getProgram()));
+  GLDEBUG(GLState::useProgram(aProgram.getProgram()));
   setAAUniforms(renderer, aProgram, objectIndex);
 
   // FIXME(pcwalton): Refactor.
   // was vertexArrayObjectExt.bindVertexArrayOES
-  GLDEBUG(glBindVertexArray(mVAO));
+  GLDEBUG(GLState::bindVertexArray(mVAO));
 
   setBlendModeForAA(renderer);
   setAADepthState(renderer);
 
-  GLDEBUG(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.getRenderContext()->quadElementsBuffer()));
-
-  std::vector<Range>& bBoxRanges = renderer.getMeshes()[meshIndex]->bBoxPathRanges;
   int count = calculateCountFromIndexRanges(pathRange, bBoxRanges);
-
-  // was instancedArraysExt.drawElementsInstancedANGLE
-  GLDEBUG(glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0, count));
+  drawQuadInstances(count, firstBox - mVAOFirstBox);
 
   // was vertexArrayObjectExt.bindVertexArrayOES
-  GLDEBUG(glBindVertexArray(0));
-  GLDEBUG(glDisable(GL_DEPTH_TEST));
-  GLDEBUG(glDisable(GL_CULL_FACE));
+  GLDEBUG(GLState::bindVertexArray(0));
+  GLDEBUG(GLState::disable(GL_DEPTH_TEST));
+  GLDEBUG(GLState::disable(GL_CULL_FACE));
 }
 
 DirectRenderingMode
@@ -628,7 +620,7 @@ void
 StencilAAAStrategy::attachMeshes(RenderContext& renderContext, Renderer& renderer)
 {
   XCAAStrategy::attachMeshes(renderContext, renderer);
-  createVAO(renderer);
+  createVAO(renderer, 0);
 }
 
 void
@@ -645,26 +637,31 @@ StencilAAAStrategy::antialiasObject(Renderer& renderer, int objectIndex)
   setBlendModeForAA(renderer);
 
   PathfinderShaderProgram& program = *renderer.getRenderContext()->getShaderManager().getProgram(program_stencilAAA);
-  GLDEBUG(glUseProgram(program.getProgram()));
+  GLDEBUG(GLState::useProgram(program.getProgram()));
   setAAUniforms(renderer, program, objectIndex);
 
-  // was vertexArrayObjectExt.bindVertexArrayOES
-  GLDEBUG(glBindVertexArray(mVAO));
-
-  // FIXME(pcwalton): Only render the appropriate instances.
-  int count = renderer.getMeshes()[0]->stencilSegmentsCount();
-  if (program.hasUniform(uniform_uSide)) {
-    for (int side = 0; side < 2; side++) {
-      GLDEBUG(glUniform1i(program.getUniform(uniform_uSide), side));
-      // was instancedArraysExt.drawElementsInstancedANGLE
-      GLDEBUG(glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0, count));
-    }
-  } else {
-    GLDEBUG(glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0, count));
+  // Only render the segments of the paths that are being redrawn.
+  Range pathRange = renderer.pathRangeForObject(objectIndex);
+  std::vector<Range>& segmentRanges = renderer.getMeshes()[0]->stencilSegmentPathRanges;
+  int firstSegment = calculateStartFromIndexRanges(pathRange, segmentRanges);
+  int count = calculateCountFromIndexRanges(pathRange, segmentRanges);
+  if (count <= 0) {
+    return;
   }
+  bool supportsBaseInstance = renderer.getRenderContext()->getSupportsBaseInstance();
+  if (!supportsBaseInstance && firstSegment != mVAOFirstSegment) {
+    createVAO(renderer, firstSegment);
+    GLDEBUG(GLState::useProgram(program.getProgram()));
+  }
+
+  // was vertexArrayObjectExt.bindVertexArrayOES
+  GLDEBUG(GLState::bindVertexArray(mVAO));
+  // Every segment is drawn as two instances, one for each half of the curve;
+  // the attributes advance every other instance.
+  drawQuadInstances(count * 2, firstSegment - mVAOFirstSegment);
 
   // was vertexArrayObjectExt.bindVertexArrayOES
-  GLDEBUG(glBindVertexArray(0));
+  GLDEBUG(GLState::bindVertexArray(0));
 }
 
 bool
@@ -676,8 +673,8 @@ StencilAAAStrategy::usesAAFramebuffer(Renderer& renderer)
 void
 StencilAAAStrategy::clearForAA(Renderer& renderer)
 {
-  GLDEBUG(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
-  GLDEBUG(glClearDepth(0.0f));
+  GLDEBUG(GLState::clearColor(0.0f, 0.0f, 0.0f, 0.0f));
+  GLDEBUG(GLState::clearDepth(0.0f));
   GLDEBUG(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 }
 
@@ -701,26 +698,19 @@ StencilAAAStrategy::getResolveProgram(Renderer& renderer)
 void
 StencilAAAStrategy::setAADepthState(Renderer& renderer)
 {
-  GLDEBUG(glDisable(GL_DEPTH_TEST));
-  GLDEBUG(glDisable(GL_CULL_FACE));
-}
-
-void
-StencilAAAStrategy::setAAUniforms(Renderer& renderer, PathfinderShaderProgram& aProgram, int objectIndex)
-{
-  XCAAStrategy::setAAUniforms(renderer, aProgram, objectIndex);
-  renderer.setEmboldenAmountUniform(objectIndex, aProgram);
+  GLDEBUG(GLState::disable(GL_DEPTH_TEST));
+  GLDEBUG(GLState::disable(GL_CULL_FACE));
 }
 
 void
 StencilAAAStrategy::clearForResolve(Renderer& renderer)
 {
-  GLDEBUG(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+  GLDEBUG(GLState::clearColor(0.0f, 0.0f, 0.0f, 0.0f));
   GLDEBUG(glClear(GL_COLOR_BUFFER_BIT));
 }
 
 void
-StencilAAAStrategy::createVAO(Renderer& renderer)
+StencilAAAStrategy::createVAO(Renderer& renderer, int firstSegment)
 {
   if (!renderer.getMeshesAttached()) {
     return;
@@ -734,13 +724,18 @@ StencilAAAStrategy::createVAO(Renderer& renderer)
     GLDEBUG(glCreateVertexArrays(1, &mVAO));
   }
   // was vertexArrayObjectExt.bindVertexArrayOES
-  GLDEBUG(glBindVertexArray(mVAO));
+  GLDEBUG(GLState::bindVertexArray(mVAO));
 
   GLuint vertexPositionsBuffer = renderer.getMeshBuffers()[0]->stencilSegments;
   GLuint vertexNormalsBuffer = renderer.getMeshBuffers()[0]->stencilNormals;
   GLuint pathIDsBuffer = renderer.getMeshBuffers()[0]->stencilSegmentPathIDs;
 
-  GLDEBUG(glUseProgram(program.getProgram()));
+  // The instanced attributes start at the first segment to be drawn, since
+  // instanced draws can't take a base instance here.
+  mVAOFirstSegment = firstSegment;
+  size_t segmentOffset = (size_t)firstSegment * FLOAT32_SIZE * 6;
+
+  GLDEBUG(GLState::useProgram(program.getProgram()));
   GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, renderContext.quadPositionsBuffer()));
   GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aTessCoord), 2, GL_FLOAT, GL_FALSE, 0, 0));
   GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, vertexPositionsBuffer));
@@ -749,40 +744,45 @@ StencilAAAStrategy::createVAO(Renderer& renderer)
     GL_FLOAT,
     GL_FALSE,
     FLOAT32_SIZE * 6,
-    0));
+    (void*)(segmentOffset)));
   GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aCtrlPosition),
     2,
     GL_FLOAT,
     GL_FALSE,
     FLOAT32_SIZE * 6,
-    (void*)(FLOAT32_SIZE * 2)));
+    (void*)(segmentOffset + FLOAT32_SIZE * 2)));
   GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aToPosition),
     2,
     GL_FLOAT,
     false,
     FLOAT32_SIZE * 6,
-    (void*)(FLOAT32_SIZE * 4)));
+    (void*)(segmentOffset + FLOAT32_SIZE * 4)));
   GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, vertexNormalsBuffer));
   GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aFromNormal),
     2,
     GL_FLOAT,
     GL_FALSE,
     FLOAT32_SIZE * 6,
-    0));
+    (void*)(segmentOffset)));
   GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aCtrlNormal),
     2,
     GL_FLOAT,
     false,
     FLOAT32_SIZE * 6,
-    (void*)(FLOAT32_SIZE * 2)));
+    (void*)(segmentOffset + FLOAT32_SIZE * 2)));
   GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aToNormal),
     2,
     GL_FLOAT,
     false,
     FLOAT32_SIZE * 6,
-    (void*)(FLOAT32_SIZE * 4));
+    (void*)(segmentOffset + FLOAT32_SIZE * 4));
   GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, pathIDsBuffer)));
-  GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aPathID), 1, GL_UNSIGNED_SHORT, GL_FALSE, 0, 0));
+  GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aPathID),
+    1,
+    GL_UNSIGNED_SHORT,
+    GL_FALSE,
+    0,
+    (void*)(firstSegment * sizeof(__uint16_t))));
 
   GLDEBUG(glEnableVertexAttribArray(program.getAttribute(attribute_aTessCoord)));
   GLDEBUG(glEnableVertexAttribArray(program.getAttribute(attribute_aFromPosition)));
@@ -794,33 +794,198 @@ StencilAAAStrategy::createVAO(Renderer& renderer)
   GLDEBUG(glEnableVertexAttribArray(program.getAttribute(attribute_aPathID)));
 
   // was instancedArraysExt.vertexAttribDivisorANGLE
-  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aFromPosition), 1));
-  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aCtrlPosition), 1));
-  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aToPosition), 1));
-  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aFromNormal), 1));
-  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aCtrlNormal), 1));
-  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aToNormal), 1));
-  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aPathID), 1));
+  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aFromPosition), 2));
+  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aCtrlPosition), 2));
+  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aToPosition), 2));
+  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aFromNormal), 2));
+  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aCtrlNormal), 2));
+  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aToNormal), 2));
+  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aPathID), 2));
 
   GLDEBUG(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderContext.quadElementsBuffer()));
 
   // was vertexArrayObjectExt.bindVertexArrayOES
-  GLDEBUG(glBindVertexArray(0));
+  GLDEBUG(GLState::bindVertexArray(0));
 }
 
 void
 StencilAAAStrategy::setBlendModeForAA(Renderer& renderer)
 {
-  GLDEBUG(glBlendEquation(GL_FUNC_ADD));
-  GLDEBUG(glBlendFunc(GL_ONE, GL_ONE));
-  GLDEBUG(glEnable(GL_BLEND));
+  GLDEBUG(GLState::blendEquation(GL_FUNC_ADD));
+  GLDEBUG(GLState::blendFunc(GL_ONE, GL_ONE));
+  GLDEBUG(GLState::enable(GL_BLEND));
 }
 
-AdaptiveStencilMeshAAAStrategy::AdaptiveStencilMeshAAAStrategy(int level, SubpixelAAType subpixelAA)
+TiledStencilAAAStrategy::TiledStencilAAAStrategy(int aLevel, SubpixelAAType aSubpixelAA)
+  : StencilAAAStrategy(aLevel, aSubpixelAA)
+  , mTileVAO(0)
+  , mTileFillBuffer(0)
+  , mTileFillBufferCapacity(0)
+{
+}
+
+TiledStencilAAAStrategy::~TiledStencilAAAStrategy()
+{
+  if (mTileVAO) {
+    GLDEBUG(GLState::deleteVertexArrays(1, &mTileVAO));
+    mTileVAO = 0;
+  }
+  if (mTileFillBuffer) {
+    GLDEBUG(glDeleteBuffers(1, &mTileFillBuffer));
+    mTileFillBuffer = 0;
+  }
+}
+
+bool
+TiledStencilAAAStrategy::init(Renderer& renderer)
+{
+  if (!StencilAAAStrategy::init(renderer)) {
+    return false;
+  }
+  GLDEBUG(glCreateBuffers(1, &mTileFillBuffer));
+  return true;
+}
+
+void
+TiledStencilAAAStrategy::attachMeshes(RenderContext& renderContext, Renderer& renderer)
+{
+  StencilAAAStrategy::attachMeshes(renderContext, renderer);
+  createTileVAO(renderer);
+}
+
+void
+TiledStencilAAAStrategy::antialiasObject(Renderer& renderer, int objectIndex)
+{
+  XCAAStrategy::antialiasObject(renderer, objectIndex);
+
+  if (renderer.getMeshes().size() == 0) {
+    return;
+  }
+
+  Range pathRange = renderer.pathRangeForObject(objectIndex);
+  std::vector<Range>& segmentRanges = renderer.getMeshes()[0]->stencilSegmentPathRanges;
+  int firstSegment = calculateStartFromIndexRanges(pathRange, segmentRanges);
+  int count = calculateCountFromIndexRanges(pathRange, segmentRanges);
+  if (count <= 0) {
+    return;
+  }
+
+  // Tile the dirty rect, in supersampled pixels.
+  Vector4 dirtyRect = renderer.getAtlasDirtyRect();
+  Vector2i scale = getSupersampleScale();
+  int tileRect[4] = {
+    (int)dirtyRect[0] * scale[0],
+    (int)dirtyRect[1] * scale[1],
+    (int)(dirtyRect[2] - dirtyRect[0]) * scale[0],
+    (int)(dirtyRect[3] - dirtyRect[1]) * scale[1],
+  };
+  RenderContext& renderContext = *renderer.getRenderContext();
+  mTiler.tile(renderer, firstSegment, count, mSupersampledFramebufferSize, tileRect, renderContext.getThreadPool());
+  const std::vector<TileFill>& fills = mTiler.getFills();
+  if (fills.empty()) {
+    return;
+  }
+
+  GLsizeiptr size = (GLsizeiptr)(fills.size() * sizeof(TileFill));
+  if (size > mTileFillBufferCapacity) {
+    GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, mTileFillBuffer));
+    GLDEBUG(glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_DYNAMIC_DRAW));
+    mTileFillBufferCapacity = size;
+  }
+  renderContext.getStreamBuffer().upload(mTileFillBuffer, 0, &fills[0], size);
+
+  // Antialias.
+  setAAState(renderer);
+  setBlendModeForAA(renderer);
+
+  PathfinderShaderProgram& program = *renderContext.getShaderManager().getProgram(program_stencilAAATile);
+  GLDEBUG(GLState::useProgram(program.getProgram()));
+  GLDEBUG(glUniform2i(program.getUniform(uniform_uFramebufferSize),
+                      mSupersampledFramebufferSize[0],
+                      mSupersampledFramebufferSize[1]));
+  GLDEBUG(glUniform4i(program.getUniform(uniform_uCoverageRect),
+                      tileRect[0],
+                      tileRect[1],
+                      tileRect[2],
+                      tileRect[3]));
+
+  // was vertexArrayObjectExt.bindVertexArrayOES
+  GLDEBUG(GLState::bindVertexArray(mTileVAO));
+  drawQuadInstances((int)fills.size(), 0);
+  // was vertexArrayObjectExt.bindVertexArrayOES
+  GLDEBUG(GLState::bindVertexArray(0));
+}
+
+void
+TiledStencilAAAStrategy::createTileVAO(Renderer& renderer)
+{
+  if (!renderer.getMeshesAttached() || mTileVAO != 0) {
+    return;
+  }
+
+  RenderContext& renderContext = *renderer.getRenderContext();
+  PathfinderShaderProgram& program = *renderContext.getShaderManager().getProgram(program_stencilAAATile);
+
+  GLDEBUG(glCreateVertexArrays(1, &mTileVAO));
+  GLDEBUG(GLState::bindVertexArray(mTileVAO));
+  GLDEBUG(GLState::useProgram(program.getProgram()));
+
+  GLsizei stride = sizeof(TileFill);
+  GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, renderContext.quadPositionsBuffer()));
+  GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aTessCoord), 2, GL_FLOAT, GL_FALSE, 0, 0));
+  GLDEBUG(glBindBuffer(GL_ARRAY_BUFFER, mTileFillBuffer));
+  GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aFromPosition),
+    2,
+    GL_FLOAT,
+    GL_FALSE,
+    stride,
+    (void*)offsetof(TileFill, from)));
+  GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aToPosition),
+    2,
+    GL_FLOAT,
+    GL_FALSE,
+    stride,
+    (void*)offsetof(TileFill, to)));
+  GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aTileTop),
+    1,
+    GL_FLOAT,
+    GL_FALSE,
+    stride,
+    (void*)offsetof(TileFill, tileTop)));
+  GLDEBUG(glVertexAttribPointer(program.getAttribute(attribute_aWinding),
+    1,
+    GL_FLOAT,
+    GL_FALSE,
+    stride,
+    (void*)offsetof(TileFill, winding)));
+
+  GLDEBUG(glEnableVertexAttribArray(program.getAttribute(attribute_aTessCoord)));
+  GLDEBUG(glEnableVertexAttribArray(program.getAttribute(attribute_aFromPosition)));
+  GLDEBUG(glEnableVertexAttribArray(program.getAttribute(attribute_aToPosition)));
+  GLDEBUG(glEnableVertexAttribArray(program.getAttribute(attribute_aTileTop)));
+  GLDEBUG(glEnableVertexAttribArray(program.getAttribute(attribute_aWinding)));
+
+  // was instancedArraysExt.vertexAttribDivisorANGLE
+  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aFromPosition), 1));
+  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aToPosition), 1));
+  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aTileTop), 1));
+  GLDEBUG(glVertexAttribDivisor(program.getAttribute(attribute_aWinding), 1));
+
+  GLDEBUG(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderContext.quadElementsBuffer()));
+
+  // was vertexArrayObjectExt.bindVertexArrayOES
+  GLDEBUG(GLState::bindVertexArray(0));
+}
+
+AdaptiveStencilMeshAAAStrategy::AdaptiveStencilMeshAAAStrategy(int level, SubpixelAAType subpixelAA, bool aTiled)
   : AntialiasingStrategy(subpixelAA)
 {
   mMeshStrategy = std::unique_ptr<MCAAStrategy>(new MCAAStrategy(level, subpixelAA));
-  mStencilStrategy = std::unique_ptr<StencilAAAStrategy>(new StencilAAAStrategy(level, subpixelAA));
+  if (aTiled) {
+    mStencilStrategy = std::unique_ptr<StencilAAAStrategy>(new TiledStencilAAAStrategy(level, subpixelAA));
+  } else {
+    mStencilStrategy = std::unique_ptr<StencilAAAStrategy>(new StencilAAAStrategy(level, subpixelAA));
+  }
 }
 
 DirectRenderingMode
@@ -958,4 +1123,18 @@ calculateCountFromIndexRanges(Range pathRange, std::vector<Range>& indexRanges)
   return lastIndex - firstIndex;
 }
 
+void
+drawQuadInstances(int count, int baseInstance)
+{
+#ifdef GL_VERSION_4_2
+  if (baseInstance != 0) {
+    GLDEBUG(glDrawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0, count, baseInstance));
+    return;
+  }
+#endif
+  assert(baseInstance == 0);
+  // was instancedArraysExt.drawElementsInstancedANGLE
+  GLDEBUG(glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0, count));
+}
+
 } // namespace pathfinder
@@ -16,6 +16,7 @@
 #include "buffer-texture.h"
 #include "shader-loader.h"
 #include "context.h"
+#include "tiler.h"
 #include "utils.h"
 
 #include <vector>
@@ -78,7 +79,6 @@ protected:
   virtual TransformType getTransformType() const = 0;
   virtual bool getMightUseAAFramebuffer() const = 0;
   virtual bool usesAAFramebuffer(Renderer& renderer) = 0;
-  kraken::Vector2i supersampledUsedSize(Renderer& renderer);
   virtual void prepareAA(Renderer& renderer);
   void setAAState(Renderer& renderer);
   virtual void setAAUniforms(Renderer& renderer, PathfinderShaderProgram& aProgram, int objectIndex);
@@ -122,6 +122,8 @@ public:
   MCAAStrategy(int aLevel, SubpixelAAType aSubpixelAA)
     : XCAAStrategy(aLevel, aSubpixelAA)
     , mVAO(0)
+    , mVAOMeshIndex(-1)
+    , mVAOFirstBox(-1)
   { }
   virtual void attachMeshes(RenderContext& renderContext, Renderer& renderer) override;
   virtual void antialiasObject(Renderer& renderer, int objectIndex) override;
@@ -145,6 +147,9 @@ protected:
   void setAAUniforms(Renderer& renderer, PathfinderShaderProgram& aProgram, int objectIndex) override;
 private:
   GLuint mVAO;
+  // The boxes that mVAO's instanced attributes start at.
+  int mVAOMeshIndex;
+  int mVAOFirstBox;
   void setBlendModeForAA(Renderer& renderer);
 
 }; // class MCAAStrategy;
@@ -155,6 +160,7 @@ public:
   StencilAAAStrategy(int aLevel, SubpixelAAType aSubpixelAA)
     : XCAAStrategy(aLevel, aSubpixelAA)
     , mVAO(0)
+    , mVAOFirstSegment(0)
   { }
   virtual DirectRenderingMode getDirectRenderingMode() const override;
   virtual void attachMeshes(RenderContext& renderContext, Renderer& renderer) override;
@@ -167,12 +173,34 @@ protected:
   virtual void clearForAA(Renderer& renderer) override;
   virtual PathfinderShaderProgram& getResolveProgram(Renderer& renderer) override;
   virtual void setAADepthState(Renderer& renderer) override;
-  virtual void setAAUniforms(Renderer& renderer, PathfinderShaderProgram& aProgram, int objectIndex) override;
   virtual void clearForResolve(Renderer& renderer) override;
-private:
-  void createVAO(Renderer& renderer);
   void setBlendModeForAA(Renderer& renderer);
+private:
+  void createVAO(Renderer& renderer, int firstSegment);
   GLuint mVAO;
+  int mVAOFirstSegment;
+};
+
+/// Stencil AAA with the segments binned into 16x16 pixel tiles on the CPU
+/// first, by a Tiler. The lines of the outline only cover up to the top of
+/// their own tile, and the tiles above get one backdrop rectangle each, so a
+/// large glyph no longer costs the height of every segment up to the top of
+/// the path in fill rate. Coverage lands in the same AA framebuffer and is
+/// resolved the same way.
+class TiledStencilAAAStrategy : public StencilAAAStrategy
+{
+public:
+  TiledStencilAAAStrategy(int aLevel, SubpixelAAType aSubpixelAA);
+  virtual ~TiledStencilAAAStrategy();
+  virtual bool init(Renderer& renderer) override;
+  virtual void attachMeshes(RenderContext& renderContext, Renderer& renderer) override;
+  virtual void antialiasObject(Renderer& renderer, int objectIndex) override;
+private:
+  void createTileVAO(Renderer& renderer);
+  Tiler mTiler;
+  GLuint mTileVAO;
+  GLuint mTileFillBuffer;
+  GLsizeiptr mTileFillBufferCapacity;
 };
 
 
@@ -184,7 +212,8 @@ private:
 class AdaptiveStencilMeshAAAStrategy : public AntialiasingStrategy
 {
 public:
-  AdaptiveStencilMeshAAAStrategy(int level, SubpixelAAType subpixelAA);
+  // With aTiled, small glyphs are drawn with TiledStencilAAAStrategy.
+  AdaptiveStencilMeshAAAStrategy(int level, SubpixelAAType subpixelAA, bool aTiled);
   virtual DirectRenderingMode getDirectRenderingMode() const override;
   int getPassCount() const override;
   virtual bool init(Renderer& renderer) override;
@@ -211,6 +240,10 @@ private:
 
 int calculateStartFromIndexRanges(Range pathRange, std::vector<Range>& indexRanges);
 int calculateCountFromIndexRanges(Range pathRange, std::vector<Range>& indexRanges);
+// Draws instances of the unit quad, skipping the first baseInstance instances
+// of the instanced attributes. A nonzero baseInstance needs
+// RenderContext::getSupportsBaseInstance().
+void drawQuadInstances(int count, int baseInstance);
 
 } // namespace pathfinder
 
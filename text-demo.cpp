@@ -184,6 +184,7 @@ TextDemo::renderFrame()
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   // glEnable(GL_DEPTH_TEST);
   // glDepthFunc(GL_LESS);
+  invalidateGLState();
 
   mTextView->draw(transform);
 }
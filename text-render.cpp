@@ -0,0 +1,543 @@
+// text-render.cpp
+//
+// Copyright © 2017 The Pathfinder Project Developers.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+// Renders each line of its input to an image, without a window. The GL
+// context comes from EGL, on Mesa's surfaceless platform where there is one,
+// so it runs on headless machines with only a software driver. One context,
+// batch and view are set up for the whole run and reused for every line.
+//
+// With --reference it checks the images instead of writing them, which makes
+// it a regression check: keep the raw images of the cpu rasterizer, whose
+// output is the same on every machine, and compare later runs of any
+// rasterizer against them.
+
+#include "eb_garamond_ttf.h"
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <pathfinder.h>
+
+using namespace pathfinder;
+using namespace std;
+
+const char USAGE[] =
+R"(usage: pathfinder_text_render [options] [input]
+
+Renders each line of input (standard input by default) to its own image,
+named after the line number, as white text on black.
+
+options:
+  --font PATH           TrueType or OpenType font (default: EB Garamond)
+  --size PIXELS         font size (default: 32)
+  --width PIXELS        image width (default: 512)
+  --height PIXELS       image height (default: 64)
+  --output DIR          where to write the images (default: .)
+  --format png|raw      PNG, or the bare RGBA pixels, top row first
+                        (default: png)
+  --rasterizer NAME     default, tiled, compute or cpu (default: default)
+  --trace PATH          write a Chrome trace of the run; needs a library
+                        built with PATHFINDER_TRACE
+  --reference DIR       instead of writing each image, compare it with the
+                        raw image of the same name in DIR, and fail if any
+                        differ by more than the tolerance
+  --tolerance LEVELS    largest difference --reference accepts in any
+                        channel, out of 255 (default: 0)
+)";
+
+struct Options
+{
+  Options()
+    : fontSize(32.0f)
+    , width(512)
+    , height(64)
+    , outputDir(".")
+    , raw(false)
+    , rasterizer(rz_default)
+    , tolerance(0)
+  {
+  }
+
+  string fontPath;
+  float fontSize;
+  int width;
+  int height;
+  string outputDir;
+  bool raw;
+  Rasterizer rasterizer;
+  string tracePath;
+  string referenceDir;
+  int tolerance;
+  string inputPath;
+};
+
+struct HeadlessContext
+{
+  HeadlessContext()
+    : display(EGL_NO_DISPLAY)
+    , context(EGL_NO_CONTEXT)
+    , surface(EGL_NO_SURFACE)
+  {
+  }
+
+  EGLDisplay display;
+  EGLContext context;
+  EGLSurface surface;
+};
+
+static bool
+hasExtension(const char* aExtensions, const char* aName)
+{
+  if (!aExtensions) {
+    return false;
+  }
+  size_t length = strlen(aName);
+  for (const char* found = strstr(aExtensions, aName); found; found = strstr(found + 1, aName)) {
+    if ((found == aExtensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool
+initContext(HeadlessContext& aContext)
+{
+  // The surfaceless platform needs no X or Wayland display, nor a GPU.
+  const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+      aContext.display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    // The platform can be advertised by a libEGL whose drivers can't run on
+    // it, such as the vendor-neutral dispatcher in front of a proprietary one.
+    if (aContext.display != EGL_NO_DISPLAY && !eglInitialize(aContext.display, NULL, NULL)) {
+      aContext.display = EGL_NO_DISPLAY;
+    }
+  }
+  // Anywhere else, the default display with a pbuffer to draw on.
+  bool fallback = aContext.display == EGL_NO_DISPLAY;
+  if (fallback) {
+    aContext.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (aContext.display == EGL_NO_DISPLAY || !eglInitialize(aContext.display, NULL, NULL)) {
+      aContext.display = EGL_NO_DISPLAY;
+      fprintf(stderr, "ERROR: could not initialize EGL\n");
+      return false;
+    }
+  }
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    fprintf(stderr, "ERROR: EGL has no desktop OpenGL\n");
+    return false;
+  }
+
+  // Everything is drawn into Pathfinder's own framebuffers, so the context
+  // needs no surface of its own; without the extension, a 1x1 pbuffer will do.
+  bool surfaceless = !fallback &&
+                     hasExtension(eglQueryString(aContext.display, EGL_EXTENSIONS),
+                                  "EGL_KHR_surfaceless_context");
+  const EGLint configAttribs[] = {
+    EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_ALPHA_SIZE, 8,
+    EGL_NONE
+  };
+  EGLConfig config;
+  EGLint configCount = 0;
+  if (!eglChooseConfig(aContext.display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+    fprintf(stderr, "ERROR: no suitable EGL config\n");
+    return false;
+  }
+
+  // The shaders are written for GL 4.1 core.
+  const EGLint contextAttribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION_KHR, 4,
+    EGL_CONTEXT_MINOR_VERSION_KHR, 1,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+    EGL_NONE
+  };
+  aContext.context = eglCreateContext(aContext.display, config, EGL_NO_CONTEXT, contextAttribs);
+  if (aContext.context == EGL_NO_CONTEXT) {
+    fprintf(stderr, "ERROR: could not create a GL 4.1 core context\n");
+    return false;
+  }
+
+  if (!surfaceless) {
+    const EGLint surfaceAttribs[] = {
+      EGL_WIDTH, 1,
+      EGL_HEIGHT, 1,
+      EGL_NONE
+    };
+    aContext.surface = eglCreatePbufferSurface(aContext.display, config, surfaceAttribs);
+    if (aContext.surface == EGL_NO_SURFACE) {
+      fprintf(stderr, "ERROR: could not create a pbuffer\n");
+      return false;
+    }
+  }
+  if (!eglMakeCurrent(aContext.display, aContext.surface, aContext.surface, aContext.context)) {
+    fprintf(stderr, "ERROR: could not make the EGL context current\n");
+    return false;
+  }
+
+  if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+    fprintf(stderr, "Failed to initialize OpenGL context\n");
+    return false;
+  }
+  return true;
+}
+
+static void
+shutdownContext(HeadlessContext& aContext)
+{
+  if (aContext.display == EGL_NO_DISPLAY) {
+    return;
+  }
+  eglMakeCurrent(aContext.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (aContext.surface != EGL_NO_SURFACE) {
+    eglDestroySurface(aContext.display, aContext.surface);
+  }
+  if (aContext.context != EGL_NO_CONTEXT) {
+    eglDestroyContext(aContext.display, aContext.context);
+  }
+  eglTerminate(aContext.display);
+  aContext = HeadlessContext();
+}
+
+static __uint32_t
+crc32(__uint32_t aCRC, const unsigned char* aData, size_t aLength)
+{
+  static __uint32_t table[256];
+  if (!table[1]) {
+    for (__uint32_t i = 0; i < 256; i++) {
+      __uint32_t c = i;
+      for (int bit = 0; bit < 8; bit++) {
+        c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+  }
+  aCRC = ~aCRC;
+  for (size_t i = 0; i < aLength; i++) {
+    aCRC = table[(aCRC ^ aData[i]) & 0xff] ^ (aCRC >> 8);
+  }
+  return ~aCRC;
+}
+
+static void
+appendBigEndian(vector<unsigned char>& aData, __uint32_t aValue)
+{
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    aData.push_back((unsigned char)(aValue >> shift));
+  }
+}
+
+static void
+writePNGChunk(ofstream& aFile, const char aType[4], const vector<unsigned char>& aData)
+{
+  vector<unsigned char> chunk;
+  appendBigEndian(chunk, (__uint32_t)aData.size());
+  chunk.insert(chunk.end(), aType, aType + 4);
+  chunk.insert(chunk.end(), aData.begin(), aData.end());
+  appendBigEndian(chunk, crc32(0, &chunk[4], chunk.size() - 4));
+  aFile.write((const char*)&chunk[0], chunk.size());
+}
+
+// Writes an RGBA PNG. The pixels are stored rather than deflated, which keeps
+// this free of zlib and costs nothing to encode.
+static bool
+writePNG(const string& aPath, const Image& aImage)
+{
+  ofstream file(aPath, ios::binary | ios::trunc);
+  if (!file) {
+    return false;
+  }
+  const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  file.write((const char*)signature, sizeof(signature));
+
+  vector<unsigned char> header;
+  appendBigEndian(header, aImage.width);
+  appendBigEndian(header, aImage.height);
+  // 8 bits per channel, RGBA, no interlacing.
+  const unsigned char format[] = { 8, 6, 0, 0, 0 };
+  header.insert(header.end(), format, format + sizeof(format));
+  writePNGChunk(file, "IHDR", header);
+
+  // Each row starts with its filter type, none.
+  size_t rowSize = (size_t)aImage.width * 4;
+  vector<unsigned char> scanlines;
+  scanlines.reserve((rowSize + 1) * aImage.height);
+  for (int y = 0; y < aImage.height; y++) {
+    scanlines.push_back(0);
+    scanlines.insert(scanlines.end(),
+                     aImage.pixels.begin() + y * rowSize,
+                     aImage.pixels.begin() + (y + 1) * rowSize);
+  }
+
+  // A zlib stream of stored deflate blocks, which hold up to 65535 bytes.
+  vector<unsigned char> data = { 0x78, 0x01 };
+  size_t offset = 0;
+  do {
+    size_t length = min(scanlines.size() - offset, (size_t)65535);
+    bool last = offset + length == scanlines.size();
+    data.push_back(last ? 1 : 0);
+    data.push_back((unsigned char)length);
+    data.push_back((unsigned char)(length >> 8));
+    data.push_back((unsigned char)~length);
+    data.push_back((unsigned char)(~length >> 8));
+    data.insert(data.end(), scanlines.begin() + offset, scanlines.begin() + offset + length);
+    offset += length;
+  } while (offset < scanlines.size());
+  __uint32_t a = 1, b = 0;
+  for (unsigned char byte : scanlines) {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  appendBigEndian(data, (b << 16) | a);
+  writePNGChunk(file, "IDAT", data);
+
+  writePNGChunk(file, "IEND", vector<unsigned char>());
+  return file.good();
+}
+
+static bool
+writeRaw(const string& aPath, const Image& aImage)
+{
+  ofstream file(aPath, ios::binary | ios::trunc);
+  if (!file) {
+    return false;
+  }
+  file.write((const char*)&aImage.pixels[0], aImage.pixels.size());
+  return file.good();
+}
+
+static bool
+readRaw(const string& aPath, vector<unsigned char>& aPixels)
+{
+  ifstream file(aPath, ios::binary);
+  if (!file) {
+    return false;
+  }
+  aPixels.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+  return true;
+}
+
+// The largest difference between any channel of aImage and of the raw image
+// in aReference, or -1 if their sizes differ.
+static int
+getMaxDifference(const vector<unsigned char>& aReference, const Image& aImage)
+{
+  if (aReference.size() != aImage.pixels.size()) {
+    return -1;
+  }
+  int maxDifference = 0;
+  for (size_t i = 0; i < aReference.size(); i++) {
+    maxDifference = max(maxDifference, abs((int)aReference[i] - (int)aImage.pixels[i]));
+  }
+  return maxDifference;
+}
+
+static bool
+parseOptions(int argc, char** argv, Options& aOptions)
+{
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg.size() < 2 || arg.compare(0, 2, "--") != 0) {
+      if (!aOptions.inputPath.empty()) {
+        return false;
+      }
+      aOptions.inputPath = arg;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    string value = argv[++i];
+    if (arg == "--font") {
+      aOptions.fontPath = value;
+    } else if (arg == "--size") {
+      aOptions.fontSize = (float)atof(value.c_str());
+    } else if (arg == "--width") {
+      aOptions.width = atoi(value.c_str());
+    } else if (arg == "--height") {
+      aOptions.height = atoi(value.c_str());
+    } else if (arg == "--output") {
+      aOptions.outputDir = value;
+    } else if (arg == "--format" && (value == "png" || value == "raw")) {
+      aOptions.raw = value == "raw";
+    } else if (arg == "--rasterizer" && value == "default") {
+      aOptions.rasterizer = rz_default;
+    } else if (arg == "--rasterizer" && value == "tiled") {
+      aOptions.rasterizer = rz_tiled;
+    } else if (arg == "--rasterizer" && value == "compute") {
+      aOptions.rasterizer = rz_compute;
+    } else if (arg == "--rasterizer" && value == "cpu") {
+      aOptions.rasterizer = rz_cpu;
+    } else if (arg == "--trace") {
+      aOptions.tracePath = value;
+    } else if (arg == "--reference") {
+      aOptions.referenceDir = value;
+    } else if (arg == "--tolerance") {
+      aOptions.tolerance = atoi(value.c_str());
+    } else {
+      return false;
+    }
+  }
+  return aOptions.fontSize > 0.0f && aOptions.width > 0 && aOptions.height > 0 &&
+         aOptions.tolerance >= 0;
+}
+
+static int
+renderLines(const Options& aOptions, istream& aInput)
+{
+  // Font::load() keeps pointing at the data, so it has to outlive the font.
+  vector<unsigned char> fontData;
+  if (aOptions.fontPath.empty()) {
+    fontData.assign(eb_garamond_ttf, eb_garamond_ttf + eb_garamond_bin_len);
+  } else {
+    ifstream fontFile(aOptions.fontPath, ios::binary);
+    fontData.assign(istreambuf_iterator<char>(fontFile), istreambuf_iterator<char>());
+  }
+  shared_ptr<Font> font = make_shared<Font>();
+  if (fontData.empty() || !font->load(&fontData[0], fontData.size())) {
+    fprintf(stderr, "ERROR: could not load font %s\n", aOptions.fontPath.c_str());
+    return 1;
+  }
+
+  shared_ptr<TextBatch> batch = make_shared<TextBatch>();
+  if (!batch->init()) {
+    fprintf(stderr, "ERROR: could not initialize Pathfinder\n");
+    return 1;
+  }
+  batch->setRasterizer(aOptions.rasterizer);
+  setTracingEnabled(!aOptions.tracePath.empty());
+  TextView view;
+  if (!view.init(batch)) {
+    return 1;
+  }
+  view.setFont(font);
+  view.setFontSize(aOptions.fontSize);
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  string line;
+  int count = 0;
+  int mismatchCount = 0;
+  bool failed = false;
+  while (!failed && getline(aInput, line)) {
+    view.setText(line);
+    // Also writes out the images whose readbacks have finished since.
+    batch->prepare();
+
+    bool check = !aOptions.referenceDir.empty();
+    char name[32];
+    snprintf(name, sizeof(name), "%06d.%s", count, aOptions.raw || check ? "rgba" : "png");
+    ImageCallback write;
+    if (check) {
+      string path = aOptions.referenceDir + "/" + name;
+      int lineNumber = count + 1;
+      int tolerance = aOptions.tolerance;
+      write = [path, lineNumber, tolerance, &mismatchCount, &failed](const Image& aImage) {
+        vector<unsigned char> reference;
+        if (!readRaw(path, reference)) {
+          fprintf(stderr, "ERROR: could not read %s\n", path.c_str());
+          failed = true;
+          return;
+        }
+        int difference = getMaxDifference(reference, aImage);
+        if (difference < 0) {
+          fprintf(stderr, "Line %d differs in size from %s\n", lineNumber, path.c_str());
+          mismatchCount++;
+        } else if (difference > tolerance) {
+          fprintf(stderr, "Line %d differs from %s by up to %d\n", lineNumber, path.c_str(), difference);
+          mismatchCount++;
+        }
+      };
+    } else {
+      string path = aOptions.outputDir + "/" + name;
+      bool raw = aOptions.raw;
+      write = [path, raw, &failed](const Image& aImage) {
+        if (!(raw ? writeRaw(path, aImage) : writePNG(path, aImage))) {
+          fprintf(stderr, "ERROR: could not write %s\n", path.c_str());
+          failed = true;
+        }
+      };
+    }
+    if (!view.renderToImageAsync(aOptions.width, aOptions.height, write)) {
+      fprintf(stderr, "ERROR: could not render line %d\n", count + 1);
+      return 1;
+    }
+    count++;
+  }
+  batch->finishReadbacks();
+  if (failed) {
+    return 1;
+  }
+
+  chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+  fprintf(stderr, "Rendered %d lines in %.1f ms\n", count, elapsed.count());
+  if (mismatchCount) {
+    fprintf(stderr, "%d of %d lines differ from the reference\n", mismatchCount, count);
+  }
+
+  if (!aOptions.tracePath.empty()) {
+    ofstream traceFile(aOptions.tracePath, ios::trunc);
+    traceFile << getTraceJSON();
+    if (!traceFile.good()) {
+      fprintf(stderr, "ERROR: could not write %s\n", aOptions.tracePath.c_str());
+      return 1;
+    }
+  }
+  return mismatchCount ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    fputs(USAGE, stderr);
+    return 2;
+  }
+
+  ifstream inputFile;
+  if (!options.inputPath.empty()) {
+    inputFile.open(options.inputPath);
+    if (!inputFile) {
+      fprintf(stderr, "ERROR: could not open %s\n", options.inputPath.c_str());
+      return 1;
+    }
+  }
+
+  HeadlessContext context;
+  if (!initContext(context)) {
+    shutdownContext(context);
+    return 1;
+  }
+  printf("Renderer: %s\n", glGetString(GL_RENDERER));
+  printf("OpenGL version supported %s\n", glGetString(GL_VERSION));
+
+  int result = renderLines(options, options.inputPath.empty() ? cin : inputFile);
+  shutdownContext(context);
+  return result;
+}